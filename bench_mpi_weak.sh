@@ -0,0 +1,40 @@
+#!/bin/sh
+# Escalabilidade fraca do K-Means MPI: cada rank carrega a base inteira,
+# entao o trabalho por rank e constante e o tempo ideal nao muda com R.
+#
+# Uso: ./bench_mpi_weak.sh [binario] [ranks...]
+#   ex.: ./bench_mpi_weak.sh ./kmeans_mpi 1 2 4 8
+# Variaveis: RUNS (execucoes por configuracao, padrao 5), MPIRUN_FLAGS,
+#   OMP_NUM_THREADS (threads por rank; padrao nucleos / maior R da lista, para
+#   que os ranks no mesmo no nao disputem nucleos e o trabalho por rank nao
+#   mude com R). Em varios nos, repasse a variavel pelo MPIRUN_FLAGS
+#   (ex.: "-x OMP_NUM_THREADS" no Open MPI).
+
+BIN=${1:-./kmeans_mpi}
+[ $# -gt 0 ] && shift
+RANKS=${*:-1 2 4}
+RUNS=${RUNS:-5}
+
+if [ -z "$OMP_NUM_THREADS" ]; then
+    max_r=1
+    for r in $RANKS; do
+        [ "$r" -gt "$max_r" ] && max_r=$r
+    done
+    OMP_NUM_THREADS=$(( $(nproc) / max_r ))
+    [ "$OMP_NUM_THREADS" -lt 1 ] && OMP_NUM_THREADS=1
+fi
+export OMP_NUM_THREADS
+
+echo "K-Means MPI - escalabilidade fraca ($RUNS execucoes por configuracao, $OMP_NUM_THREADS threads por rank)"
+base=""
+for r in $RANKS; do
+    t=$(mpirun $MPIRUN_FLAGS -np "$r" "$BIN" --weak --runs "$RUNS" |
+        awk '/Tempo medio por execucao/ { sub(",", "", $5); print $5 }')
+    if [ -z "$t" ]; then
+        echo "Falha ao executar com $r ranks" >&2
+        exit 1
+    fi
+    [ -z "$base" ] && base=$t
+    awk -v r="$r" -v t="$t" -v b="$base" \
+        'BEGIN { printf "Ranks: %2d -> tempo medio: %.6f s, eficiencia fraca: %.1f%%\n", r, t, 100.0 * b / t }'
+done
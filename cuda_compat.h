@@ -0,0 +1,198 @@
+/**
+ * @file cuda_compat.h
+ * @brief Camada de compatibilidade: o mesmo fonte .cu compila com nvcc (GPU)
+ *        ou com um compilador C++ comum, emulando o CUDA na CPU.
+ *
+ * Com nvcc (__CUDACC__) so inclui <cuda_runtime.h>. Sem CUDA:
+ *  - __global__/__device__/__host__ viram funcoes comuns;
+ *  - blockIdx/threadIdx/blockDim/gridDim sao variaveis thread_local;
+ *  - KERNEL_LAUNCH(kernel, grid, block, args...) executa a grade com OpenMP:
+ *    os blocos sao distribuidos entre as threads e as threads de cada bloco
+ *    rodam em sequencia dentro dele (sem __syncthreads/memoria shared);
+ *  - cudaMalloc/cudaMemcpy/cudaFree sobre a memoria do host, eventos com
+ *    omp_get_wtime, atomicAdd com builtins atomicos do gcc.
+ *
+ * Compilacao sem GPU:
+ *   g++ -x c++ k_means_clustering_cuda.cu -O2 -fopenmp -o kmeans_cuda_host
+ */
+#ifndef CUDA_COMPAT_H
+#define CUDA_COMPAT_H
+
+#ifdef __CUDACC__
+
+#include <cuda_runtime.h>
+
+#define KERNEL_LAUNCH(kernel, grid, block, ...) kernel<<<(grid), (block)>>>(__VA_ARGS__)
+
+#else /* emulacao na CPU */
+
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CUDA_COMPAT_HOST 1
+
+#define __global__
+#define __device__
+#define __host__
+
+struct dim3
+{
+    unsigned int x, y, z;
+    dim3(unsigned int vx = 1, unsigned int vy = 1, unsigned int vz = 1) : x(vx), y(vy), z(vz) {}
+};
+
+static thread_local dim3 blockIdx;
+static thread_local dim3 threadIdx;
+static thread_local dim3 blockDim;
+static thread_local dim3 gridDim;
+
+typedef int cudaError_t;
+#define cudaSuccess 0
+#define cudaErrorMemoryAllocation 2
+
+enum cudaMemcpyKind
+{
+    cudaMemcpyHostToHost = 0,
+    cudaMemcpyHostToDevice = 1,
+    cudaMemcpyDeviceToHost = 2,
+    cudaMemcpyDeviceToDevice = 3,
+    cudaMemcpyDefault = 4
+};
+
+static inline cudaError_t cudaMalloc(void** ptr, size_t bytes)
+{
+    *ptr = malloc(bytes ? bytes : 1);
+    return *ptr ? cudaSuccess : cudaErrorMemoryAllocation;
+}
+
+static inline cudaError_t cudaFree(void* ptr)
+{
+    free(ptr);
+    return cudaSuccess;
+}
+
+static inline cudaError_t cudaMemcpy(void* dst, const void* src, size_t bytes, cudaMemcpyKind)
+{
+    memcpy(dst, src, bytes);
+    return cudaSuccess;
+}
+
+static inline cudaError_t cudaMemset(void* dst, int value, size_t bytes)
+{
+    memset(dst, value, bytes);
+    return cudaSuccess;
+}
+
+/* lancamentos sao sincronos na emulacao */
+static inline cudaError_t cudaDeviceSynchronize(void)
+{
+    return cudaSuccess;
+}
+
+static inline cudaError_t cudaGetLastError(void)
+{
+    return cudaSuccess;
+}
+
+static inline const char* cudaGetErrorString(cudaError_t err)
+{
+    return err == cudaSuccess ? "no error" : "emulated CUDA error";
+}
+
+struct cuda_compat_event
+{
+    double t;
+};
+typedef cuda_compat_event* cudaEvent_t;
+
+static inline cudaError_t cudaEventCreate(cudaEvent_t* e)
+{
+    *e = (cudaEvent_t)calloc(1, sizeof(cuda_compat_event));
+    return *e ? cudaSuccess : cudaErrorMemoryAllocation;
+}
+
+static inline cudaError_t cudaEventRecord(cudaEvent_t e, int stream = 0)
+{
+    (void)stream;
+    e->t = omp_get_wtime();
+    return cudaSuccess;
+}
+
+static inline cudaError_t cudaEventSynchronize(cudaEvent_t)
+{
+    return cudaSuccess;
+}
+
+static inline cudaError_t cudaEventElapsedTime(float* ms, cudaEvent_t start, cudaEvent_t stop)
+{
+    *ms = (float)((stop->t - start->t) * 1000.0);
+    return cudaSuccess;
+}
+
+static inline cudaError_t cudaEventDestroy(cudaEvent_t e)
+{
+    free(e);
+    return cudaSuccess;
+}
+
+static inline int atomicAdd(int* address, int val)
+{
+    return __atomic_fetch_add(address, val, __ATOMIC_RELAXED);
+}
+
+static inline unsigned int atomicAdd(unsigned int* address, unsigned int val)
+{
+    return __atomic_fetch_add(address, val, __ATOMIC_RELAXED);
+}
+
+static inline unsigned long long atomicAdd(unsigned long long* address, unsigned long long val)
+{
+    return __atomic_fetch_add(address, val, __ATOMIC_RELAXED);
+}
+
+static inline double atomicAdd(double* address, double val)
+{
+    double old, next;
+    __atomic_load(address, &old, __ATOMIC_RELAXED);
+    do
+    {
+        next = old + val;
+    } while (!__atomic_compare_exchange(address, &old, &next, true, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED));
+    return old;
+}
+
+/* executa a grade: blocos em paralelo, threads de um bloco em sequencia */
+template <typename... Params, typename... Args>
+static void cuda_compat_launch(void (*kernel)(Params...), dim3 grid, dim3 block, Args... args)
+{
+    long long blocks = (long long)grid.x * grid.y * grid.z;
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (long long b = 0; b < blocks; b++)
+    {
+        gridDim = grid;
+        blockDim = block;
+        blockIdx = dim3((unsigned int)(b % grid.x), (unsigned int)(b / grid.x % grid.y),
+                        (unsigned int)(b / ((long long)grid.x * grid.y)));
+        for (unsigned int tz = 0; tz < block.z; tz++)
+        {
+            for (unsigned int ty = 0; ty < block.y; ty++)
+            {
+                for (unsigned int tx = 0; tx < block.x; tx++)
+                {
+                    threadIdx = dim3(tx, ty, tz);
+                    kernel(args...);
+                }
+            }
+        }
+    }
+}
+
+#define KERNEL_LAUNCH(kernel, grid, block, ...) \
+    cuda_compat_launch(kernel, dim3(grid), dim3(block), __VA_ARGS__)
+
+#endif /* __CUDACC__ */
+
+#endif /* CUDA_COMPAT_H */
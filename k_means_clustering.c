@@ -1,10 +1,14 @@
 #include <float.h>
 #include <math.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include "kmeans_shm.h"
+#include "kmeans_sum.h"
+
 #define REPLICATION_FACTOR 1000
 #define NUM_RUNS 30
 
@@ -60,10 +64,10 @@ static cluster* kMeans(observation* observations, size_t size, int k)
         return clusters;
     }
 
-    if (k >= (int)size)
+    if ((size_t)k >= size)
     {
         clusters = (cluster*)calloc(k, sizeof(cluster));
-        for (int j = 0; j < (int)size; j++)
+        for (size_t j = 0; j < size; j++)
         {
             clusters[j].x = observations[j].x;
             clusters[j].y = observations[j].y;
@@ -90,6 +94,35 @@ static cluster* kMeans(observation* observations, size_t size, int k)
             clusters[i].count = 0;
         }
 
+#if COMPENSATED_SUM
+        double* block = (double*)calloc(2 * (size_t)k, sizeof(double));
+        double* comp = (double*)calloc(2 * (size_t)k, sizeof(double));
+        for (size_t b = 0; b < size; b += SUM_BLOCK)
+        {
+            size_t end = b + SUM_BLOCK < size ? b + SUM_BLOCK : size;
+            for (size_t j = b; j < end; j++)
+            {
+                int g = observations[j].group;
+                block[g] += observations[j].x;
+                block[k + g] += observations[j].y;
+                clusters[g].count += 1;
+            }
+            for (int i = 0; i < k; i++)
+            {
+                neumaier_add(&clusters[i].x, &comp[i], block[i]);
+                neumaier_add(&clusters[i].y, &comp[k + i], block[k + i]);
+                block[i] = 0.0;
+                block[k + i] = 0.0;
+            }
+        }
+        for (int i = 0; i < k; i++)
+        {
+            clusters[i].x += comp[i];
+            clusters[i].y += comp[k + i];
+        }
+        free(block);
+        free(comp);
+#else
         for (size_t j = 0; j < size; j++)
         {
             int g = observations[j].group;
@@ -97,6 +130,7 @@ static cluster* kMeans(observation* observations, size_t size, int k)
             clusters[g].y += observations[j].y;
             clusters[g].count += 1;
         }
+#endif
 
         for (int i = 0; i < k; i++)
         {
@@ -125,12 +159,27 @@ static cluster* kMeans(observation* observations, size_t size, int k)
 static observation* load_dataset(const char* filename, size_t* out_size)
 {
     FILE* f = fopen(filename, "r");
+    if (!f)
+    {
+        return NULL;
+    }
+
     char buffer[512];
     size_t capacity = 4096;
     size_t size = 0;
     observation* observations = (observation*)malloc(sizeof(observation) * capacity);
+    if (!observations)
+    {
+        fclose(f);
+        return NULL;
+    }
 
-    fgets(buffer, sizeof(buffer), f); /* descarta cabecalho */
+    if (!fgets(buffer, sizeof(buffer), f)) /* descarta cabecalho */
+    {
+        fclose(f);
+        free(observations);
+        return NULL;
+    }
 
     while (fgets(buffer, sizeof(buffer), f))
     {
@@ -156,6 +205,12 @@ static observation* load_dataset(const char* filename, size_t* out_size)
         {
             capacity *= 2;
             observation* tmp = (observation*)realloc(observations, sizeof(observation) * capacity);
+            if (!tmp)
+            {
+                free(observations);
+                fclose(f);
+                return NULL;
+            }
             observations = tmp;
         }
 
@@ -167,8 +222,19 @@ static observation* load_dataset(const char* filename, size_t* out_size)
 
     fclose(f);
 
+    if (size == 0)
+    {
+        free(observations);
+        return NULL;
+    }
+
     size_t replicated_size = size * REPLICATION_FACTOR;
     observation* replicated = (observation*)malloc(sizeof(observation) * replicated_size);
+    if (!replicated)
+    {
+        free(observations);
+        return NULL;
+    }
     for (size_t r = 0; r < REPLICATION_FACTOR; r++)
     {
         for (size_t i = 0; i < size; i++)
@@ -191,7 +257,16 @@ int main(void)
     int k = 5;
 
     size_t size = 0;
-    observation* observations = load_dataset(filename, &size);
+    const char* shm_name = getenv("KMEANS_SHM");
+    observation* observations =
+        shm_name ? (observation*)kmeans_shm_load_aos(shm_name, sizeof(observation), offsetof(observation, x),
+                                                     offsetof(observation, y), &size)
+                 : load_dataset(filename, &size);
+    if (!observations)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
 
     srand((unsigned int)time(NULL));
 
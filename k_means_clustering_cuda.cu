@@ -8,20 +8,30 @@
  *
  * As seções marcadas com [PARALELO-CUDA] indicam mudanças em relação
  * à versão sequencial k_means_clustering.c.
+ *
+ * Sem GPU, o mesmo fonte compila como C++ com a emulação de cuda_compat.h
+ * (kernel executado na CPU com OpenMP, grade/blocos emulados):
+ *   g++ -x c++ k_means_clustering_cuda.cu -O2 -fopenmp -o kmeans_cuda_host
  */
 
 #include <float.h>        /* DBL_MAX */
+#include <limits.h>       /* UINT_MAX */
 #include <math.h>         /* funções matemáticas básicas */
-#include <cuda_runtime.h> /* CUDA runtime API */
+#include "cuda_compat.h"  /* CUDA runtime API (ou emulação na CPU sem nvcc) */
 #include <stdio.h>        /* printf, FILE */
 #include <stdlib.h>       /* rand, malloc, free */
 #include <string.h>       /* strtok */
 #include <time.h>         /* time */
 
+#include "kmeans_shm.h"     /* base publicada em memória compartilhada */
+
 /* Mesmo fator de replicação/execuções da versão sequencial */
 #define REPLICATION_FACTOR 1000
 #define NUM_RUNS 30
 
+/* threads por bloco do kernel de atribuição */
+#define BLOCK_SIZE 256
+
 typedef struct observation
 {
     double x;
@@ -146,17 +156,22 @@ static observation* load_dataset(const char* filename, size_t* out_size)
     return replicated;
 }
 
-/* [PARALELO-CUDA] Kernel para atribuição de pontos aos clusters */
+/*
+ * [PARALELO-CUDA] Kernel para atribuição de pontos aos clusters.
+ * Index = unsigned int (n < 2^32, caminho rápido) ou unsigned long long;
+ * o contador `changed` usa o mesmo tipo (atomicAdd existe para os dois).
+ */
+template <typename Index>
 __global__ void assign_clusters_kernel(const double* x,
                                        const double* y,
                                        int* groups,
                                        const double* cent_x,
                                        const double* cent_y,
                                        int k,
-                                       int n,
-                                       int* changed)
+                                       Index n,
+                                       Index* changed)
 {
-    int i = blockIdx.x * blockDim.x + threadIdx.x;
+    Index i = (Index)blockIdx.x * blockDim.x + threadIdx.x;
     if (i >= n)
     {
         return;
@@ -179,20 +194,21 @@ __global__ void assign_clusters_kernel(const double* x,
 
     if (best != groups[i])
     {
-        atomicAdd(changed, 1);
+        atomicAdd(changed, (Index)1);
         groups[i] = best;
     }
 }
 
 /* [PARALELO-CUDA] Implementação de K-Means com passo de atribuição na GPU */
-static void kMeans_cuda(double* h_x,
-                        double* h_y,
-                        int* h_groups,
-                        size_t n,
-                        int k,
-                        double* h_cent_x,
-                        double* h_cent_y,
-                        int* h_cent_count)
+template <typename Index>
+static void kMeans_cuda_impl(double* h_x,
+                             double* h_y,
+                             int* h_groups,
+                             size_t n,
+                             int k,
+                             double* h_cent_x,
+                             double* h_cent_y,
+                             long long* h_cent_count)
 {
     if (k <= 1)
     {
@@ -206,14 +222,15 @@ static void kMeans_cuda(double* h_x,
         }
         h_cent_x[0] = sum_x / (double)n;
         h_cent_y[0] = sum_y / (double)n;
-        h_cent_count[0] = (int)n;
+        h_cent_count[0] = (long long)n;
         return;
     }
 
-    int N = (int)n;
+    Index N = (Index)n;
 
     double *d_x = NULL, *d_y = NULL;
-    int *d_groups = NULL, *d_changed = NULL;
+    int* d_groups = NULL;
+    Index* d_changed = NULL;
     double *d_cent_x = NULL, *d_cent_y = NULL;
 
     cudaMalloc((void**)&d_x, sizeof(double) * N);
@@ -221,7 +238,7 @@ static void kMeans_cuda(double* h_x,
     cudaMalloc((void**)&d_groups, sizeof(int) * N);
     cudaMalloc((void**)&d_cent_x, sizeof(double) * k);
     cudaMalloc((void**)&d_cent_y, sizeof(double) * k);
-    cudaMalloc((void**)&d_changed, sizeof(int));
+    cudaMalloc((void**)&d_changed, sizeof(Index));
 
     cudaMemcpy(d_x, h_x, sizeof(double) * N, cudaMemcpyHostToDevice);
     cudaMemcpy(d_y, h_y, sizeof(double) * N, cudaMemcpyHostToDevice);
@@ -236,7 +253,7 @@ static void kMeans_cuda(double* h_x,
     size_t minAcceptedError =
         n / 10000; /* critério de parada semelhante às outras versões */
 
-    int h_changed = 0;
+    Index h_changed = 0;
 
     do
     {
@@ -275,16 +292,15 @@ static void kMeans_cuda(double* h_x,
                    cudaMemcpyHostToDevice);
 
         h_changed = 0;
-        cudaMemcpy(d_changed, &h_changed, sizeof(int),
+        cudaMemcpy(d_changed, &h_changed, sizeof(Index),
                    cudaMemcpyHostToDevice);
 
-        int blockSize = 256;
-        int gridSize = (N + blockSize - 1) / blockSize;
+        unsigned int gridSize = (unsigned int)((n + BLOCK_SIZE - 1) / BLOCK_SIZE);
 
-        assign_clusters_kernel<<<gridSize, blockSize>>>(
-            d_x, d_y, d_groups, d_cent_x, d_cent_y, k, N, d_changed);
+        KERNEL_LAUNCH(assign_clusters_kernel<Index>, gridSize, BLOCK_SIZE,
+                      d_x, d_y, d_groups, d_cent_x, d_cent_y, k, N, d_changed);
 
-        cudaMemcpy(&h_changed, d_changed, sizeof(int),
+        cudaMemcpy(&h_changed, d_changed, sizeof(Index),
                    cudaMemcpyDeviceToHost);
         cudaMemcpy(h_groups, d_groups, sizeof(int) * N,
                    cudaMemcpyDeviceToHost);
@@ -299,48 +315,120 @@ static void kMeans_cuda(double* h_x,
     cudaFree(d_changed);
 }
 
-int main()
+/*
+ * [PARALELO-CUDA] escolhe o caminho de 32 bits quando o índice global cabe em
+ * unsigned int: o último bloco vai até n arredondado para cima em BLOCK_SIZE,
+ * então n precisa ficar a um bloco de UINT_MAX para o índice não dar a volta.
+ */
+static void kMeans_cuda(double* h_x,
+                        double* h_y,
+                        int* h_groups,
+                        size_t n,
+                        int k,
+                        double* h_cent_x,
+                        double* h_cent_y,
+                        long long* h_cent_count)
 {
-    const char* filename = "Instagram_visits_clustering.csv";
-    int k = 5;
+    if (n <= (size_t)UINT_MAX - BLOCK_SIZE)
+    {
+        kMeans_cuda_impl<unsigned int>(h_x, h_y, h_groups, n, k, h_cent_x,
+                                       h_cent_y, h_cent_count);
+    }
+    else
+    {
+        kMeans_cuda_impl<unsigned long long>(h_x, h_y, h_groups, n, k,
+                                             h_cent_x, h_cent_y, h_cent_count);
+    }
+}
 
-    size_t size = 0;
-    observation* obs = load_dataset(filename, &size);
+/*
+ * Vetores x/y da base: anexados do segmento KMEANS_SHM (sem cópia, somente
+ * leitura) ou lidos do CSV. `shm->base` indica de onde vieram.
+ */
+static int load_columns(const char* filename, kmeans_shm_dataset* shm,
+                        double** x, double** y, size_t* size)
+{
+    const char* shm_name = getenv("KMEANS_SHM");
+    memset(shm, 0, sizeof(*shm));
+    if (shm_name)
+    {
+        if (kmeans_shm_attach(shm_name, shm) != 0)
+        {
+            return -1;
+        }
+        *x = (double*)shm->x;
+        *y = (double*)shm->y;
+        *size = shm->n;
+        return 0;
+    }
+
+    observation* obs = load_dataset(filename, size);
     if (!obs)
     {
-        return 1;
+        return -1;
     }
 
-    double* x = (double*)malloc(sizeof(double) * size);
-    double* y = (double*)malloc(sizeof(double) * size);
-    int* groups = (int*)malloc(sizeof(int) * size);
-    if (!x || !y || !groups)
+    *x = (double*)malloc(sizeof(double) * *size);
+    *y = (double*)malloc(sizeof(double) * *size);
+    if (!*x || !*y)
     {
         fprintf(stderr, "Erro de memória ao alocar vetores.\n");
         free(obs);
-        free(x);
-        free(y);
-        free(groups);
-        return 1;
+        free(*x);
+        free(*y);
+        return -1;
     }
 
-    for (size_t i = 0; i < size; i++)
+    for (size_t i = 0; i < *size; i++)
     {
-        x[i] = obs[i].x;
-        y[i] = obs[i].y;
-        groups[i] = 0;
+        (*x)[i] = obs[i].x;
+        (*y)[i] = obs[i].y;
     }
 
     free(obs);
+    return 0;
+}
+
+static void free_columns(kmeans_shm_dataset* shm, double* x, double* y)
+{
+    if (shm->base)
+    {
+        kmeans_shm_detach(shm);
+        return;
+    }
+    free(x);
+    free(y);
+}
+
+int main()
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    int k = 5;
+
+    size_t size = 0;
+    double* x = NULL;
+    double* y = NULL;
+    kmeans_shm_dataset shm;
+    if (load_columns(filename, &shm, &x, &y, &size) != 0)
+    {
+        return 1;
+    }
+
+    int* groups = (int*)calloc(size, sizeof(int));
+    if (!groups)
+    {
+        fprintf(stderr, "Erro de memória ao alocar vetores.\n");
+        free_columns(&shm, x, y);
+        return 1;
+    }
 
     double* cent_x = (double*)malloc(sizeof(double) * k);
     double* cent_y = (double*)malloc(sizeof(double) * k);
-    int* cent_count = (int*)malloc(sizeof(int) * k);
+    long long* cent_count = (long long*)malloc(sizeof(long long) * k);
     if (!cent_x || !cent_y || !cent_count)
     {
         fprintf(stderr, "Erro de memória ao alocar centróides.\n");
-        free(x);
-        free(y);
+        free_columns(&shm, x, y);
         free(groups);
         free(cent_x);
         free(cent_y);
@@ -350,7 +438,11 @@ int main()
 
     srand((unsigned int)time(NULL));
 
+#ifdef CUDA_COMPAT_HOST
+    printf("K-Means CUDA (emulado na CPU, %d threads)\n", omp_get_max_threads());
+#else
     printf("K-Means CUDA (GPU)\n");
+#endif
     printf("Observações efetivas: %zu, clusters: %d\n", size, k);
 
     cudaEvent_t start, stop;
@@ -379,15 +471,14 @@ int main()
 
     for (int c = 0; c < k; c++)
     {
-        printf("Cluster %d: centroid (%.4f, %.4f), pontos=%d\n", c,
+        printf("Cluster %d: centroid (%.4f, %.4f), pontos=%lld\n", c,
                cent_x[c], cent_y[c], cent_count[c]);
     }
 
     cudaEventDestroy(start);
     cudaEventDestroy(stop);
 
-    free(x);
-    free(y);
+    free_columns(&shm, x, y);
     free(groups);
     free(cent_x);
     free(cent_y);
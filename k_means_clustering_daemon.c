@@ -0,0 +1,923 @@
+/**
+ * @file k_means_clustering_daemon.c
+ * @brief Daemon local de K-Means: mantem o pool OpenMP e as bases carregadas
+ *        em memoria e atende pedidos de fit/predict por socket Unix.
+ *
+ * Um processo por job paga leitura do CSV, replicacao e aquecimento das
+ * threads a cada vez. Aqui isso acontece uma vez: a thread de aceitacao so
+ * aceita conexoes; cada conexao ganha uma thread leitora (com timeout de
+ * recepcao) que le o pedido e o enfileira, entao um cliente lento nao
+ * segura os outros. No maximo MAX_CONNECTIONS conexoes ficam abertas (lendo,
+ * na fila ou em execucao); acima disso a aceitacao espera. Uma unica thread de trabalho (sempre a mesma, portanto
+ * sempre o mesmo pool OpenMP) executa os pedidos em ordem e responde com as
+ * latencias de fila e de computacao.
+ *
+ * O caminho do pedido escolhe a base: um CSV, ou "shm:/nome" para um
+ * segmento publicado por kmeans_shm_publish (KMEANS_SHM nao se aplica aqui).
+ *
+ * Uso:
+ *   ./kmeans_daemon serve [socket]
+ *   ./kmeans_daemon fit   [socket] [arquivo] [k] [seed]
+ *   ./kmeans_daemon predict [socket] [arquivo] [k]   (fit + predict das linhas do CSV)
+ *   ./kmeans_daemon bench [socket] [arquivo] [k] [pedidos]
+ *   ./kmeans_daemon stop  [socket]
+ *
+ * Protocolo (binario, ordem de bytes nativa, so uso local): cada conexao
+ * leva um kmeans_request, seguido de `path_len` bytes do caminho e, no
+ * PREDICT, de k pares (x, y) de centroides e `points` pares (x, y) a
+ * classificar. A resposta e um kmeans_response seguido, no FIT, de k
+ * kmeans_wire_cluster e, no PREDICT, de `n` rotulos int32.
+ */
+#include <errno.h>
+#include <omp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kmeans_common.h"
+
+#define DEFAULT_SOCKET "/tmp/kmeans.sock"
+#define DATASET_CACHE_SIZE 4
+#define MAX_PATH_LEN 1024
+#define MAX_K 1024
+#define MAX_POINTS (1ull << 26) /* PREDICT: pontos por pedido (1 GiB de coordenadas) */
+#define READ_TIMEOUT_S 10       /* recepcao do pedido; cliente parado perde a conexao */
+#define MAX_CONNECTIONS 64      /* conexoes abertas ao mesmo tempo (threads leitoras + fila) */
+#define SHM_PREFIX "shm:"
+
+#define REQUEST_MAGIC 0x514D4B52u  /* "RKMQ" */
+#define RESPONSE_MAGIC 0x534D4B52u /* "RKMS" */
+#define PROTOCOL_VERSION 1
+
+enum
+{
+    OP_FIT = 1,
+    OP_PREDICT = 2,
+    OP_SHUTDOWN = 3
+};
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t op;
+    uint32_t k;
+    uint32_t path_len;
+    uint64_t seed;
+    uint64_t points; /* PREDICT: pontos enviados no corpo */
+} kmeans_request;
+
+typedef struct
+{
+    uint32_t magic;
+    int32_t status; /* 0 = ok */
+    uint32_t k;
+    uint32_t iterations;
+    uint64_t n;
+    uint64_t queue_ns;   /* tempo na fila do daemon */
+    uint64_t compute_ns; /* tempo de carga (se nao estava em cache) + calculo */
+    uint32_t cache_hit;
+    uint32_t reserved;
+} kmeans_response;
+
+typedef struct
+{
+    double x;
+    double y;
+    uint64_t count;
+} kmeans_wire_cluster;
+
+typedef struct job
+{
+    int fd;
+    kmeans_request req;
+    char path[MAX_PATH_LEN + 1];
+    double* payload; /* PREDICT: 2k centroides + 2*points coordenadas */
+    uint64_t enqueued_ns;
+    struct job* next;
+} job;
+
+typedef struct
+{
+    char path[MAX_PATH_LEN + 1];
+    observation* observations;
+    size_t size;
+    uint64_t last_used;
+} cached_dataset;
+
+/* fila, contador de conexoes e `shutting_down`: tudo sob queue_lock */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t connections_cond = PTHREAD_COND_INITIALIZER;
+static job* queue_head = NULL;
+static job* queue_tail = NULL;
+static int shutting_down = 0;
+static int open_connections = 0;
+static int listen_fd = -1;
+
+static cached_dataset dataset_cache[DATASET_CACHE_SIZE];
+static uint64_t cache_clock = 0;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int write_all(int fd, const void* buf, size_t len)
+{
+    const char* p = (const char*)buf;
+    while (len > 0)
+    {
+        ssize_t w = write(fd, p, len);
+        if (w < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (w <= 0)
+        {
+            return -1;
+        }
+        p += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void* buf, size_t len)
+{
+    char* p = (char*)buf;
+    while (len > 0)
+    {
+        ssize_t r = read(fd, p, len);
+        if (r < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (r <= 0)
+        {
+            return -1;
+        }
+        p += r;
+        len -= (size_t)r;
+    }
+    return 0;
+}
+
+static int is_shutting_down(void)
+{
+    pthread_mutex_lock(&queue_lock);
+    int down = shutting_down;
+    pthread_mutex_unlock(&queue_lock);
+    return down;
+}
+
+/* fecha a conexao de um pedido e libera a vaga para a aceitacao */
+static void close_connection(int fd)
+{
+    close(fd);
+    pthread_mutex_lock(&queue_lock);
+    open_connections--;
+    pthread_cond_broadcast(&connections_cond);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+/* base pedida: "shm:/nome" anexa o segmento publicado, qualquer outro caminho e um CSV */
+static observation* load_requested(const char* path, size_t* size)
+{
+    if (strncmp(path, SHM_PREFIX, strlen(SHM_PREFIX)) == 0)
+    {
+        return (observation*)kmeans_shm_load_aos(path + strlen(SHM_PREFIX), sizeof(observation),
+                                                 offsetof(observation, x), offsetof(observation, y), size);
+    }
+    return load_dataset(path, size);
+}
+
+/* base em cache (LRU); carrega na primeira vez */
+static cached_dataset* get_dataset(const char* path, int* hit)
+{
+    cached_dataset* victim = &dataset_cache[0];
+    for (int i = 0; i < DATASET_CACHE_SIZE; i++)
+    {
+        cached_dataset* d = &dataset_cache[i];
+        if (d->observations && strcmp(d->path, path) == 0)
+        {
+            d->last_used = ++cache_clock;
+            *hit = 1;
+            return d;
+        }
+        if (!d->observations || d->last_used < victim->last_used)
+        {
+            victim = d;
+        }
+    }
+
+    *hit = 0;
+    size_t size = 0;
+    observation* observations = load_requested(path, &size);
+    if (!observations)
+    {
+        return NULL;
+    }
+
+    free(victim->observations);
+    snprintf(victim->path, sizeof(victim->path), "%s", path);
+    victim->observations = observations;
+    victim->size = size;
+    victim->last_used = ++cache_clock;
+    return victim;
+}
+
+static void run_fit(job* j, kmeans_response* resp, kmeans_wire_cluster* out)
+{
+    int hit = 0;
+    cached_dataset* d = get_dataset(j->path, &hit);
+    resp->cache_hit = (uint32_t)hit;
+    if (!d)
+    {
+        resp->status = -1;
+        return;
+    }
+
+    srand((unsigned int)j->req.seed);
+    size_t iters = 0;
+    cluster* clusters = kMeans_omp_iters(d->observations, d->size, (int)j->req.k, &iters);
+    int kk = j->req.k <= 1 ? 1 : (int)j->req.k;
+    for (int c = 0; c < kk; c++)
+    {
+        out[c].x = clusters[c].x;
+        out[c].y = clusters[c].y;
+        out[c].count = clusters[c].count;
+    }
+    free(clusters);
+
+    resp->k = (uint32_t)kk;
+    resp->iterations = (uint32_t)iters;
+    resp->n = d->size;
+}
+
+static void run_predict(job* j, int32_t* labels)
+{
+    int k = (int)j->req.k;
+    const double* cent = j->payload;
+    const double* pts = j->payload + 2 * (size_t)k;
+    long long m = (long long)j->req.points;
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < m; i++)
+    {
+        double px = pts[2 * i];
+        double py = pts[2 * i + 1];
+        double minD = DBL_MAX;
+        int best = 0;
+        for (int c = 0; c < k; c++)
+        {
+            double dx = cent[2 * c] - px;
+            double dy = cent[2 * c + 1] - py;
+            double dist = dx * dx + dy * dy;
+            if (dist < minD)
+            {
+                minD = dist;
+                best = c;
+            }
+        }
+        labels[i] = best;
+    }
+}
+
+static void process_job(job* j)
+{
+    kmeans_response resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.magic = RESPONSE_MAGIC;
+
+    uint64_t start = now_ns();
+    resp.queue_ns = start - j->enqueued_ns;
+
+    kmeans_wire_cluster* clusters = NULL;
+    int32_t* labels = NULL;
+    if (j->req.op == OP_FIT)
+    {
+        clusters = (kmeans_wire_cluster*)calloc(j->req.k ? j->req.k : 1, sizeof(kmeans_wire_cluster));
+        run_fit(j, &resp, clusters);
+    }
+    else
+    {
+        labels = (int32_t*)malloc(sizeof(int32_t) * (j->req.points ? j->req.points : 1));
+        if (labels)
+        {
+            run_predict(j, labels);
+            resp.k = j->req.k;
+            resp.n = j->req.points;
+        }
+        else
+        {
+            resp.status = -1;
+        }
+    }
+    resp.compute_ns = now_ns() - start;
+
+    if (write_all(j->fd, &resp, sizeof(resp)) == 0 && resp.status == 0)
+    {
+        if (clusters)
+        {
+            write_all(j->fd, clusters, sizeof(kmeans_wire_cluster) * resp.k);
+        }
+        if (labels)
+        {
+            write_all(j->fd, labels, sizeof(int32_t) * resp.n);
+        }
+    }
+
+    free(clusters);
+    free(labels);
+    free(j->payload);
+    close_connection(j->fd);
+    free(j);
+}
+
+static void* worker_main(void* arg)
+{
+    (void)arg;
+
+    /* aquece o pool: as regioes paralelas seguintes reutilizam estas threads */
+    #pragma omp parallel
+    {
+    }
+
+    for (;;)
+    {
+        pthread_mutex_lock(&queue_lock);
+        while (!queue_head && !shutting_down)
+        {
+            pthread_cond_wait(&queue_cond, &queue_lock);
+        }
+        job* j = queue_head;
+        if (j)
+        {
+            queue_head = j->next;
+            if (!queue_head)
+            {
+                queue_tail = NULL;
+            }
+        }
+        pthread_mutex_unlock(&queue_lock);
+
+        if (!j)
+        {
+            break; /* shutdown com fila vazia */
+        }
+        process_job(j);
+    }
+    return NULL;
+}
+
+/* descarta o job se o daemon ja esta encerrando (a thread de trabalho pode ter saido) */
+static void enqueue(job* j)
+{
+    j->enqueued_ns = now_ns();
+    j->next = NULL;
+    pthread_mutex_lock(&queue_lock);
+    if (shutting_down)
+    {
+        pthread_mutex_unlock(&queue_lock);
+        close_connection(j->fd);
+        free(j->payload);
+        free(j);
+        return;
+    }
+    if (queue_tail)
+    {
+        queue_tail->next = j;
+    }
+    else
+    {
+        queue_head = j;
+    }
+    queue_tail = j;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+/* le e valida um pedido; retorna NULL (e fecha a conexao) se for invalido */
+static job* read_job(int fd)
+{
+    job* j = (job*)calloc(1, sizeof(job));
+    if (!j)
+    {
+        close_connection(fd);
+        return NULL;
+    }
+    j->fd = fd;
+    if (read_all(fd, &j->req, sizeof(j->req)) != 0 || j->req.magic != REQUEST_MAGIC ||
+        j->req.version != PROTOCOL_VERSION || j->req.path_len > MAX_PATH_LEN || j->req.k > MAX_K)
+    {
+        goto invalid;
+    }
+    if (read_all(fd, j->path, j->req.path_len) != 0)
+    {
+        goto invalid;
+    }
+    j->path[j->req.path_len] = '\0';
+
+    if (j->req.op != OP_SHUTDOWN && j->req.k == 0)
+    {
+        goto invalid;
+    }
+
+    if (j->req.op == OP_PREDICT)
+    {
+        if (j->req.points > MAX_POINTS)
+        {
+            goto invalid; /* limita o corpo e evita overflow em 2 * (k + points) doubles */
+        }
+        size_t doubles = 2 * ((size_t)j->req.k + (size_t)j->req.points);
+        j->payload = (double*)malloc(sizeof(double) * doubles);
+        if (!j->payload || read_all(fd, j->payload, sizeof(double) * doubles) != 0)
+        {
+            goto invalid;
+        }
+    }
+    else if (j->req.op != OP_FIT && j->req.op != OP_SHUTDOWN)
+    {
+        goto invalid;
+    }
+    return j;
+
+invalid:
+    fprintf(stderr, "Pedido invalido descartado.\n");
+    free(j->payload);
+    free(j);
+    close_connection(fd);
+    return NULL;
+}
+
+static int make_address(const char* socket_path, struct sockaddr_un* addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr->sun_path))
+    {
+        fprintf(stderr, "Caminho de socket muito longo: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(addr->sun_path, socket_path);
+    return 0;
+}
+
+/* para o laco de aceitacao e a thread de trabalho (que esvazia a fila antes de sair) */
+static void request_shutdown(void)
+{
+    pthread_mutex_lock(&queue_lock);
+    shutting_down = 1;
+    pthread_cond_signal(&queue_cond);
+    pthread_cond_broadcast(&connections_cond);
+    pthread_mutex_unlock(&queue_lock);
+    shutdown(listen_fd, SHUT_RDWR); /* acorda o accept */
+}
+
+/* thread por conexao: le o pedido inteiro fora da thread de aceitacao */
+static void* reader_main(void* arg)
+{
+    int fd = (int)(intptr_t)arg;
+    job* j = read_job(fd);
+    if (!j)
+    {
+        return NULL;
+    }
+    if (j->req.op == OP_SHUTDOWN)
+    {
+        close_connection(j->fd);
+        free(j);
+        request_shutdown();
+        return NULL;
+    }
+    enqueue(j);
+    return NULL;
+}
+
+static int serve(const char* socket_path)
+{
+    struct sockaddr_un addr;
+    if (make_address(socket_path, &addr) != 0)
+    {
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN); /* cliente que desconecta cedo nao derruba o daemon */
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, 64) != 0)
+    {
+        perror("socket");
+        return 1;
+    }
+
+    pthread_t worker;
+    pthread_create(&worker, NULL, worker_main, NULL);
+    printf("K-Means daemon em %s (threads OpenMP: %d)\n", socket_path, omp_get_max_threads());
+    fflush(stdout);
+
+    for (;;)
+    {
+        /* espera uma vaga; conexoes excedentes ficam no backlog do listen */
+        pthread_mutex_lock(&queue_lock);
+        while (open_connections >= MAX_CONNECTIONS && !shutting_down)
+        {
+            pthread_cond_wait(&connections_cond, &queue_lock);
+        }
+        int down = shutting_down;
+        pthread_mutex_unlock(&queue_lock);
+        if (down)
+        {
+            break;
+        }
+
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (!is_shutting_down())
+            {
+                perror("accept");
+            }
+            break;
+        }
+        pthread_mutex_lock(&queue_lock);
+        open_connections++;
+        pthread_mutex_unlock(&queue_lock);
+
+        struct timeval timeout = {READ_TIMEOUT_S, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        pthread_t reader;
+        if (pthread_create(&reader, NULL, reader_main, (void*)(intptr_t)fd) != 0)
+        {
+            fprintf(stderr, "Erro ao criar thread leitora; conexao descartada.\n");
+            close_connection(fd);
+            continue;
+        }
+        pthread_detach(reader);
+    }
+    request_shutdown(); /* accept falhou por outro motivo: encerra do mesmo jeito */
+
+    pthread_join(worker, NULL);
+
+    /* leitoras ainda abertas terminam em ate READ_TIMEOUT_S e descartam o pedido */
+    pthread_mutex_lock(&queue_lock);
+    while (open_connections > 0)
+    {
+        pthread_cond_wait(&connections_cond, &queue_lock);
+    }
+    pthread_mutex_unlock(&queue_lock);
+    close(listen_fd);
+    unlink(socket_path);
+    for (int i = 0; i < DATASET_CACHE_SIZE; i++)
+    {
+        free(dataset_cache[i].observations);
+    }
+    printf("K-Means daemon encerrado.\n");
+    return 0;
+}
+
+/* ---- cliente ---- */
+
+static int connect_daemon(const char* socket_path)
+{
+    struct sockaddr_un addr;
+    if (make_address(socket_path, &addr) != 0)
+    {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        perror("connect");
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+static int send_request(int fd, uint16_t op, const char* path, uint32_t k, uint64_t seed)
+{
+    kmeans_request req;
+    memset(&req, 0, sizeof(req));
+    req.magic = REQUEST_MAGIC;
+    req.version = PROTOCOL_VERSION;
+    req.op = op;
+    req.k = k;
+    req.seed = seed;
+    req.path_len = path ? (uint32_t)strlen(path) : 0;
+    if (write_all(fd, &req, sizeof(req)) != 0)
+    {
+        return -1;
+    }
+    return req.path_len ? write_all(fd, path, req.path_len) : 0;
+}
+
+/* um FIT; `clusters` pode ser NULL. Retorna a latencia ida e volta em ns, ou 0 em erro */
+static uint64_t client_fit(const char* socket_path, const char* path, uint32_t k, uint64_t seed,
+                           kmeans_response* resp, kmeans_wire_cluster* clusters)
+{
+    uint64_t start = now_ns();
+    int fd = connect_daemon(socket_path);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    kmeans_wire_cluster tmp[MAX_K];
+    if (send_request(fd, OP_FIT, path, k, seed) != 0 || read_all(fd, resp, sizeof(*resp)) != 0 ||
+        resp->magic != RESPONSE_MAGIC || resp->status != 0 || resp->k > MAX_K ||
+        read_all(fd, clusters ? clusters : tmp, sizeof(kmeans_wire_cluster) * resp->k) != 0)
+    {
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    return now_ns() - start;
+}
+
+/* PREDICT de `m` pontos (x, y intercalados) contra k centroides; retorna ida e volta em ns */
+static uint64_t client_predict(const char* socket_path, const double* centroids, uint32_t k,
+                               const double* points, uint64_t m, kmeans_response* resp,
+                               int32_t* labels)
+{
+    uint64_t start = now_ns();
+    int fd = connect_daemon(socket_path);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    kmeans_request req;
+    memset(&req, 0, sizeof(req));
+    req.magic = REQUEST_MAGIC;
+    req.version = PROTOCOL_VERSION;
+    req.op = OP_PREDICT;
+    req.k = k;
+    req.points = m;
+    if (write_all(fd, &req, sizeof(req)) != 0 ||
+        write_all(fd, centroids, sizeof(double) * 2 * k) != 0 ||
+        write_all(fd, points, sizeof(double) * 2 * m) != 0 ||
+        read_all(fd, resp, sizeof(*resp)) != 0 || resp->magic != RESPONSE_MAGIC ||
+        resp->status != 0 || resp->n != m ||
+        read_all(fd, labels, sizeof(int32_t) * m) != 0)
+    {
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    return now_ns() - start;
+}
+
+/* fit no daemon e em seguida predict das linhas (sem replicacao) do mesmo CSV */
+static int predict_file(const char* socket_path, const char* path, uint32_t k)
+{
+    kmeans_response resp;
+    kmeans_wire_cluster clusters[MAX_K];
+    if (!client_fit(socket_path, path, k, (uint64_t)time(NULL), &resp, clusters))
+    {
+        fprintf(stderr, "Fit falhou.\n");
+        return 1;
+    }
+
+    FILE* f = fopen(path, "r");
+    if (!f)
+    {
+        fprintf(stderr, "Erro ao abrir %s.\n", path);
+        return 1;
+    }
+    char buffer[512];
+    size_t capacity = 1024, m = 0;
+    double* points = (double*)malloc(sizeof(double) * 2 * capacity);
+    if (!points)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        fclose(f);
+        return 1;
+    }
+    if (!fgets(buffer, sizeof(buffer), f)) /* descarta cabecalho */
+    {
+        m = 0;
+    }
+    while (fgets(buffer, sizeof(buffer), f))
+    {
+        double x, y;
+        if (!parse_csv_line(buffer, &x, &y))
+        {
+            continue;
+        }
+        if (m >= capacity)
+        {
+            double* grown = (double*)realloc(points, sizeof(double) * 4 * capacity);
+            if (!grown)
+            {
+                fprintf(stderr, "Erro de memoria.\n");
+                free(points);
+                fclose(f);
+                return 1;
+            }
+            points = grown;
+            capacity *= 2;
+        }
+        points[2 * m] = x;
+        points[2 * m + 1] = y;
+        m++;
+    }
+    fclose(f);
+
+    double centroids[2 * MAX_K];
+    for (uint32_t c = 0; c < resp.k; c++)
+    {
+        centroids[2 * c] = clusters[c].x;
+        centroids[2 * c + 1] = clusters[c].y;
+    }
+
+    int32_t* labels = (int32_t*)malloc(sizeof(int32_t) * (m ? m : 1));
+    if (!labels)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        free(points);
+        return 1;
+    }
+    uint64_t rtt = client_predict(socket_path, centroids, resp.k, points, m, &resp, labels);
+    if (!rtt)
+    {
+        fprintf(stderr, "Predict falhou.\n");
+        free(points);
+        free(labels);
+        return 1;
+    }
+
+    uint64_t counts[MAX_K] = {0};
+    for (size_t i = 0; i < m; i++)
+    {
+        counts[labels[i]]++;
+    }
+    printf("Predict de %zu pontos: fila %.3f ms, calculo %.3f ms, ida e volta %.3f ms\n",
+           m, resp.queue_ns / 1e6, resp.compute_ns / 1e6, rtt / 1e6);
+    for (uint32_t c = 0; c < resp.k; c++)
+    {
+        printf("Cluster %u: centroid (%.4f, %.4f), pontos=%llu\n", c,
+               centroids[2 * c], centroids[2 * c + 1], (unsigned long long)counts[c]);
+    }
+
+    free(points);
+    free(labels);
+    return 0;
+}
+
+static int compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(uint64_t* v, int n, double p)
+{
+    qsort(v, (size_t)n, sizeof(uint64_t), compare_u64);
+    int idx = (int)(p * (n - 1) + 0.5);
+    return (double)v[idx] / 1e6;
+}
+
+static int bench(const char* socket_path, const char* path, uint32_t k, int requests)
+{
+    uint64_t* total = (uint64_t*)malloc(sizeof(uint64_t) * requests);
+    uint64_t* queue = (uint64_t*)malloc(sizeof(uint64_t) * requests);
+    uint64_t* compute = (uint64_t*)malloc(sizeof(uint64_t) * requests);
+    kmeans_response resp;
+    int rc = 1;
+    if (!total || !queue || !compute)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        goto done;
+    }
+
+    /* primeiro pedido carrega a base no daemon; fica fora das estatisticas */
+    if (!client_fit(socket_path, path, k, 1, &resp, NULL))
+    {
+        fprintf(stderr, "Falha no pedido de aquecimento.\n");
+        goto done;
+    }
+    printf("Aquecimento: carga + fit em %.3f ms (cache %s)\n",
+           resp.compute_ns / 1e6, resp.cache_hit ? "quente" : "frio");
+
+    for (int i = 0; i < requests; i++)
+    {
+        total[i] = client_fit(socket_path, path, k, (uint64_t)i + 2, &resp, NULL);
+        if (!total[i])
+        {
+            fprintf(stderr, "Falha no pedido %d.\n", i);
+            goto done;
+        }
+        queue[i] = resp.queue_ns;
+        compute[i] = resp.compute_ns;
+    }
+
+    printf("K-Means daemon: %d fits repetidos sobre %s (k=%u, n=%llu)\n",
+           requests, path, k, (unsigned long long)resp.n);
+    printf("Ida e volta -> p50: %.3f ms, p99: %.3f ms\n",
+           percentile_ms(total, requests, 0.50), percentile_ms(total, requests, 0.99));
+    printf("Fila        -> p50: %.3f ms, p99: %.3f ms\n",
+           percentile_ms(queue, requests, 0.50), percentile_ms(queue, requests, 0.99));
+    printf("Calculo     -> p50: %.3f ms, p99: %.3f ms\n",
+           percentile_ms(compute, requests, 0.50), percentile_ms(compute, requests, 0.99));
+    rc = 0;
+
+done:
+    free(total);
+    free(queue);
+    free(compute);
+    return rc;
+}
+
+int main(int argc, char** argv)
+{
+    const char* mode = argc > 1 ? argv[1] : "serve";
+    const char* socket_path = argc > 2 ? argv[2] : DEFAULT_SOCKET;
+    const char* path = argc > 3 ? argv[3] : "Instagram_visits_clustering.csv";
+    uint32_t k = argc > 4 ? (uint32_t)atoi(argv[4]) : 5;
+
+    if (strcmp(mode, "serve") == 0)
+    {
+        return serve(socket_path);
+    }
+
+    if (strcmp(mode, "fit") == 0)
+    {
+        uint64_t seed = argc > 5 ? strtoull(argv[5], NULL, 10) : (uint64_t)time(NULL);
+        kmeans_response resp;
+        kmeans_wire_cluster clusters[MAX_K];
+        if (k == 0 || k > MAX_K)
+        {
+            fprintf(stderr, "k invalido.\n");
+            return 1;
+        }
+        uint64_t rtt = client_fit(socket_path, path, k, seed, &resp, clusters);
+        if (!rtt)
+        {
+            fprintf(stderr, "Pedido falhou.\n");
+            return 1;
+        }
+        printf("Observacoes efetivas: %llu, clusters: %u, iteracoes: %u\n",
+               (unsigned long long)resp.n, resp.k, resp.iterations);
+        printf("Latencia: fila %.3f ms, calculo %.3f ms, ida e volta %.3f ms (cache %s)\n",
+               resp.queue_ns / 1e6, resp.compute_ns / 1e6, rtt / 1e6, resp.cache_hit ? "quente" : "frio");
+        for (uint32_t c = 0; c < resp.k; c++)
+        {
+            printf("Cluster %u: centroid (%.4f, %.4f), pontos=%llu\n", c,
+                   clusters[c].x, clusters[c].y, (unsigned long long)clusters[c].count);
+        }
+        return 0;
+    }
+
+    if (strcmp(mode, "predict") == 0)
+    {
+        if (k == 0 || k > MAX_K)
+        {
+            fprintf(stderr, "k invalido.\n");
+            return 1;
+        }
+        return predict_file(socket_path, path, k);
+    }
+
+    if (strcmp(mode, "bench") == 0)
+    {
+        int requests = argc > 5 ? atoi(argv[5]) : 100;
+        return bench(socket_path, path, k, requests > 0 ? requests : 100);
+    }
+
+    if (strcmp(mode, "stop") == 0)
+    {
+        int fd = connect_daemon(socket_path);
+        if (fd < 0 || send_request(fd, OP_SHUTDOWN, NULL, 0, 0) != 0)
+        {
+            return 1;
+        }
+        close(fd);
+        return 0;
+    }
+
+    fprintf(stderr, "Uso: %s serve|fit|predict|bench|stop [socket] [arquivo] [k] [seed|pedidos]\n", argv[0]);
+    return 1;
+}
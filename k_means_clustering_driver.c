@@ -0,0 +1,1392 @@
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kmeans_active.h"
+#include "kmeans_common.h"
+#include "kmeans_plan.h"
+#include "kmeans_select.h"
+
+// Driver com planejador de memoria: antes de carregar a base, kmeans_plan.h
+// decide layout (double/float/quant16), replicacao fisica ou pesos, e
+// execucao em memoria, em fluxo ou por coreset, a partir do tamanho do
+// arquivo, da replicacao, de D, de k e do orcamento de RAM. O plano e o
+// resultado vao para o relatorio da execucao (stdout e, com --report, um
+// arquivo chave=valor). Se uma alocacao falhar mesmo assim (estimativa
+// errada), a execucao cai para o modo em fluxo em vez de abortar.
+//
+// Com os pontos em memoria (ou no coreset), kmeans_select.h mede uma amostra
+// (dimensao intrinseca, duplicatas, intervalo, separacao dos clusters),
+// calibra os kernels de atribuicao e escolhe o motor (Lloyd completo ou
+// conjunto ativo), o kernel (escalar ou SIMD) e se as duplicatas exatas viram
+// pesos. --engine/--kernel/--dedup sobrepoem a escolha e --compare roda todas
+// as combinacoes de motor e kernel sobre os mesmos pontos.
+//
+// Uso: ./kmeans_driver [arquivo] [--k K] [--replication R] [--budget B]
+//        [--layout double|float|quant16] [--exec memoria|fluxo|coreset]
+//        [--replicate] [--exact] [--seed S] [--report ARQ] [--plan-only]
+//        [--engine auto|lloyd|active] [--kernel auto|scalar|simd]
+//        [--dedup auto|on|off] [--compare]
+
+#define DRIVER_CHUNK 65536                 /* linhas lidas por bloco nas passadas em fluxo */
+#define DECODE_BLOCK KMEANS_KERNEL_BLOCK   /* pontos decodificados por vez no Lloyd ponderado */
+#define ACTIVE_VERIFY SELECT_VERIFY_EVERY  /* iteracoes entre passadas completas do conjunto ativo */
+#define ACTIVE_DENSE 0.5                   /* lista acima dessa fracao: volta as passadas simples */
+#define ACTIVE_MARGIN_ITERS 2              /* iteracoes de deslocamento cobertas pelo limiar */
+
+typedef struct
+{
+    int k;
+    size_t replication;
+    unsigned int seed;
+    const char* report;
+    int plan_only;
+    int engine;          /* -1 = automatico */
+    int kernel;          /* -1 = automatico */
+    int dedup;           /* -1 = automatico */
+    int compare;
+} driver_options;
+
+typedef struct
+{
+    size_t iterations;
+    double seconds;
+    double sse;          /* custo na base completa (com replicacao) */
+    size_t points;       /* pontos materializados */
+    int fell_back;       /* alocacao falhou e a execucao caiu para fluxo */
+    int selected;        /* houve selecao de motor (execucao em memoria ou coreset) */
+    size_t deduped;      /* pontos antes da deduplicacao (0 = sem deduplicacao) */
+    size_t full_passes;  /* passadas completas do conjunto ativo */
+    double compare_seconds; /* tempo do --compare, descontado de seconds */
+    kmeans_data_stats stats;
+    kmeans_select_plan select;
+} driver_result;
+
+/* ---------------------------------------------------------------------- */
+/* leitura do CSV em blocos                                               */
+/* ---------------------------------------------------------------------- */
+
+typedef struct
+{
+    FILE* f;
+    double* x;
+    double* y;
+    size_t rows_read;
+} csv_reader;
+
+static int csv_open(csv_reader* r, const char* filename)
+{
+    char buffer[512];
+    memset(r, 0, sizeof(*r));
+    r->f = fopen(filename, "r");
+    if (!r->f)
+    {
+        return -1;
+    }
+    r->x = (double*)malloc(sizeof(double) * DRIVER_CHUNK);
+    r->y = (double*)malloc(sizeof(double) * DRIVER_CHUNK);
+    if (!r->x || !r->y || !fgets(buffer, sizeof(buffer), r->f))
+    {
+        fclose(r->f);
+        free(r->x);
+        free(r->y);
+        return -1;
+    }
+    return 0;
+}
+
+/* proximo bloco de ate DRIVER_CHUNK linhas; retorna quantas */
+static size_t csv_next(csv_reader* r)
+{
+    char buffer[512];
+    size_t n = 0;
+    while (n < DRIVER_CHUNK && fgets(buffer, sizeof(buffer), r->f))
+    {
+        if (parse_csv_line(buffer, &r->x[n], &r->y[n]))
+        {
+            n++;
+        }
+    }
+    r->rows_read += n;
+    return n;
+}
+
+static void csv_close(csv_reader* r)
+{
+    fclose(r->f);
+    free(r->x);
+    free(r->y);
+}
+
+/* rotulo inicial "aleatorio" de uma linha, reprodutivel entre passadas */
+static inline int initial_label(size_t row, unsigned int seed, int k)
+{
+    unsigned long long h = (unsigned long long)row * 0x9E3779B97F4A7C15ull + seed;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return (int)(h % (unsigned long long)k);
+}
+
+static inline int nearest_xy(double x, double y, const cluster* clusters, int k)
+{
+    observation o = {x, y, 0};
+    return calculateNearest(&o, clusters, k);
+}
+
+/* ---------------------------------------------------------------------- */
+/* conjunto de pontos em memoria (layout escolhido + pesos opcionais)      */
+/* ---------------------------------------------------------------------- */
+
+typedef struct
+{
+    kmeans_layout layout;
+    size_t n;
+    double* xd;
+    double* yd;
+    float* xf;
+    float* yf;
+    unsigned short* xq;
+    unsigned short* yq;
+    double qx0, qy0, qsx, qsy; /* v = q0 + q * qs */
+    double* w;                 /* NULL = peso 1 */
+    int* label;
+} point_set;
+
+static void point_set_free(point_set* ps)
+{
+    free(ps->xd);
+    free(ps->yd);
+    free(ps->xf);
+    free(ps->yf);
+    free(ps->xq);
+    free(ps->yq);
+    free(ps->w);
+    free(ps->label);
+    memset(ps, 0, sizeof(*ps));
+}
+
+static int point_set_alloc(point_set* ps, kmeans_layout layout, size_t n, int weighted)
+{
+    memset(ps, 0, sizeof(*ps));
+    ps->layout = layout;
+    ps->n = n;
+    int ok = 1;
+    if (layout == KMEANS_LAYOUT_DOUBLE)
+    {
+        ps->xd = (double*)malloc(sizeof(double) * n);
+        ps->yd = (double*)malloc(sizeof(double) * n);
+        ok = ps->xd && ps->yd;
+    }
+    else if (layout == KMEANS_LAYOUT_FLOAT)
+    {
+        ps->xf = (float*)malloc(sizeof(float) * n);
+        ps->yf = (float*)malloc(sizeof(float) * n);
+        ok = ps->xf && ps->yf;
+    }
+    else
+    {
+        ps->xq = (unsigned short*)malloc(sizeof(unsigned short) * n);
+        ps->yq = (unsigned short*)malloc(sizeof(unsigned short) * n);
+        ok = ps->xq && ps->yq;
+    }
+    ps->label = (int*)malloc(sizeof(int) * n);
+    ok = ok && ps->label;
+    if (weighted)
+    {
+        ps->w = (double*)malloc(sizeof(double) * n);
+        ok = ok && ps->w;
+    }
+    if (!ok)
+    {
+        point_set_free(ps);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void point_set_store(point_set* ps, size_t i, double x, double y)
+{
+    if (ps->layout == KMEANS_LAYOUT_DOUBLE)
+    {
+        ps->xd[i] = x;
+        ps->yd[i] = y;
+    }
+    else if (ps->layout == KMEANS_LAYOUT_FLOAT)
+    {
+        ps->xf[i] = (float)x;
+        ps->yf[i] = (float)y;
+    }
+    else
+    {
+        ps->xq[i] = (unsigned short)lround((x - ps->qx0) / ps->qsx);
+        ps->yq[i] = (unsigned short)lround((y - ps->qy0) / ps->qsy);
+    }
+}
+
+/* decodifica [begin, begin + count) para double */
+static inline void point_set_decode(const point_set* ps, size_t begin, size_t count, double* bx, double* by)
+{
+    if (ps->layout == KMEANS_LAYOUT_DOUBLE)
+    {
+        memcpy(bx, ps->xd + begin, sizeof(double) * count);
+        memcpy(by, ps->yd + begin, sizeof(double) * count);
+    }
+    else if (ps->layout == KMEANS_LAYOUT_FLOAT)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            bx[i] = ps->xf[begin + i];
+            by[i] = ps->yf[begin + i];
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            bx[i] = ps->qx0 + ps->xq[begin + i] * ps->qsx;
+            by[i] = ps->qy0 + ps->yq[begin + i] * ps->qsy;
+        }
+    }
+}
+
+/*
+ * Le a base no layout do plano. Com `replication` > 1 e pesos, cada linha
+ * entra uma vez com peso = replicacao; sem pesos, replica fisicamente. O
+ * layout quantizado precisa de uma passada previa para o intervalo.
+ */
+static int load_point_set(const char* filename, const kmeans_plan* plan, size_t replication,
+                          point_set* ps)
+{
+    double min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    size_t rows = 0;
+    csv_reader r;
+    if (csv_open(&r, filename) != 0)
+    {
+        return -1;
+    }
+    for (size_t n; (n = csv_next(&r)) > 0;)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            min_x = fmin(min_x, r.x[i]);
+            max_x = fmax(max_x, r.x[i]);
+            min_y = fmin(min_y, r.y[i]);
+            max_y = fmax(max_y, r.y[i]);
+        }
+        rows += n;
+    }
+    csv_close(&r);
+    if (rows == 0)
+    {
+        return -1;
+    }
+
+    size_t copies = plan->weighted ? 1 : replication;
+    if (point_set_alloc(ps, plan->layout, rows * copies, plan->weighted) != 0)
+    {
+        return -2;
+    }
+    ps->qx0 = min_x;
+    ps->qy0 = min_y;
+    ps->qsx = max_x > min_x ? (max_x - min_x) / 65535.0 : 1.0;
+    ps->qsy = max_y > min_y ? (max_y - min_y) / 65535.0 : 1.0;
+
+    if (csv_open(&r, filename) != 0)
+    {
+        point_set_free(ps);
+        return -1;
+    }
+    size_t row = 0;
+    for (size_t n; (n = csv_next(&r)) > 0;)
+    {
+        for (size_t i = 0; i < n && row + i < rows; i++)
+        {
+            for (size_t c = 0; c < copies; c++)
+            {
+                /* mesmo esquema das versoes originais: copia c inteira depois da c - 1 */
+                point_set_store(ps, c * rows + row + i, r.x[i], r.y[i]);
+            }
+            if (ps->w)
+            {
+                ps->w[row + i] = (double)replication;
+            }
+        }
+        row += n;
+    }
+    csv_close(&r);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Lloyd ponderado sobre um point_set                                     */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * Soma ponderada por grupo (buffers por thread); clusters[c].count recebe o
+ * peso arredondado. Com COMPENSATED_SUM cada bloco de DECODE_BLOCK pontos
+ * soma de forma ingenua e os parciais passam pela soma de Neumaier, como em
+ * kMeans_omp_accumulate_compensated. Retorna -1 sem memoria para os buffers.
+ */
+static int weighted_update(const point_set* ps, int k, cluster* clusters, double* weight)
+{
+    int nthreads = omp_get_max_threads();
+    /* 9k por thread (somas, compensacao, parcial do bloco) + 3k de compensacao entre threads */
+    double* scratch = (double*)calloc((9 * (size_t)nthreads + 3) * (size_t)k, sizeof(double));
+    if (!scratch)
+    {
+        return -1;
+    }
+    double* comp = scratch + 9 * (size_t)nthreads * k;
+    for (int c = 0; c < k; c++)
+    {
+        clusters[c].x = 0.0;
+        clusters[c].y = 0.0;
+        weight[c] = 0.0;
+    }
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        /* [0,k) x, [k,2k) y, [2k,3k) peso; depois compensacao e parcial do bloco */
+        double* sx = scratch + (size_t)omp_get_thread_num() * 9 * k;
+        double* sy = sx + k;
+        double* sw = sy + k;
+#if COMPENSATED_SUM
+        double* acc = sx + 6 * k;
+#else
+        double* acc = sx;
+#endif
+        double bx[DECODE_BLOCK], by[DECODE_BLOCK];
+
+        #pragma omp for schedule(static)
+        for (size_t b = 0; b < ps->n; b += DECODE_BLOCK)
+        {
+            size_t count = ps->n - b < DECODE_BLOCK ? ps->n - b : DECODE_BLOCK;
+            point_set_decode(ps, b, count, bx, by);
+            for (size_t i = 0; i < count; i++)
+            {
+                int g = ps->label[b + i];
+                double w = ps->w ? ps->w[b + i] : 1.0;
+                acc[g] += w * bx[i];
+                acc[k + g] += w * by[i];
+                acc[2 * k + g] += w;
+            }
+#if COMPENSATED_SUM
+            for (int c = 0; c < 3 * k; c++)
+            {
+                neumaier_add(&sx[c], &sx[3 * k + c], acc[c]);
+                acc[c] = 0.0;
+            }
+#endif
+        }
+
+        #pragma omp critical
+        {
+            for (int c = 0; c < k; c++)
+            {
+#if COMPENSATED_SUM
+                neumaier_add(&clusters[c].x, &comp[c], sx[c] + sx[3 * k + c]);
+                neumaier_add(&clusters[c].y, &comp[k + c], sy[c] + sx[4 * k + c]);
+                neumaier_add(&weight[c], &comp[2 * k + c], sw[c] + sx[5 * k + c]);
+#else
+                clusters[c].x += sx[c];
+                clusters[c].y += sy[c];
+                weight[c] += sw[c];
+#endif
+            }
+        }
+    }
+
+    for (int c = 0; c < k; c++)
+    {
+        clusters[c].x += comp[c];
+        clusters[c].y += comp[k + c];
+        weight[c] += comp[2 * k + c];
+        if (weight[c] > 0.0)
+        {
+            clusters[c].x /= weight[c];
+            clusters[c].y /= weight[c];
+        }
+        clusters[c].count = (size_t)llround(weight[c]);
+    }
+    free(scratch);
+    return 0;
+}
+
+/* reatribuicao com o kernel escolhido; retorna o peso dos pontos que trocaram de grupo */
+static double weighted_assign(point_set* ps, const cluster* clusters, int k, kmeans_kernel kernel)
+{
+    double changed = 0.0;
+
+    #pragma omp parallel for reduction(+ : changed) schedule(static)
+    for (size_t b = 0; b < ps->n; b += DECODE_BLOCK)
+    {
+        double bx[DECODE_BLOCK], by[DECODE_BLOCK];
+        int fresh[DECODE_BLOCK];
+        size_t count = ps->n - b < DECODE_BLOCK ? ps->n - b : DECODE_BLOCK;
+        point_set_decode(ps, b, count, bx, by);
+        kmeans_nearest_block(kernel, bx, by, count, clusters, k, fresh, NULL);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (fresh[i] != ps->label[b + i])
+            {
+                changed += ps->w ? ps->w[b + i] : 1.0;
+                ps->label[b + i] = fresh[i];
+            }
+        }
+    }
+    return changed;
+}
+
+/* particao aleatoria reprodutivel; retorna o peso total */
+static double weighted_partition(point_set* ps, int k, unsigned int seed)
+{
+    double total = 0.0;
+    for (size_t i = 0; i < ps->n; i++)
+    {
+        ps->label[i] = (int)(rand_r(&seed) % (unsigned int)k);
+        total += ps->w ? ps->w[i] : 1.0;
+    }
+    return total;
+}
+
+/*
+ * Particao aleatoria + Lloyd; mesmo criterio de parada (peso que trocou <=
+ * total / 10000). Retorna 0, ou -1 sem memoria.
+ */
+static int weighted_lloyd(point_set* ps, int k, unsigned int seed, kmeans_kernel kernel, cluster* clusters,
+                          size_t* iterations)
+{
+    double* weight = (double*)malloc(sizeof(double) * k);
+    if (!weight)
+    {
+        return -1;
+    }
+    double minAcceptedError = floor(weighted_partition(ps, k, seed) / 10000.0);
+    double changed;
+    size_t iters = 0;
+    do
+    {
+        if (weighted_update(ps, k, clusters, weight) != 0)
+        {
+            free(weight);
+            return -1;
+        }
+        changed = weighted_assign(ps, clusters, k, kernel);
+        iters++;
+    } while (changed > minAcceptedError);
+
+    free(weight);
+    *iterations = iters;
+    return 0;
+}
+
+/*
+ * Passada do conjunto ativo (ver k_means_clustering_omp_active.c): reatribui
+ * a lista `active` (ou todos os pontos) em blocos e aplica as trocas as somas
+ * ponderadas (sums: x, y, peso) com deltas por thread (`deltas`: 3k por
+ * thread, para `nthreads` threads). Com `keep` marca quem continua instavel
+ * (trocou agora ou margem abaixo do limiar).
+ */
+static double active_pass(point_set* ps, const size_t* active, size_t n_active, int k, kmeans_kernel kernel,
+                          const cluster* clusters, double threshold, unsigned char* keep, double* sums,
+                          double* deltas, int nthreads)
+{
+    double changed = 0.0;
+
+    #pragma omp parallel reduction(+ : changed) num_threads(nthreads)
+    {
+        double* d = deltas + (size_t)omp_get_thread_num() * 3 * k;
+        memset(d, 0, sizeof(double) * 3 * k);
+        double bx[DECODE_BLOCK], by[DECODE_BLOCK], margin[DECODE_BLOCK];
+        int fresh[DECODE_BLOCK];
+
+        #pragma omp for schedule(static)
+        for (size_t b = 0; b < n_active; b += DECODE_BLOCK)
+        {
+            size_t count = n_active - b < DECODE_BLOCK ? n_active - b : DECODE_BLOCK;
+            if (active)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    point_set_decode(ps, active[b + i], 1, &bx[i], &by[i]);
+                }
+            }
+            else
+            {
+                point_set_decode(ps, b, count, bx, by);
+            }
+            kmeans_nearest_block(kernel, bx, by, count, clusters, k, fresh, keep ? margin : NULL);
+            for (size_t i = 0; i < count; i++)
+            {
+                size_t j = active ? active[b + i] : b + i;
+                int old = ps->label[j];
+                int g = fresh[i];
+                if (g != old)
+                {
+                    double w = ps->w ? ps->w[j] : 1.0;
+                    d[old] -= w * bx[i];
+                    d[k + old] -= w * by[i];
+                    d[2 * k + old] -= w;
+                    d[g] += w * bx[i];
+                    d[k + g] += w * by[i];
+                    d[2 * k + g] += w;
+                    ps->label[j] = g;
+                    changed += w;
+                }
+                if (keep)
+                {
+                    keep[b + i] = g != old || margin[i] < threshold;
+                }
+            }
+        }
+
+        #pragma omp critical
+        {
+            for (int c = 0; c < 3 * k; c++)
+            {
+                sums[c] += d[c];
+            }
+        }
+    }
+    return changed;
+}
+
+/*
+ * Conjunto ativo ponderado, mesma particao inicial e mesmo criterio de
+ * parada de weighted_lloyd; so declara convergencia depois de uma passada
+ * completa. `full_passes` recebe quantas passadas varreram a base inteira.
+ * Retorna 0, ou -1 sem memoria.
+ */
+static int weighted_active(point_set* ps, int k, unsigned int seed, kmeans_kernel kernel, cluster* clusters,
+                           size_t* iterations, size_t* full_passes)
+{
+    size_t n = ps->n;
+    int nthreads = omp_get_max_threads();
+    unsigned char* keep = (unsigned char*)malloc(n);
+    size_t* active = (size_t*)malloc(sizeof(size_t) * n);
+    size_t* next = (size_t*)malloc(sizeof(size_t) * n);
+    double* sums = (double*)malloc(sizeof(double) * 3 * k);
+    double* deltas = (double*)malloc(sizeof(double) * 3 * (size_t)k * nthreads);
+    double total = weighted_partition(ps, k, seed);
+    double minAcceptedError = floor(total / 10000.0);
+    if (!keep || !active || !next || !sums || !deltas || weighted_update(ps, k, clusters, sums + 2 * k) != 0)
+    {
+        /* sem memoria para a lista: Lloyd completo (que tambem pode falhar) */
+        free(keep);
+        free(active);
+        free(next);
+        free(sums);
+        free(deltas);
+        *full_passes = 0;
+        return weighted_lloyd(ps, k, seed, kernel, clusters, iterations);
+    }
+
+    for (int c = 0; c < k; c++)
+    {
+        sums[c] = clusters[c].x * sums[2 * k + c];
+        sums[k + c] = clusters[c].y * sums[2 * k + c];
+    }
+
+    kmeans_active_schedule sched;
+    kmeans_active_init(&sched, ACTIVE_VERIFY, ACTIVE_DENSE, SELECT_DENSE_EXIT, ACTIVE_MARGIN_ITERS);
+    size_t n_active = 0;
+    size_t iters = 0;
+    *full_passes = 0;
+
+    for (;;)
+    {
+        double drift = 0.0;
+        for (int c = 0; c < k; c++)
+        {
+            double w = sums[2 * k + c];
+            double x = w > 0.0 ? sums[c] / w : 0.0;
+            double y = w > 0.0 ? sums[k + c] / w : 0.0;
+            drift = fmax(drift, hypot(x - clusters[c].x, y - clusters[c].y));
+            clusters[c].x = x;
+            clusters[c].y = y;
+            clusters[c].count = w > 0.0 ? (size_t)llround(w) : 0;
+        }
+        iters++;
+
+        double threshold;
+        int full = kmeans_active_begin(&sched, drift, &threshold);
+        double changed;
+        if (full)
+        {
+            unsigned char* marks = kmeans_active_wants_marks(&sched) ? keep : NULL;
+            changed = active_pass(ps, NULL, n, k, kernel, clusters, threshold, marks, sums, deltas, nthreads);
+            (*full_passes)++;
+            if (changed <= minAcceptedError)
+            {
+                break;
+            }
+            if (marks)
+            {
+                n_active = kmeans_compact(NULL, keep, n, active);
+            }
+            kmeans_active_after_full(&sched, changed, total, marks != NULL, n_active, n);
+        }
+        else
+        {
+            changed = active_pass(ps, active, n_active, k, kernel, clusters, threshold, keep, sums, deltas,
+                                  nthreads);
+            n_active = kmeans_compact(active, keep, n_active, next);
+            size_t* tmp = active;
+            active = next;
+            next = tmp;
+            kmeans_active_after_list(&sched, changed <= minAcceptedError);
+        }
+        kmeans_active_freeze(&sched, threshold);
+    }
+
+    free(keep);
+    free(active);
+    free(next);
+    free(sums);
+    free(deltas);
+    *iterations = iters;
+    return 0;
+}
+
+/* roda o motor escolhido; retorna 0, ou -1 sem memoria */
+static int run_engine(point_set* ps, int k, unsigned int seed, kmeans_engine engine, kmeans_kernel kernel,
+                      cluster* clusters, size_t* iterations, size_t* full_passes)
+{
+    if (engine == KMEANS_ENGINE_ACTIVE)
+    {
+        return weighted_active(ps, k, seed, kernel, clusters, iterations, full_passes);
+    }
+    *full_passes = 0;
+    return weighted_lloyd(ps, k, seed, kernel, clusters, iterations);
+}
+
+/* ---------------------------------------------------------------------- */
+/* selecao do motor e deduplicacao                                        */
+/* ---------------------------------------------------------------------- */
+
+/* amostra espacada do point_set, estatisticas, calibracao e modelo de custo */
+static int select_engine(const point_set* ps, int k, unsigned int seed, kmeans_data_stats* st,
+                         kmeans_select_plan* sel)
+{
+    size_t m = ps->n < SELECT_SAMPLE ? ps->n : SELECT_SAMPLE;
+    double* sx = (double*)malloc(sizeof(double) * m);
+    double* sy = (double*)malloc(sizeof(double) * m);
+    cluster* centroids = (cluster*)calloc(k, sizeof(cluster));
+    if (!sx || !sy || !centroids || m == 0)
+    {
+        free(sx);
+        free(sy);
+        free(centroids);
+        return -1;
+    }
+    double stride = (double)ps->n / (double)m;
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < m; i++)
+    {
+        point_set_decode(ps, (size_t)(i * stride), 1, &sx[i], &sy[i]);
+    }
+
+    kmeans_sample_stats(sx, sy, m, k, seed, st, centroids);
+    double ns_scalar = kmeans_calibrate_kernel(KMEANS_KERNEL_SCALAR, sx, sy, m, centroids, k, 0);
+    double ns_simd = kmeans_calibrate_kernel(KMEANS_KERNEL_SIMD, sx, sy, m, centroids, k, 0);
+    kmeans_kernel fastest = ns_simd < ns_scalar ? KMEANS_KERNEL_SIMD : KMEANS_KERNEL_SCALAR;
+    double ns_margin = kmeans_calibrate_kernel(fastest, sx, sy, m, centroids, k, 1);
+    double ns_point = kmeans_calibrate_accumulate(sx, sy, m, k);
+    kmeans_select_engine(st, ps->n, k, ns_scalar, ns_simd, ns_margin, ns_point, sel);
+
+    free(sx);
+    free(sy);
+    free(centroids);
+    return 0;
+}
+
+/* duplicatas exatas viram um ponto com a soma dos pesos; -1 sem memoria (nada muda) */
+static int point_set_dedup(point_set* ps)
+{
+    size_t n = ps->n;
+    double* t = (double*)malloc(sizeof(double) * 3 * n);
+    if (!t)
+    {
+        return -1;
+    }
+    if (!ps->w)
+    {
+        ps->w = (double*)malloc(sizeof(double) * n);
+        if (!ps->w)
+        {
+            free(t);
+            return -1;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            ps->w[i] = 1.0;
+        }
+    }
+    #pragma omp parallel for schedule(static)
+    for (size_t b = 0; b < n; b += DECODE_BLOCK)
+    {
+        double bx[DECODE_BLOCK], by[DECODE_BLOCK];
+        size_t count = n - b < DECODE_BLOCK ? n - b : DECODE_BLOCK;
+        point_set_decode(ps, b, count, bx, by);
+        for (size_t i = 0; i < count; i++)
+        {
+            t[3 * (b + i)] = bx[i];
+            t[3 * (b + i) + 1] = by[i];
+            t[3 * (b + i) + 2] = ps->w[b + i];
+        }
+    }
+    qsort(t, n, 3 * sizeof(double), select_cmp_xy);
+
+    size_t u = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (u > 0 && t[3 * i] == t[3 * (u - 1)] && t[3 * i + 1] == t[3 * (u - 1) + 1])
+        {
+            t[3 * (u - 1) + 2] += t[3 * i + 2];
+        }
+        else
+        {
+            memmove(&t[3 * u], &t[3 * i], 3 * sizeof(double));
+            u++;
+        }
+    }
+    for (size_t i = 0; i < u; i++)
+    {
+        point_set_store(ps, i, t[3 * i], t[3 * i + 1]);
+        ps->w[i] = t[3 * i + 2];
+    }
+    ps->n = u;
+    free(t);
+    return 0;
+}
+
+/* roda todas as combinacoes de motor e kernel sobre os mesmos pontos */
+static void compare_engines(point_set* ps, int k, unsigned int seed, const kmeans_select_plan* sel)
+{
+    cluster* clusters = (cluster*)calloc(k, sizeof(cluster));
+    int* reference = (int*)malloc(sizeof(int) * ps->n);
+    if (!clusters || !reference)
+    {
+        fprintf(stderr, "Erro de memoria na comparacao.\n");
+        free(clusters);
+        free(reference);
+        return;
+    }
+    printf("Comparacao de motores (%zu pontos, semente %u):\n", ps->n, seed);
+    for (int e = KMEANS_ENGINE_LLOYD; e <= KMEANS_ENGINE_ACTIVE; e++)
+    {
+        for (int kn = KMEANS_KERNEL_SCALAR; kn <= KMEANS_KERNEL_SIMD; kn++)
+        {
+            size_t full = 0, iters = 0;
+            double start = omp_get_wtime();
+            if (run_engine(ps, k, seed, (kmeans_engine)e, (kmeans_kernel)kn, clusters, &iters, &full) != 0)
+            {
+                fprintf(stderr, "Erro de memoria na comparacao.\n");
+                free(clusters);
+                free(reference);
+                return;
+            }
+            double elapsed = omp_get_wtime() - start;
+            size_t mismatches = 0;
+            if (e == KMEANS_ENGINE_LLOYD && kn == KMEANS_KERNEL_SCALAR)
+            {
+                memcpy(reference, ps->label, sizeof(int) * ps->n);
+            }
+            else
+            {
+                for (size_t i = 0; i < ps->n; i++)
+                {
+                    mismatches += ps->label[i] != reference[i];
+                }
+            }
+            printf("  %-6s %-6s: %.6f s, %zu iteracoes (%zu completas), rotulos diferentes: %zu%s\n",
+                   kmeans_engine_name((kmeans_engine)e), kmeans_kernel_name((kmeans_kernel)kn), elapsed, iters,
+                   e == KMEANS_ENGINE_ACTIVE ? full : iters, mismatches,
+                   (int)sel->engine == e && (int)sel->kernel == kn ? "  <- escolhido" : "");
+        }
+    }
+    free(clusters);
+    free(reference);
+}
+
+static void print_selection(FILE* out, const kmeans_data_stats* st, const kmeans_select_plan* sel)
+{
+    fprintf(out, "Selecao: motor %s, kernel %s%s\n", kmeans_engine_name(sel->engine),
+            kmeans_kernel_name(sel->kernel), sel->dedup ? ", duplicatas como peso" : "");
+    fprintf(out, "  amostra: %zu pontos, dimensao intrinseca %.2f, duplicatas %.1f%%, "
+                 "x em [%.4g, %.4g], y em [%.4g, %.4g]\n",
+            st->sample, st->intrinsic_dim, 100.0 * st->dup_ratio, st->min_x, st->max_x, st->min_y, st->max_y);
+    fprintf(out, "  separacao %.2f (sobreposicao %.1f%%), %.1f%% perto de fronteiras, %zu iteracoes na amostra "
+                 "(%zu densas)\n",
+            st->separation, 100.0 * sel->overlap, 100.0 * st->boundary_frac, st->sample_iters, st->dense_iters);
+    fprintf(out, "  motivo: %s\n", sel->reason);
+}
+
+/*
+ * Seleciona (ou aplica as escolhas de opt), deduplica se for o caso e roda o
+ * motor sobre os pontos ja carregados. Retorna 0, ou -1 sem memoria.
+ */
+static int run_selected(point_set* ps, const driver_options* opt, cluster* clusters, driver_result* res)
+{
+    res->selected = 1;
+    if (select_engine(ps, opt->k, opt->seed, &res->stats, &res->select) != 0)
+    {
+        memset(&res->select, 0, sizeof(res->select));
+        snprintf(res->select.reason, sizeof(res->select.reason), "sem memoria para a amostra; padrao");
+    }
+    kmeans_select_plan* sel = &res->select;
+    if (opt->engine >= 0 || opt->kernel >= 0 || opt->dedup >= 0)
+    {
+        size_t len = strlen(sel->reason);
+        snprintf(sel->reason + len, sizeof(sel->reason) - len, "; sobreposto pela linha de comando");
+        sel->engine = opt->engine >= 0 ? (kmeans_engine)opt->engine : sel->engine;
+        sel->kernel = opt->kernel >= 0 ? (kmeans_kernel)opt->kernel : sel->kernel;
+        sel->dedup = opt->dedup >= 0 ? opt->dedup : sel->dedup;
+    }
+    print_selection(stdout, &res->stats, sel);
+
+    if (sel->dedup)
+    {
+        size_t before = ps->n;
+        if (point_set_dedup(ps) == 0)
+        {
+            res->deduped = before;
+            printf("Deduplicacao: %zu -> %zu pontos\n", before, ps->n);
+        }
+        else
+        {
+            fprintf(stderr, "Erro de memoria na deduplicacao; seguindo sem.\n");
+            sel->dedup = 0;
+        }
+    }
+    if (opt->compare)
+    {
+        double start = omp_get_wtime();
+        compare_engines(ps, opt->k, opt->seed, sel);
+        res->compare_seconds = omp_get_wtime() - start;
+    }
+    res->points = ps->n;
+    return run_engine(ps, opt->k, opt->seed, sel->engine, sel->kernel, clusters, &res->iterations,
+                      &res->full_passes);
+}
+
+/* ---------------------------------------------------------------------- */
+/* execucao em fluxo: Lloyd exato relendo o arquivo                        */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * Cada passada calcula os rotulos L_t (mais proximo de c_t) e acumula por
+ * eles, o que da c_{t+1}. O numero de trocas sai comparando com o mais
+ * proximo de c_{t-1} (ou com o rotulo inicial), sem guardar rotulos.
+ * Retorna 0, -1 se o arquivo nao abre ou -2 sem memoria (ultimo recurso do
+ * driver: nao ha para onde cair).
+ */
+static int stream_lloyd(const char* filename, int k, size_t replication, unsigned int seed,
+                        cluster* clusters, size_t* rows_out, size_t* iterations)
+{
+    int nthreads = omp_get_max_threads();
+    cluster* prev = (cluster*)calloc(k, sizeof(cluster));
+    double* sums = (double*)calloc(3 * (size_t)k, sizeof(double));
+    double* scratch = (double*)malloc(sizeof(double) * 3 * (size_t)k * nthreads); /* somas por thread */
+    *rows_out = 0;
+    if (!prev || !sums || !scratch)
+    {
+        free(prev);
+        free(sums);
+        free(scratch);
+        return -2;
+    }
+    size_t iters = 0;
+    size_t rows = 0;
+    int first = 1;
+    double changed = 0.0;
+    double minAcceptedError = 0.0;
+
+    for (;;)
+    {
+        csv_reader r;
+        if (csv_open(&r, filename) != 0)
+        {
+            /* sem a passada os centroides nao estao convergidos */
+            free(prev);
+            free(sums);
+            free(scratch);
+            return -1;
+        }
+        memset(sums, 0, sizeof(double) * 3 * k);
+        changed = 0.0;
+        size_t row = 0;
+        for (size_t n; (n = csv_next(&r)) > 0; row += n)
+        {
+            #pragma omp parallel num_threads(nthreads)
+            {
+                double* s = scratch + (size_t)omp_get_thread_num() * 3 * k;
+                double local_changed = 0.0;
+                memset(s, 0, sizeof(double) * 3 * k);
+
+                #pragma omp for schedule(static)
+                for (size_t i = 0; i < n; i++)
+                {
+                    int g = first ? initial_label(row + i, seed, k) : nearest_xy(r.x[i], r.y[i], clusters, k);
+                    if (!first)
+                    {
+                        int old = iters == 1 ? initial_label(row + i, seed, k)
+                                             : nearest_xy(r.x[i], r.y[i], prev, k);
+                        local_changed += g != old;
+                    }
+                    s[g] += r.x[i];
+                    s[k + g] += r.y[i];
+                    s[2 * k + g] += 1.0;
+                }
+
+                #pragma omp critical
+                {
+                    for (int c = 0; c < 3 * k; c++)
+                    {
+                        sums[c] += s[c];
+                    }
+                    changed += local_changed;
+                }
+            }
+        }
+        csv_close(&r);
+        rows = row;
+        changed *= (double)replication;
+        minAcceptedError = floor((double)rows * replication / 10000.0);
+
+        if (!first && changed <= minAcceptedError)
+        {
+            break; /* clusters = centroides usados na ultima atribuicao */
+        }
+        memcpy(prev, clusters, sizeof(cluster) * k);
+        for (int c = 0; c < k; c++)
+        {
+            double w = sums[2 * k + c];
+            clusters[c].x = w > 0.0 ? sums[c] / w : 0.0;
+            clusters[c].y = w > 0.0 ? sums[k + c] / w : 0.0;
+            clusters[c].count = (size_t)w * replication;
+        }
+        first = 0;
+        iters++;
+    }
+
+    free(prev);
+    free(sums);
+    free(scratch);
+    *rows_out = rows;
+    *iterations = iters;
+    return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* coreset: amostra ponderada em duas passadas                             */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * Coreset "leve": probabilidade de amostragem q(x) = 1/2 * w/W + 1/2 * w d(x, mu)^2 / custo,
+ * com amostragem de Poisson (p = min(1, m q)) e peso w/p. A 1a passada da a
+ * media e o custo em torno dela; a 2a amostra. Com m >= linhas da base a 2a
+ * passada guarda todas as linhas com peso = replicacao: exato e do mesmo tamanho.
+ */
+static int build_coreset(const char* filename, size_t replication, size_t m, unsigned int seed,
+                         point_set* ps)
+{
+    double W = 0.0, sx = 0.0, sy = 0.0, sq = 0.0;
+    csv_reader r;
+    if (csv_open(&r, filename) != 0)
+    {
+        return -1;
+    }
+    for (size_t n; (n = csv_next(&r)) > 0;)
+    {
+        #pragma omp parallel for reduction(+ : sx, sy, sq) schedule(static)
+        for (size_t i = 0; i < n; i++)
+        {
+            sx += r.x[i];
+            sy += r.y[i];
+            sq += r.x[i] * r.x[i] + r.y[i] * r.y[i];
+        }
+        W += (double)n;
+    }
+    csv_close(&r);
+    if (W == 0.0)
+    {
+        return -1;
+    }
+    double mx = sx / W, my = sy / W;
+    double cost = sq - W * (mx * mx + my * my);
+    int keep_all = (double)m >= W;
+    W *= (double)replication;
+    cost *= (double)replication;
+
+    /* capacidade com folga: o tamanho de uma amostra de Poisson varia em torno de m */
+    size_t cap = m + m / 4 + 1024;
+    if (point_set_alloc(ps, KMEANS_LAYOUT_DOUBLE, cap, 1) != 0)
+    {
+        return -2;
+    }
+    size_t kept = 0;
+    if (csv_open(&r, filename) != 0)
+    {
+        point_set_free(ps);
+        return -1;
+    }
+    for (size_t n; (n = csv_next(&r)) > 0;)
+    {
+        for (size_t i = 0; i < n && kept < cap; i++)
+        {
+            double dx = r.x[i] - mx, dy = r.y[i] - my;
+            double w = (double)replication;
+            double q = 0.5 * w / W + (cost > 0.0 ? 0.5 * w * (dx * dx + dy * dy) / cost : 0.5 * w / W);
+            double p = keep_all ? 1.0 : fmin(1.0, (double)m * q);
+            if (keep_all || (double)rand_r(&seed) / ((double)RAND_MAX + 1.0) < p)
+            {
+                ps->xd[kept] = r.x[i];
+                ps->yd[kept] = r.y[i];
+                ps->w[kept] = w / p;
+                kept++;
+            }
+        }
+    }
+    csv_close(&r);
+    ps->n = kept;
+    return kept > 0 ? 0 : -1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+/* custo (soma das distancias ao quadrado) na base completa, numa passada */
+static double full_sse(const char* filename, const cluster* clusters, int k, size_t replication)
+{
+    double sse = 0.0;
+    csv_reader r;
+    if (csv_open(&r, filename) != 0)
+    {
+        return NAN;
+    }
+    for (size_t n; (n = csv_next(&r)) > 0;)
+    {
+        #pragma omp parallel for reduction(+ : sse) schedule(static)
+        for (size_t i = 0; i < n; i++)
+        {
+            int g = nearest_xy(r.x[i], r.y[i], clusters, k);
+            double dx = r.x[i] - clusters[g].x, dy = r.y[i] - clusters[g].y;
+            sse += dx * dx + dy * dy;
+        }
+    }
+    csv_close(&r);
+    return sse * (double)replication;
+}
+
+static int run_plan(const char* filename, const driver_options* opt, kmeans_plan* plan,
+                    cluster* clusters, driver_result* res)
+{
+    int k = opt->k;
+    double start = omp_get_wtime();
+
+    if (plan->exec == KMEANS_EXEC_MEMORY)
+    {
+        point_set ps;
+        int rc = load_point_set(filename, plan, opt->replication, &ps);
+        if (rc == -1)
+        {
+            fprintf(stderr, "Erro ao carregar dataset.\n");
+            return -1;
+        }
+        if (rc == 0)
+        {
+            rc = run_selected(&ps, opt, clusters, res);
+            point_set_free(&ps);
+            if (rc != 0)
+            {
+                fprintf(stderr, "Erro de memoria no K-Means com %zu pontos; caindo para fluxo.\n", res->points);
+                res->fell_back = 1;
+                plan->exec = KMEANS_EXEC_STREAM;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Erro de memoria ao carregar %zu pontos; caindo para fluxo.\n", plan->points);
+            res->fell_back = 1;
+            plan->exec = KMEANS_EXEC_STREAM;
+        }
+    }
+    else if (plan->exec == KMEANS_EXEC_CORESET)
+    {
+        point_set ps;
+        int rc = build_coreset(filename, opt->replication, plan->coreset_size, opt->seed, &ps);
+        if (rc == -1)
+        {
+            fprintf(stderr, "Erro ao carregar dataset.\n");
+            return -1;
+        }
+        if (rc == 0)
+        {
+            rc = run_selected(&ps, opt, clusters, res);
+            point_set_free(&ps);
+        }
+        if (rc != 0)
+        {
+            fprintf(stderr, "Erro de memoria no coreset; caindo para fluxo.\n");
+            res->fell_back = 1;
+            plan->exec = KMEANS_EXEC_STREAM;
+        }
+    }
+
+    if (plan->exec == KMEANS_EXEC_STREAM)
+    {
+        size_t rows = 0;
+        res->points = 0;
+        res->full_passes = 0;
+        int rc = stream_lloyd(filename, k, opt->replication, opt->seed, clusters, &rows, &res->iterations);
+        if (rc == -2)
+        {
+            fprintf(stderr, "Erro de memoria no modo em fluxo.\n");
+            return -1;
+        }
+        if (rc != 0 || rows == 0)
+        {
+            fprintf(stderr, "Erro ao carregar dataset.\n");
+            return -1;
+        }
+    }
+
+    res->seconds = omp_get_wtime() - start - res->compare_seconds;
+    res->sse = full_sse(filename, clusters, k, opt->replication);
+    return 0;
+}
+
+static void print_plan(FILE* out, const kmeans_plan_input* in, const kmeans_plan* plan)
+{
+    fprintf(out, "Plano: %s, layout %s, duplicatas %s\n", kmeans_exec_name(plan->exec),
+            kmeans_layout_name(plan->layout), plan->weighted ? "como peso" : "replicadas");
+    fprintf(out, "  base: %zu linhas%s x %zu copias, D=%d, k=%d, orcamento %.1f MiB, "
+                 "memoria estimada %.1f MiB (%zu pontos)\n",
+            in->rows, in->rows_estimated ? " (estimadas)" : "", in->replication, in->dims, in->k,
+            in->budget / 1048576.0, plan->bytes / 1048576.0, plan->points);
+    fprintf(out, "  motivo: %s\n", plan->reason);
+    if (plan->over_budget)
+    {
+        fprintf(out, "  aviso: memoria estimada acima do orcamento\n");
+    }
+}
+
+static int parse_layout(const char* s)
+{
+    return strcmp(s, "double") == 0 ? KMEANS_LAYOUT_DOUBLE
+         : strcmp(s, "float") == 0  ? KMEANS_LAYOUT_FLOAT
+         : strcmp(s, "quant16") == 0 ? KMEANS_LAYOUT_QUANT16
+                                     : -2;
+}
+
+static int parse_engine(const char* s)
+{
+    return strcmp(s, "auto") == 0   ? -1
+         : strcmp(s, "lloyd") == 0  ? KMEANS_ENGINE_LLOYD
+         : strcmp(s, "active") == 0 ? KMEANS_ENGINE_ACTIVE
+                                    : -2;
+}
+
+static int parse_kernel(const char* s)
+{
+    return strcmp(s, "auto") == 0   ? -1
+         : strcmp(s, "scalar") == 0 ? KMEANS_KERNEL_SCALAR
+         : strcmp(s, "simd") == 0   ? KMEANS_KERNEL_SIMD
+                                    : -2;
+}
+
+static int parse_dedup(const char* s)
+{
+    return strcmp(s, "auto") == 0 ? -1 : strcmp(s, "on") == 0 ? 1 : strcmp(s, "off") == 0 ? 0 : -2;
+}
+
+static int parse_exec(const char* s)
+{
+    return strcmp(s, "memoria") == 0 ? KMEANS_EXEC_MEMORY
+         : strcmp(s, "fluxo") == 0   ? KMEANS_EXEC_STREAM
+         : strcmp(s, "coreset") == 0 ? KMEANS_EXEC_CORESET
+                                     : -2;
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    driver_options opt = {5, REPLICATION_FACTOR, (unsigned int)time(NULL), NULL, 0, -1, -1, -1, 0};
+    kmeans_plan_input in;
+    memset(&in, 0, sizeof(in));
+    in.dims = 2;
+    in.force_layout = -1;
+    in.force_exec = -1;
+    in.budget = kmeans_default_budget();
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--k") == 0 && i + 1 < argc)
+        {
+            opt.k = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--replication") == 0 && i + 1 < argc)
+        {
+            opt.replication = (size_t)strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+        {
+            in.budget = kmeans_parse_bytes(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc)
+        {
+            in.force_layout = parse_layout(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--exec") == 0 && i + 1 < argc)
+        {
+            in.force_exec = parse_exec(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--replicate") == 0)
+        {
+            in.force_replicate = 1;
+        }
+        else if (strcmp(argv[i], "--exact") == 0)
+        {
+            in.exact = 1;
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            opt.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc)
+        {
+            opt.report = argv[++i];
+        }
+        else if (strcmp(argv[i], "--plan-only") == 0)
+        {
+            opt.plan_only = 1;
+        }
+        else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc)
+        {
+            opt.engine = parse_engine(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc)
+        {
+            opt.kernel = parse_kernel(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--dedup") == 0 && i + 1 < argc)
+        {
+            opt.dedup = parse_dedup(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--compare") == 0)
+        {
+            opt.compare = 1;
+        }
+        else if (argv[i][0] != '-')
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            fprintf(stderr, "Opcao desconhecida: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (opt.k < 2 || opt.replication < 1 || in.budget == 0 || in.force_layout == -2 ||
+        in.force_exec == -2 || opt.engine == -2 || opt.kernel == -2 || opt.dedup == -2)
+    {
+        fprintf(stderr,
+                "Uso: %s [arquivo] [--k K] [--replication R] [--budget B] "
+                "[--layout double|float|quant16]\n"
+                "       [--exec memoria|fluxo|coreset] [--replicate] [--exact] [--seed S] "
+                "[--report ARQ] [--plan-only]\n"
+                "       [--engine auto|lloyd|active] [--kernel auto|scalar|simd] [--dedup auto|on|off] "
+                "[--compare]\n",
+                argv[0]);
+        return 1;
+    }
+
+    in.rows = kmeans_estimate_rows(filename, &in.rows_estimated);
+    if (in.rows == 0)
+    {
+        fprintf(stderr, "Erro ao abrir dataset %s.\n", filename);
+        return 1;
+    }
+    in.replication = opt.replication;
+    in.k = opt.k;
+
+    kmeans_plan plan;
+    kmeans_make_plan(&in, &plan);
+    printf("K-Means OpenMP (CPU) - driver com planejador de memoria, %d threads\n", omp_get_max_threads());
+    print_plan(stdout, &in, &plan);
+
+    FILE* report = NULL;
+    if (opt.report)
+    {
+        report = fopen(opt.report, "w");
+        if (!report)
+        {
+            fprintf(stderr, "Erro ao abrir relatorio %s.\n", opt.report);
+            return 1;
+        }
+        fprintf(report, "dataset=%s\n", filename);
+        kmeans_plan_report(report, &in, &plan);
+    }
+    if (opt.plan_only)
+    {
+        if (report)
+        {
+            fclose(report);
+        }
+        return 0;
+    }
+
+    cluster* clusters = (cluster*)calloc(opt.k, sizeof(cluster));
+    driver_result res;
+    memset(&res, 0, sizeof(res));
+    if (!clusters || run_plan(filename, &opt, &plan, clusters, &res) != 0)
+    {
+        if (report)
+        {
+            fclose(report);
+        }
+        free(clusters);
+        return 1;
+    }
+
+    printf("Execucao: %s, %zu pontos em memoria, %zu iteracoes, %.6f s%s\n", kmeans_exec_name(plan.exec),
+           res.points, res.iterations, res.seconds, res.fell_back ? " (fallback)" : "");
+    if (res.selected && res.select.engine == KMEANS_ENGINE_ACTIVE)
+    {
+        printf("Conjunto ativo: %zu de %zu iteracoes com passada completa\n", res.full_passes, res.iterations);
+    }
+    printf("Custo (SSE) na base completa: %.6e\n", res.sse);
+    for (int c = 0; c < opt.k; c++)
+    {
+        printf("Cluster %d: centroid (%.4f, %.4f), pontos=%zu\n", c, clusters[c].x, clusters[c].y,
+               clusters[c].count);
+    }
+
+    if (report)
+    {
+        if (res.selected)
+        {
+            kmeans_select_report(report, &res.stats, &res.select);
+            fprintf(report, "run.engine=%s\n", kmeans_engine_name(res.select.engine));
+            fprintf(report, "run.kernel=%s\n", kmeans_kernel_name(res.select.kernel));
+            fprintf(report, "run.dedup_from=%zu\n", res.deduped);
+            fprintf(report, "run.full_passes=%zu\n",
+                    res.select.engine == KMEANS_ENGINE_ACTIVE ? res.full_passes : res.iterations);
+        }
+        fprintf(report, "run.exec=%s\n", kmeans_exec_name(plan.exec));
+        fprintf(report, "run.fallback=%d\n", res.fell_back);
+        fprintf(report, "run.points=%zu\n", res.points);
+        fprintf(report, "run.iterations=%zu\n", res.iterations);
+        fprintf(report, "run.seconds=%.6f\n", res.seconds);
+        fprintf(report, "run.sse=%.9e\n", res.sse);
+        fprintf(report, "run.threads=%d\n", omp_get_max_threads());
+        fclose(report);
+    }
+
+    free(clusters);
+    return 0;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file k_means_clustering_hotswap.c
+ * @brief Teste de estresse da troca de modelo sem locks (kmeans_published_model.h).
+ *
+ * A thread 0 faz o papel do job de reajuste: roda o K-Means OpenMP sobre
+ * uma subamostra nova e publica o resultado, em laco. As demais threads
+ * sao leitores: para cada evento pegam o modelo atual (um load atomico),
+ * rotulam o ponto e saem da secao de leitura. Mede-se a vazao dos
+ * leitores sem trocas e durante as trocas.
+ *
+ * Uso: ./kmeans_hotswap [segundos por fase] [leitores]
+ */
+#include <omp.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "kmeans_common.h"
+#include "kmeans_published_model.h"
+
+#define REFIT_SAMPLE 26000 /* pontos por reajuste (1% da base replicada) */
+
+typedef struct
+{
+    double events_per_s;
+    uint64_t swaps;
+    uint64_t version_changes; /* vezes em que um leitor viu uma versao nova */
+} phase_result;
+
+static int nearest(const kmeans_snapshot* m, double px, double py)
+{
+    double minD = DBL_MAX;
+    int best = 0;
+    for (int c = 0; c < m->k; c++)
+    {
+        double dx = m->cx[c] - px;
+        double dy = m->cy[c] - py;
+        double dist = dx * dx + dy * dy;
+        if (dist < minD)
+        {
+            minD = dist;
+            best = c;
+        }
+    }
+    return best;
+}
+
+/* reajuste sobre uma subamostra aleatoria; retorna um snapshot novo (NULL sem memoria) */
+static kmeans_snapshot* refit(const observation* observations, size_t size, observation* sample,
+                              int k, uint64_t version, unsigned int* seed)
+{
+    for (size_t j = 0; j < REFIT_SAMPLE; j++)
+    {
+        sample[j] = observations[(size_t)rand_r(seed) % size];
+    }
+    cluster* clusters = kMeans_omp(sample, REFIT_SAMPLE, k);
+
+    double* cx = (double*)malloc(sizeof(double) * k);
+    double* cy = (double*)malloc(sizeof(double) * k);
+    kmeans_snapshot* snapshot = NULL;
+    if (clusters && cx && cy)
+    {
+        for (int c = 0; c < k; c++)
+        {
+            cx[c] = clusters[c].x;
+            cy[c] = clusters[c].y;
+        }
+        snapshot = kmeans_snapshot_create(k, cx, cy, version);
+    }
+    free(clusters);
+    free(cx);
+    free(cy);
+    return snapshot;
+}
+
+static phase_result run_phase(kmeans_model_registry* reg, const observation* observations,
+                              size_t size, observation* sample, int k, int readers, double seconds,
+                              int swapping, uint64_t* version)
+{
+    atomic_int stop;
+    atomic_init(&stop, 0);
+    uint64_t events = 0;
+    uint64_t changes = 0;
+    uint64_t swaps = 0;
+    uint64_t failed = 0;
+    double start = omp_get_wtime();
+
+    #pragma omp parallel num_threads(readers + 1) reduction(+ : events, changes)
+    {
+        int id = omp_get_thread_num();
+        if (id == 0)
+        {
+            unsigned int seed = (unsigned int)time(NULL);
+            while (omp_get_wtime() - start < seconds)
+            {
+                if (swapping)
+                {
+                    /* sem memoria para o reajuste, o modelo atual continua publicado */
+                    kmeans_snapshot* next = refit(observations, size, sample, k, *version + 1, &seed);
+                    if (kmeans_publish(reg, next) == 0)
+                    {
+                        ++*version;
+                        swaps++;
+                    }
+                    else
+                    {
+                        failed++;
+                    }
+                }
+            }
+            atomic_store(&stop, 1);
+        }
+        else
+        {
+            size_t j = (size_t)id * 7919u % size;
+            uint64_t seen = 0;
+            uint64_t checksum = 0;
+            while (!atomic_load_explicit(&stop, memory_order_relaxed))
+            {
+                for (int b = 0; b < 1024; b++) /* confere `stop` a cada 1024 eventos */
+                {
+                    kmeans_reader_enter(reg, id);
+                    const kmeans_snapshot* m = kmeans_current(reg);
+                    checksum += (uint64_t)nearest(m, observations[j].x, observations[j].y);
+                    if (m->version != seen)
+                    {
+                        seen = m->version;
+                        changes++;
+                    }
+                    kmeans_reader_exit(reg, id);
+                    j = j + 1 < size ? j + 1 : 0;
+                }
+                events += 1024;
+            }
+            if (checksum == UINT64_MAX)
+            {
+                printf("%llu\n", (unsigned long long)checksum); /* impede descartar o laco */
+            }
+        }
+    }
+
+    double elapsed = omp_get_wtime() - start;
+    kmeans_reclaim(reg);
+    if (failed)
+    {
+        fprintf(stderr, "Erro de memoria em %llu reajustes; modelo anterior mantido.\n",
+                (unsigned long long)failed);
+    }
+
+    phase_result r;
+    r.events_per_s = (double)events / elapsed;
+    r.swaps = swaps;
+    r.version_changes = changes;
+    return r;
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    int k = 5;
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    int readers = argc > 2 ? atoi(argv[2]) : omp_get_max_threads() - 1;
+    if (readers < 1)
+    {
+        readers = 1;
+    }
+    if (readers >= KMEANS_MAX_READERS)
+    {
+        readers = KMEANS_MAX_READERS - 1;
+    }
+
+    size_t size = 0;
+    observation* observations = load_observations(filename, &size);
+    if (!observations)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
+
+    srand((unsigned int)time(NULL));
+    omp_set_max_active_levels(1); /* reajuste do escritor roda serial dentro da regiao */
+
+    static kmeans_model_registry reg;
+    uint64_t version = 1;
+    unsigned int seed = (unsigned int)time(NULL);
+    observation* sample = (observation*)malloc(sizeof(observation) * REFIT_SAMPLE);
+    kmeans_snapshot* initial = sample ? refit(observations, size, sample, k, version, &seed) : NULL;
+    if (!initial)
+    {
+        fprintf(stderr, "Erro de memoria no modelo inicial.\n");
+        free(sample);
+        free(observations);
+        return 1;
+    }
+    kmeans_registry_init(&reg, initial);
+
+    printf("K-Means - troca de modelo sem locks\n");
+    printf("Observacoes efetivas: %zu, clusters: %d, leitores: %d, %.1f s por fase\n",
+           size, k, readers, seconds);
+
+    phase_result idle = run_phase(&reg, observations, size, sample, k, readers, seconds, 0, &version);
+    phase_result busy = run_phase(&reg, observations, size, sample, k, readers, seconds, 1, &version);
+    free(sample);
+
+    printf("Sem trocas    -> %.2f M eventos/s\n", idle.events_per_s / 1e6);
+    printf("Com trocas    -> %.2f M eventos/s (%.1f%% da vazao sem trocas)\n",
+           busy.events_per_s / 1e6, 100.0 * busy.events_per_s / idle.events_per_s);
+    printf("Trocas: %llu (%.1f/s), versoes novas vistas pelos leitores: %llu\n",
+           (unsigned long long)busy.swaps, busy.swaps / seconds,
+           (unsigned long long)busy.version_changes);
+    printf("Modelos liberados: %llu, pendentes: %d\n",
+           (unsigned long long)reg.reclaimed, reg.retired_count);
+
+    const kmeans_snapshot* m = kmeans_current(&reg);
+    for (int c = 0; c < m->k; c++)
+    {
+        printf("Cluster %d: centroid (%.4f, %.4f)\n", c, m->cx[c], m->cy[c]);
+    }
+
+    kmeans_registry_destroy(&reg);
+    free(observations);
+    return 0;
+}
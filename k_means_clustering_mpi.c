@@ -0,0 +1,356 @@
+/**
+ * @file k_means_clustering_mpi.c
+ * @brief K-Means distribuido: MPI entre processos + OpenMP dentro de cada rank.
+ *
+ * Cada rank carrega apenas o seu pedaco do arquivo (divisao por faixa de
+ * bytes do CSV, ou por registros no formato binario), faz a atribuicao e a
+ * acumulacao local com OpenMP e, a cada iteracao, um unico MPI_Allreduce
+ * soma os k*(D+1) acumuladores (somas x, y e contagens) junto com o
+ * contador `changed`.
+ *
+ * Uso: mpirun -np R ./kmeans_mpi [arquivo] [--weak] [--runs N]
+ *   arquivo  CSV "id,x,y" com cabecalho, ou .bin com pares (x, y) em double
+ *   --weak   cada rank carrega a base inteira (escalabilidade fraca)
+ *   --runs   numero de execucoes medidas (padrao NUM_RUNS)
+ */
+#include <mpi.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "kmeans_common.h"
+
+/* true se o nome termina em ".bin" */
+static int is_binary_file(const char* filename)
+{
+    size_t len = strlen(filename);
+    return len > 4 && strcmp(filename + len - 4, ".bin") == 0;
+}
+
+static int append_observation(observation** observations, size_t* size, size_t* capacity,
+                              double x, double y)
+{
+    if (*size >= *capacity)
+    {
+        size_t new_capacity = *capacity ? *capacity * 2 : 1024;
+        observation* tmp = (observation*)realloc(*observations, sizeof(observation) * new_capacity);
+        if (!tmp)
+        {
+            return 0;
+        }
+        *observations = tmp;
+        *capacity = new_capacity;
+    }
+    (*observations)[*size].x = x;
+    (*observations)[*size].y = y;
+    (*observations)[*size].group = 0;
+    (*size)++;
+    return 1;
+}
+
+/*
+ * CSV: o rank fica com as linhas cujo primeiro byte cai em [begin, end).
+ * O cabecalho (linha que comeca no byte 0) e sempre descartado. NULL so em
+ * erro; um pedaco sem linhas volta como vetor de 1 elemento com tamanho 0.
+ */
+static observation* load_csv_shard(const char* filename, long begin, long end, size_t* out_size)
+{
+    FILE* f = fopen(filename, "r");
+    if (!f)
+    {
+        return NULL;
+    }
+
+    char buffer[512];
+    observation* observations = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+
+    if (begin == 0)
+    {
+        if (!fgets(buffer, sizeof(buffer), f)) /* descarta cabecalho */
+        {
+            fclose(f);
+            return NULL;
+        }
+    }
+    else
+    {
+        /* se begin nao e inicio de linha, a linha parcial pertence ao rank anterior */
+        fseek(f, begin - 1, SEEK_SET);
+        int c = fgetc(f);
+        if (c != '\n' && !fgets(buffer, sizeof(buffer), f))
+        {
+            fclose(f);
+            *out_size = 0;
+            return (observation*)malloc(sizeof(observation));
+        }
+    }
+
+    while (ftell(f) < end && fgets(buffer, sizeof(buffer), f))
+    {
+        double x, y;
+        if (!parse_csv_line(buffer, &x, &y))
+        {
+            continue;
+        }
+        if (!append_observation(&observations, &size, &capacity, x, y))
+        {
+            free(observations);
+            fclose(f);
+            return NULL;
+        }
+    }
+
+    fclose(f);
+    *out_size = size;
+    return observations ? observations : (observation*)malloc(sizeof(observation));
+}
+
+/* binario: registros de 2 doubles; divisao exata por registro */
+static observation* load_bin_shard(const char* filename, long file_size, int rank, int ranks,
+                                   size_t* out_size)
+{
+    size_t records = (size_t)file_size / (2 * sizeof(double));
+    size_t first = records * (size_t)rank / (size_t)ranks;
+    size_t last = records * (size_t)(rank + 1) / (size_t)ranks;
+    size_t size = last - first;
+
+    FILE* f = fopen(filename, "rb");
+    if (!f)
+    {
+        return NULL;
+    }
+
+    observation* observations = (observation*)malloc(sizeof(observation) * (size ? size : 1));
+    double pair[2];
+    fseek(f, (long)(first * sizeof(pair)), SEEK_SET);
+    for (size_t i = 0; observations && i < size; i++)
+    {
+        if (fread(pair, sizeof(double), 2, f) != 2)
+        {
+            free(observations);
+            observations = NULL;
+            break;
+        }
+        observations[i].x = pair[0];
+        observations[i].y = pair[1];
+        observations[i].group = 0;
+    }
+
+    fclose(f);
+    *out_size = size;
+    return observations;
+}
+
+static observation* load_shard(const char* filename, int rank, int ranks, int weak, size_t* out_size)
+{
+    struct stat st;
+    if (stat(filename, &st) != 0)
+    {
+        return NULL;
+    }
+
+    /* na escalabilidade fraca todos os ranks recebem a base inteira */
+    int shard_rank = weak ? 0 : rank;
+    int shard_ranks = weak ? 1 : ranks;
+
+    size_t size = 0;
+    observation* shard = NULL;
+    if (is_binary_file(filename))
+    {
+        shard = load_bin_shard(filename, (long)st.st_size, shard_rank, shard_ranks, &size);
+    }
+    else
+    {
+        long begin = (long)((long long)st.st_size * shard_rank / shard_ranks);
+        long end = (long)((long long)st.st_size * (shard_rank + 1) / shard_ranks);
+        shard = load_csv_shard(filename, begin, end, &size);
+    }
+
+    if (!shard)
+    {
+        return NULL;
+    }
+    if (size == 0)
+    {
+        /* shard vazio (mais ranks que linhas): o rank so participa das reducoes */
+        *out_size = 0;
+        return shard;
+    }
+
+    observation* replicated = replicate_dataset(shard, size, REPLICATION_FACTOR, out_size);
+    free(shard);
+    return replicated;
+}
+
+/*
+ * Lloyd distribuido. Os acumuladores vao num unico vetor de 3k+1 doubles
+ * (somas x, somas y, contagens, changed) para um Allreduce por iteracao:
+ * as somas dos grupos recem-atribuidos viajam junto com o `changed` da
+ * mesma atribuicao.
+ */
+static void kMeans_mpi(observation* observations, size_t local_size, size_t global_size, int k,
+                       cluster* clusters, size_t* iterations, MPI_Comm comm)
+{
+    for (size_t j = 0; j < local_size; j++)
+    {
+        observations[j].group = rand() % k;
+    }
+
+    double* sums = (double*)malloc(sizeof(double) * (size_t)(3 * k + 1));
+    if (!sums)
+    {
+        fprintf(stderr, "Erro de memoria nos acumuladores do K-Means.\n");
+        MPI_Abort(comm, 1);
+    }
+    size_t minAcceptedError = global_size / 10000;
+    size_t local_changed = 0;
+    size_t iters = 0;
+
+    for (;;)
+    {
+        kMeans_omp_accumulate(observations, local_size, k, clusters);
+        for (int c = 0; c < k; c++)
+        {
+            sums[c] = clusters[c].x;
+            sums[k + c] = clusters[c].y;
+            sums[2 * k + c] = (double)clusters[c].count;
+        }
+        sums[3 * k] = (double)local_changed;
+
+        MPI_Allreduce(MPI_IN_PLACE, sums, 3 * k + 1, MPI_DOUBLE, MPI_SUM, comm);
+
+        for (int c = 0; c < k; c++)
+        {
+            clusters[c].count = (size_t)sums[2 * k + c];
+            clusters[c].x = clusters[c].count > 0 ? sums[c] / sums[2 * k + c] : 0.0;
+            clusters[c].y = clusters[c].count > 0 ? sums[k + c] / sums[2 * k + c] : 0.0;
+        }
+
+        if (iters > 0 && (size_t)sums[3 * k] <= minAcceptedError)
+        {
+            break;
+        }
+
+        local_changed = kMeans_omp_assign(observations, local_size, clusters, k);
+        iters++;
+    }
+
+    free(sums);
+    *iterations = iters;
+}
+
+int main(int argc, char** argv)
+{
+    int provided = 0;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank = 0, ranks = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* so a thread principal chama MPI, fora das regioes paralelas */
+    if (provided < MPI_THREAD_FUNNELED)
+    {
+        if (rank == 0)
+        {
+            fprintf(stderr, "Erro: a biblioteca MPI nao oferece MPI_THREAD_FUNNELED.\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    const char* filename = "Instagram_visits_clustering.csv";
+    int weak = 0;
+    int runs = NUM_RUNS;
+    int k = 5;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--weak") == 0)
+        {
+            weak = 1;
+        }
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+        {
+            runs = atoi(argv[++i]);
+        }
+        else
+        {
+            filename = argv[i];
+        }
+    }
+
+    size_t local_size = 0;
+    observation* observations = load_shard(filename, rank, ranks, weak, &local_size);
+    if (!observations)
+    {
+        /* os outros ranks ja podem estar na reducao: encerra o job inteiro */
+        fprintf(stderr, "Erro no rank %d ao carregar dataset %s.\n", rank, filename);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    unsigned long long local_ull = local_size, global_ull = 0;
+    MPI_Allreduce(&local_ull, &global_ull, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    size_t global_size = (size_t)global_ull;
+    if (global_size == 0)
+    {
+        if (rank == 0)
+        {
+            fprintf(stderr, "Erro: dataset %s sem observacoes.\n", filename);
+        }
+        free(observations);
+        MPI_Finalize();
+        return 1;
+    }
+
+    unsigned int seed = (unsigned int)time(NULL);
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    srand(seed + (unsigned int)rank);
+
+    if (rank == 0)
+    {
+        printf("K-Means MPI + OpenMP (%s)\n", weak ? "escalabilidade fraca" : "base particionada");
+        printf("Ranks: %d, threads por rank: %d\n", ranks, omp_get_max_threads());
+        printf("Observacoes efetivas: %zu (%zu no rank 0), clusters: %d\n", global_size, local_size, k);
+    }
+
+    cluster* clusters = (cluster*)calloc(k, sizeof(cluster));
+    if (!clusters)
+    {
+        fprintf(stderr, "Erro de memoria no rank %d.\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    size_t total_iters = 0;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+    for (int run = 0; run < runs; run++)
+    {
+        size_t iters = 0;
+        kMeans_mpi(observations, local_size, global_size, k, clusters, &iters, MPI_COMM_WORLD);
+        total_iters += iters;
+    }
+    double elapsed = MPI_Wtime() - start;
+    MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        printf("Tempo total (MPI, %d ranks, %d execucoes): %.6f s\n", ranks, runs, elapsed);
+        printf("Tempo medio por execucao: %.6f s, iteracoes medias: %.2f\n",
+               elapsed / runs, (double)total_iters / runs);
+        for (int c = 0; c < k; c++)
+        {
+            printf("Cluster %d: centroid (%.4f, %.4f), pontos=%zu\n", c,
+                   clusters[c].x, clusters[c].y, clusters[c].count);
+        }
+    }
+
+    free(clusters);
+    free(observations);
+    MPI_Finalize();
+    return 0;
+}
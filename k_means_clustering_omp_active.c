@@ -0,0 +1,358 @@
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kmeans_active.h"
+#include "kmeans_common.h"
+
+// Conjunto ativo: a maior parte dos pontos fica com o mesmo rotulo por muitas
+// iteracoes. Ao reatribuir um ponto mede-se a margem d2 - d1 (distancia ao 2o
+// centroide mais proximo menos a distancia ao mais proximo). Se os centroides
+// andaram no maximo D desde a medicao, um ponto com margem > 2D nao pode ter trocado
+// de grupo. So os pontos com margem abaixo do limiar T (ou que acabaram de
+// trocar) entram na lista ativa, compactada com soma de prefixos paralela.
+// As iteracoes comuns varrem so a lista; as somas dos centroides sao
+// corrigidas com deltas das trocas, entao a atualizacao custa O(k). A cada
+// VERIFY_EVERY iteracoes (ou quando o deslocamento acumulado pode ter vencido
+// a margem de algum ponto congelado) ha uma passada completa que reconstroi
+// a lista.
+//
+// Uso: ./kmeans_omp_active [k]
+
+#ifndef VERIFY_EVERY
+#define VERIFY_EVERY 8 /* iteracoes entre passadas completas */
+#endif
+#ifndef ACTIVE_DENSE
+#define ACTIVE_DENSE 0.5 /* lista acima dessa fracao da base: volta as passadas simples */
+#endif
+#ifndef DENSE_EXIT
+#define DENSE_EXIT 0.01 /* trocas abaixo dessa fracao da base: vale montar a lista */
+#endif
+#ifndef MARGIN_ITERS
+#define MARGIN_ITERS 2 /* iteracoes de deslocamento cobertas pelo limiar T */
+#endif
+
+typedef struct
+{
+    size_t iterations;
+    size_t full_passes;
+    size_t scanned; /* pontos examinados somando todas as iteracoes */
+} active_stats;
+
+/* grupo mais proximo e margem (distancia ao 2o menos distancia ao 1o), sem desvios */
+static inline int nearest_with_margin(const observation* o, const cluster* clusters, int k, double* margin)
+{
+    double d1 = INFINITY, d2 = INFINITY;
+    int best = 0;
+    for (int c = 0; c < k; c++)
+    {
+        double dx = o->x - clusters[c].x;
+        double dy = o->y - clusters[c].y;
+        double d = dx * dx + dy * dy;
+        double loser = d < d1 ? d1 : d;
+        best = d < d1 ? c : best;
+        d1 = d < d1 ? d : d1;
+        d2 = loser < d2 ? loser : d2;
+    }
+    *margin = sqrt(d2) - sqrt(d1);
+    return best;
+}
+
+/* centroides a partir das somas; retorna o maior deslocamento de um centroide */
+static double centroids_from_sums(const double* sum_x, const double* sum_y, const long long* count,
+                                  int k, cluster* clusters)
+{
+    double drift = 0.0;
+    for (int c = 0; c < k; c++)
+    {
+        double x = count[c] > 0 ? sum_x[c] / count[c] : 0.0;
+        double y = count[c] > 0 ? sum_y[c] / count[c] : 0.0;
+        drift = fmax(drift, hypot(x - clusters[c].x, y - clusters[c].y));
+        clusters[c].x = x;
+        clusters[c].y = y;
+        clusters[c].count = count[c] > 0 ? (size_t)count[c] : 0;
+    }
+    return drift;
+}
+
+/*
+ * Reatribui os pontos da lista `active` (ou todos, se `active` == NULL) e
+ * aplica as trocas as somas com deltas por thread. Com `keep` != NULL mede
+ * tambem as margens (usadas so aqui, contra o limiar) e marca em keep[a]
+ * (posicao na lista) quem continua instavel: margem abaixo do limiar ou
+ * trocado agora. Sem `keep` e a reatribuicao simples do Lloyd. `dsum`
+ * (2k por thread) e `dcount` (k por thread) guardam os deltas de cada uma
+ * das `nthreads` threads.
+ */
+static size_t reassign_pass(observation* observations, const size_t* active, size_t n_active, int k,
+                            const cluster* clusters, double threshold, unsigned char* keep,
+                            double* sum_x, double* sum_y, long long* count, double* dsum,
+                            long long* dcount, int nthreads)
+{
+    size_t changed = 0;
+
+    #pragma omp parallel num_threads(nthreads) reduction(+ : changed)
+    {
+        int t = omp_get_thread_num();
+        double* dx = dsum + 2 * (size_t)k * t;
+        double* dy = dx + k;
+        long long* dn = dcount + (size_t)k * t;
+        memset(dx, 0, sizeof(double) * 2 * k);
+        memset(dn, 0, sizeof(long long) * k);
+
+        #pragma omp for schedule(static)
+        for (size_t a = 0; a < n_active; a++)
+        {
+            size_t j = active ? active[a] : a;
+            int old = observations[j].group;
+            double margin = 0.0;
+            int g = keep ? nearest_with_margin(&observations[j], clusters, k, &margin)
+                         : calculateNearest(&observations[j], clusters, k);
+            int moved = g != old;
+            if (moved)
+            {
+                dx[old] -= observations[j].x;
+                dy[old] -= observations[j].y;
+                dn[old]--;
+                dx[g] += observations[j].x;
+                dy[g] += observations[j].y;
+                dn[g]++;
+                observations[j].group = g;
+                changed++;
+            }
+            if (keep)
+            {
+                keep[a] = moved || margin < threshold;
+            }
+        }
+
+        #pragma omp critical
+        {
+            for (int c = 0; c < k; c++)
+            {
+                sum_x[c] += dx[c];
+                sum_y[c] += dy[c];
+                count[c] += dn[c];
+            }
+        }
+    }
+
+    return changed;
+}
+
+/* buffers do conjunto ativo; NULLs sao aceitos */
+static void active_free(unsigned char* keep, size_t* active, size_t* next, double* sum_x, long long* count,
+                        double* dsum, long long* dcount, cluster* sums)
+{
+    free(keep);
+    free(active);
+    free(next);
+    free(sum_x);
+    free(count);
+    free(dsum);
+    free(dcount);
+    free(sums);
+}
+
+/*
+ * Lloyd com conjunto ativo a partir dos grupos ja presentes em
+ * `observations`. So declara convergencia depois de uma passada completa.
+ * Retorna 0, ou -1 sem memoria.
+ */
+static int kMeans_omp_active(observation* observations, size_t size, int k, cluster* clusters,
+                             active_stats* stats)
+{
+    size_t minAcceptedError = size / 10000;
+    int nthreads = omp_get_max_threads();
+    unsigned char* keep = (unsigned char*)malloc(size);
+    size_t* active = (size_t*)malloc(sizeof(size_t) * size);
+    size_t* next = (size_t*)malloc(sizeof(size_t) * size);
+    double* sum_x = (double*)calloc(2 * (size_t)k, sizeof(double));
+    long long* count = (long long*)calloc((size_t)k, sizeof(long long));
+    double* dsum = (double*)malloc(sizeof(double) * 2 * (size_t)k * nthreads);
+    long long* dcount = (long long*)malloc(sizeof(long long) * (size_t)k * nthreads);
+    cluster* sums = (cluster*)calloc(k, sizeof(cluster));
+    double* sum_y = sum_x + k;
+    memset(stats, 0, sizeof(*stats));
+    if (!keep || !active || !next || !sum_x || !count || !dsum || !dcount || !sums)
+    {
+        active_free(keep, active, next, sum_x, count, dsum, dcount, sums);
+        return -1;
+    }
+
+    kMeans_omp_accumulate(observations, size, k, sums);
+    for (int c = 0; c < k; c++)
+    {
+        sum_x[c] = sums[c].x;
+        sum_y[c] = sums[c].y;
+        count[c] = (long long)sums[c].count;
+    }
+
+    kmeans_active_schedule sched;
+    kmeans_active_init(&sched, VERIFY_EVERY, ACTIVE_DENSE, DENSE_EXIT, MARGIN_ITERS);
+    size_t n_active = 0;
+
+    for (;;)
+    {
+        double drift = centroids_from_sums(sum_x, sum_y, count, k, clusters);
+        stats->iterations++;
+
+        double threshold;
+        int full = kmeans_active_begin(&sched, drift, &threshold);
+        size_t changed;
+        if (full)
+        {
+            /* no inicio quase tudo troca: passadas simples ate o fluxo cair */
+            unsigned char* marks = kmeans_active_wants_marks(&sched) ? keep : NULL;
+            changed = reassign_pass(observations, NULL, size, k, clusters, threshold, marks,
+                                    sum_x, sum_y, count, dsum, dcount, nthreads);
+            stats->full_passes++;
+            stats->scanned += size;
+            if (changed <= minAcceptedError)
+            {
+                break;
+            }
+            if (marks)
+            {
+                n_active = kmeans_compact(NULL, keep, size, active);
+            }
+            kmeans_active_after_full(&sched, (double)changed, (double)size, marks != NULL, n_active, size);
+        }
+        else
+        {
+            changed = reassign_pass(observations, active, n_active, k, clusters, threshold,
+                                    keep, sum_x, sum_y, count, dsum, dcount, nthreads);
+            stats->scanned += n_active;
+            n_active = kmeans_compact(active, keep, n_active, next);
+            size_t* tmp = active;
+            active = next;
+            next = tmp;
+            kmeans_active_after_list(&sched, changed <= minAcceptedError);
+        }
+        kmeans_active_freeze(&sched, threshold);
+    }
+
+    active_free(keep, active, next, sum_x, count, dsum, dcount, sums);
+    return 0;
+}
+
+/* particao aleatoria reprodutivel para comparar os dois motores */
+static void random_partition(observation* observations, size_t size, int k, unsigned int seed)
+{
+    for (size_t j = 0; j < size; j++)
+    {
+        observations[j].group = (int)(rand_r(&seed) % (unsigned int)k);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    int k = argc > 1 ? atoi(argv[1]) : 5;
+    if (k < 2)
+    {
+        fprintf(stderr, "Erro: k deve ser >= 2.\n");
+        return 1;
+    }
+
+    size_t size = 0;
+    observation* observations = load_observations(filename, &size);
+    if (!observations)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
+    int* reference = (int*)malloc(sizeof(int) * size);
+    if (!reference)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        free(observations);
+        return 1;
+    }
+
+    printf("K-Means OpenMP (CPU) - conjunto ativo\n");
+    printf("Observacoes efetivas: %zu, clusters: %d, threads: %d, passada completa a cada %d iteracoes\n",
+           size, k, omp_get_max_threads(), VERIFY_EVERY);
+
+    unsigned int base_seed = (unsigned int)time(NULL);
+    cluster* clusters = (cluster*)calloc(k, sizeof(cluster));
+    if (!clusters)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        free(reference);
+        free(observations);
+        return 1;
+    }
+
+    /* referencia: Lloyd completo em todas as iteracoes */
+    size_t base_iters_total = 0;
+    double base_elapsed = 0.0;
+    for (int run = 0; run < NUM_RUNS; run++)
+    {
+        size_t iters = 0;
+        random_partition(observations, size, k, base_seed + run);
+        memset(clusters, 0, sizeof(cluster) * k);
+        double start = omp_get_wtime();
+        kMeans_omp_lloyd(observations, size, k, clusters, &iters);
+        base_elapsed += omp_get_wtime() - start;
+        base_iters_total += iters;
+    }
+    for (size_t j = 0; j < size; j++)
+    {
+        reference[j] = observations[j].group;
+    }
+
+    active_stats total = {0, 0, 0};
+    double active_elapsed = 0.0;
+    for (int run = 0; run < NUM_RUNS; run++)
+    {
+        active_stats stats;
+        random_partition(observations, size, k, base_seed + run);
+        memset(clusters, 0, sizeof(cluster) * k);
+        double start = omp_get_wtime();
+        if (kMeans_omp_active(observations, size, k, clusters, &stats) != 0)
+        {
+            fprintf(stderr, "Erro de memoria no conjunto ativo.\n");
+            free(clusters);
+            free(reference);
+            free(observations);
+            return 1;
+        }
+        active_elapsed += omp_get_wtime() - start;
+        total.iterations += stats.iterations;
+        total.full_passes += stats.full_passes;
+        total.scanned += stats.scanned;
+    }
+
+    /* mesma particao inicial da ultima execucao de referencia */
+    size_t mismatches = 0;
+    for (size_t j = 0; j < size; j++)
+    {
+        mismatches += observations[j].group != reference[j];
+    }
+
+    double base_iters = (double)base_iters_total / NUM_RUNS;
+    printf("Lloyd completo  -> tempo total (%d execucoes): %.6f s, medio: %.6f s, iteracoes: %.2f\n",
+           NUM_RUNS, base_elapsed, base_elapsed / NUM_RUNS, base_iters);
+    printf("Conjunto ativo  -> tempo total (%d execucoes): %.6f s, medio: %.6f s, iteracoes: %.2f "
+           "(%.2f completas)\n",
+           NUM_RUNS, active_elapsed, active_elapsed / NUM_RUNS, (double)total.iterations / NUM_RUNS,
+           (double)total.full_passes / NUM_RUNS);
+    printf("Pontos examinados por iteracao: %.1f%% da base (Lloyd completo: 100%%)\n",
+           100.0 * (double)total.scanned / ((double)total.iterations * size));
+    printf("Rotulos diferentes da referencia na ultima execucao: %zu\n", mismatches);
+
+    for (int i = 0; i < k; i++)
+    {
+        printf("Cluster %d: centroid (%.4f, %.4f), pontos=%zu\n", i,
+               clusters[i].x, clusters[i].y, clusters[i].count);
+    }
+
+    free(clusters);
+    free(reference);
+    free(observations);
+    return 0;
+}
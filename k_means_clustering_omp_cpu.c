@@ -1,11 +1,15 @@
 #include <float.h>
 #include <math.h>
 #include <omp.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include "kmeans_shm.h"
+#include "kmeans_sum.h"
+
 #define REPLICATION_FACTOR 1000
 #define NUM_RUNS 30
 
@@ -62,10 +66,10 @@ static cluster* kMeans_omp(observation* observations, size_t size, int k)
         return clusters;
     }
 
-    if (k >= (int)size)
+    if ((size_t)k >= size)
     {
         clusters = (cluster*)calloc(k, sizeof(cluster));
-        for (int j = 0; j < (int)size; j++)
+        for (size_t j = 0; j < size; j++)
         {
             clusters[j].x = observations[j].x;
             clusters[j].y = observations[j].y;
@@ -92,6 +96,55 @@ static cluster* kMeans_omp(observation* observations, size_t size, int k)
             clusters[i].count = 0;
         }
 
+#if COMPENSATED_SUM
+        double* comp = (double*)calloc(2 * (size_t)k, sizeof(double));
+        #pragma omp parallel // blocos somados de forma ingenua, parciais com Neumaier
+        {
+            double* local = (double*)calloc(2 * (size_t)k, sizeof(double));
+            double* local_comp = (double*)calloc(2 * (size_t)k, sizeof(double));
+            double* block = (double*)calloc(2 * (size_t)k, sizeof(double));
+            size_t* local_count = (size_t*)calloc((size_t)k, sizeof(size_t));
+
+            #pragma omp for schedule(static)
+            for (size_t b = 0; b < size; b += SUM_BLOCK)
+            {
+                size_t end = b + SUM_BLOCK < size ? b + SUM_BLOCK : size;
+                for (size_t j = b; j < end; j++)
+                {
+                    int g = observations[j].group;
+                    block[g] += observations[j].x;
+                    block[k + g] += observations[j].y;
+                    local_count[g] += 1;
+                }
+                for (int i = 0; i < 2 * k; i++)
+                {
+                    neumaier_add(&local[i], &local_comp[i], block[i]);
+                    block[i] = 0.0;
+                }
+            }
+
+            #pragma omp critical
+            {
+                for (int i = 0; i < k; i++)
+                {
+                    neumaier_add(&clusters[i].x, &comp[i], local[i] + local_comp[i]);
+                    neumaier_add(&clusters[i].y, &comp[k + i], local[k + i] + local_comp[k + i]);
+                    clusters[i].count += local_count[i];
+                }
+            }
+
+            free(local);
+            free(local_comp);
+            free(block);
+            free(local_count);
+        }
+        for (int i = 0; i < k; i++)
+        {
+            clusters[i].x += comp[i];
+            clusters[i].y += comp[k + i];
+        }
+        free(comp);
+#else
         #pragma omp parallel // acumula somas em buffers locais por thread
         {
             //aloca variaveis locais (cada thread tem uma)
@@ -122,6 +175,7 @@ static cluster* kMeans_omp(observation* observations, size_t size, int k)
             free(local_y);
             free(local_count);
         }
+#endif
 
         #pragma omp parallel for // normaliza centróides em paralelo
         for (int i = 0; i < k; i++)
@@ -252,7 +306,11 @@ int main(void)
     int k = 5;
 
     size_t size = 0;
-    observation* observations = load_dataset(filename, &size);
+    const char* shm_name = getenv("KMEANS_SHM");
+    observation* observations =
+        shm_name ? (observation*)kmeans_shm_load_aos(shm_name, sizeof(observation), offsetof(observation, x),
+                                                     offsetof(observation, y), &size)
+                 : load_dataset(filename, &size);
     if (!observations)
     {
         fprintf(stderr, "Erro ao carregar dataset.\n");
@@ -0,0 +1,693 @@
+#include <math.h>
+#include <omp.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kmeans_common.h"
+
+// DBSCAN em grade para dados 2-D, mesma base e mesma saida das versoes do
+// k-means (grupo em observations[].group, -1 = ruido).
+//
+// Grade uniforme de lado eps/sqrt(2): dois pontos da mesma celula estao a no
+// maximo eps, entao uma celula com >= min_pts pontos e toda de nucleos e os
+// nucleos de uma celula pertencem sempre ao mesmo cluster, que vira um unico
+// no do union-find. Os vizinhos de um ponto estao no bloco 5x5 de celulas em
+// volta da sua. Passos, todos paralelos:
+//  1. chave de celula por ponto e radix sort (LSD, histogramas por thread);
+//  2. por celula, ordena por coordenada e junta duplicatas exatas (ponto
+//     distinto + multiplicidade; na base replicada isso reduz o trabalho por
+//     REPLICATION_FACTOR);
+//  3. nucleos: celula densa inteira ou contagem com saida antecipada;
+//  4. union-find sem travas (CAS) sobre as celulas com nucleo: A e B se unem
+//     se algum nucleo de A esta a <= eps de algum nucleo de B;
+//  5. pontos de borda ficam com o cluster do nucleo mais proximo a <= eps.
+//
+// Uso: ./kmeans_omp_dbscan [eps] [min_pts]
+
+#ifndef DBSCAN_EPS
+#define DBSCAN_EPS 3.0
+#endif
+#ifndef DBSCAN_MIN_PTS
+#define DBSCAN_MIN_PTS (8 * REPLICATION_FACTOR) /* em pontos da base replicada */
+#endif
+
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1u << RADIX_BITS)
+
+typedef struct
+{
+    size_t clusters;
+    size_t noise;
+    size_t core;        /* pontos nucleo */
+    size_t cells;       /* celulas nao vazias */
+    size_t distinct;    /* pontos distintos */
+} dbscan_stats;
+
+typedef struct
+{
+    double x;
+    double y;
+    size_t idx;
+} grid_point;
+
+typedef struct
+{
+    double eps2;
+    size_t min_pts;
+    long long gx, gy;           /* celulas por eixo */
+    size_t n_cells;
+    unsigned long long* key;    /* chave de cada celula (cx * gy + cy), crescente */
+    long long* cx;
+    long long* cy;
+    size_t* cell_start;         /* n_cells + 1, em pontos distintos */
+    size_t n_distinct;
+    double* px;                 /* pontos distintos, por celula */
+    double* py;
+    size_t* mult;
+    size_t* dstart;             /* n_distinct + 1, em `order` */
+    size_t* order;              /* indices das observacoes agrupados por ponto distinto */
+    unsigned char* core;
+    unsigned char* core_cell;
+    _Atomic size_t* parent;     /* union-find das celulas */
+    int* label;                 /* por ponto distinto */
+} dbscan_grid;
+
+/* deslocamentos das celulas vizinhas: bloco 5x5 sem a propria celula. Os cantos
+ * (+-2, +-2) so alcancam pontos a ~eps exato, mas com o lado encolhido podem conter
+ * vizinhos */
+#define NEIGHBORS 24
+static const int NEIGHBOR_DX[NEIGHBORS] = {-2, -2, -2, -2, -2, -1, -1, -1, -1, -1, 0, 0,
+                                           0,  0,  1,  1,  1,  1,  1,  2,  2,  2, 2, 2};
+static const int NEIGHBOR_DY[NEIGHBORS] = {-2, -1, 0,  1, 2, -2, -1, 0, 1,  2, -2, -1,
+                                           1,  2,  -2, -1, 0, 1,  2, -2, -1, 0, 1,  2};
+
+/* ---------------------------------------------------------------------- */
+/* union-find sem travas                                                  */
+/* ---------------------------------------------------------------------- */
+
+/* raiz de i com compressao por metades (pais so apontam para indices menores) */
+static size_t uf_find(_Atomic size_t* parent, size_t i)
+{
+    for (;;)
+    {
+        size_t p = atomic_load_explicit(&parent[i], memory_order_relaxed);
+        if (p == i)
+        {
+            return i;
+        }
+        size_t gp = atomic_load_explicit(&parent[p], memory_order_relaxed);
+        if (gp != p)
+        {
+            /* se outra thread ja mudou parent[i], tudo bem: tambem aponta para um ancestral */
+            atomic_compare_exchange_weak_explicit(&parent[i], &p, gp, memory_order_relaxed,
+                                                  memory_order_relaxed);
+        }
+        i = gp;
+    }
+}
+
+/* liga a raiz de indice maior sob a menor; repete se outra thread mexeu nela antes */
+static void uf_union(_Atomic size_t* parent, size_t a, size_t b)
+{
+    for (;;)
+    {
+        a = uf_find(parent, a);
+        b = uf_find(parent, b);
+        if (a == b)
+        {
+            return;
+        }
+        size_t hi = a > b ? a : b;
+        size_t lo = a > b ? b : a;
+        size_t expected = hi;
+        if (atomic_compare_exchange_strong_explicit(&parent[hi], &expected, lo, memory_order_acq_rel,
+                                                    memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* construcao da grade                                                    */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * Radix sort LSD de (chave, indice) por digitos de RADIX_BITS, estavel, com
+ * histogramas por thread. Retorna 0, ou -1 sem memoria.
+ */
+static int radix_sort(unsigned long long* key, size_t* idx, unsigned long long* tkey, size_t* tidx, size_t n,
+                       unsigned long long max_key)
+{
+    int nthreads = omp_get_max_threads();
+    size_t* hist = (size_t*)malloc(sizeof(size_t) * RADIX_BUCKETS * nthreads);
+    if (!hist)
+    {
+        return -1;
+    }
+
+    for (int shift = 0; shift < 64 && (max_key >> shift) > 0; shift += RADIX_BITS)
+    {
+        #pragma omp parallel num_threads(nthreads)
+        {
+            int t = omp_get_thread_num();
+            int nt = omp_get_num_threads();
+            size_t begin = n * t / nt;
+            size_t end = n * (t + 1) / nt;
+            size_t* mine = hist + (size_t)t * RADIX_BUCKETS;
+
+            memset(mine, 0, sizeof(size_t) * RADIX_BUCKETS);
+            for (size_t i = begin; i < end; i++)
+            {
+                mine[(key[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+            }
+
+            #pragma omp barrier
+            #pragma omp single
+            {
+                size_t pos = 0;
+                for (unsigned int d = 0; d < RADIX_BUCKETS; d++)
+                {
+                    for (int u = 0; u < nt; u++)
+                    {
+                        size_t count = hist[(size_t)u * RADIX_BUCKETS + d];
+                        hist[(size_t)u * RADIX_BUCKETS + d] = pos;
+                        pos += count;
+                    }
+                }
+            }
+
+            for (size_t i = begin; i < end; i++)
+            {
+                size_t dst = mine[(key[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+                tkey[dst] = key[i];
+                tidx[dst] = idx[i];
+            }
+        }
+        memcpy(key, tkey, sizeof(unsigned long long) * n);
+        memcpy(idx, tidx, sizeof(size_t) * n);
+    }
+    free(hist);
+    return 0;
+}
+
+static int cmp_grid_point(const void* a, const void* b)
+{
+    const grid_point* p = (const grid_point*)a;
+    const grid_point* q = (const grid_point*)b;
+    if (p->x != q->x)
+    {
+        return p->x < q->x ? -1 : 1;
+    }
+    return p->y < q->y ? -1 : p->y > q->y;
+}
+
+static void grid_free(dbscan_grid* g)
+{
+    free(g->key);
+    free(g->cx);
+    free(g->cy);
+    free(g->cell_start);
+    free(g->px);
+    free(g->py);
+    free(g->mult);
+    free(g->dstart);
+    free(g->order);
+    free(g->core);
+    free(g->core_cell);
+    free(g->parent);
+    free(g->label);
+    memset(g, 0, sizeof(*g));
+}
+
+/* celulas ordenadas por chave e pontos distintos por celula; -1 sem memoria ou grade grande demais */
+static int grid_build(dbscan_grid* g, const observation* observations, size_t n, double eps)
+{
+    double min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    #pragma omp parallel for reduction(min : min_x, min_y) reduction(max : max_x, max_y) schedule(static)
+    for (size_t j = 0; j < n; j++)
+    {
+        min_x = fmin(min_x, observations[j].x);
+        max_x = fmax(max_x, observations[j].x);
+        min_y = fmin(min_y, observations[j].y);
+        max_y = fmax(max_y, observations[j].y);
+    }
+
+    /* lado um pouco menor que eps/sqrt(2) para o arredondamento nao passar de eps */
+    double side = eps / M_SQRT2 * (1.0 - 1e-9);
+    g->gx = (long long)floor((max_x - min_x) / side) + 1;
+    g->gy = (long long)floor((max_y - min_y) / side) + 1;
+    if ((double)g->gx * (double)g->gy > 9e18)
+    {
+        return -1;
+    }
+
+    unsigned long long* key = (unsigned long long*)malloc(sizeof(unsigned long long) * n);
+    unsigned long long* tkey = (unsigned long long*)malloc(sizeof(unsigned long long) * n);
+    size_t* idx = (size_t*)malloc(sizeof(size_t) * (n + 1)); /* + fim dos pontos distintos */
+    size_t* tidx = (size_t*)malloc(sizeof(size_t) * n);
+    unsigned char* first = (unsigned char*)malloc(n);
+    grid_point* pts = (grid_point*)malloc(sizeof(grid_point) * n);
+    size_t* starts = (size_t*)malloc(sizeof(size_t) * (n + 1));
+    int ok = key && tkey && idx && tidx && first && pts && starts;
+
+    if (ok)
+    {
+        #pragma omp parallel for schedule(static)
+        for (size_t j = 0; j < n; j++)
+        {
+            long long cx = (long long)((observations[j].x - min_x) / side);
+            long long cy = (long long)((observations[j].y - min_y) / side);
+            key[j] = (unsigned long long)cx * (unsigned long long)g->gy + (unsigned long long)cy;
+            idx[j] = j;
+        }
+        ok = radix_sort(key, idx, tkey, tidx, n, (unsigned long long)g->gx * (unsigned long long)g->gy - 1) == 0;
+    }
+
+    if (ok)
+    {
+        /* inicio de cada celula no vetor ordenado */
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; i++)
+        {
+            first[i] = i == 0 || key[i] != key[i - 1];
+            pts[i].x = observations[idx[i]].x;
+            pts[i].y = observations[idx[i]].y;
+            pts[i].idx = idx[i];
+        }
+        g->n_cells = kmeans_compact(NULL, first, n, starts);
+        starts[g->n_cells] = n;
+
+        g->key = (unsigned long long*)malloc(sizeof(unsigned long long) * g->n_cells);
+        g->cx = (long long*)malloc(sizeof(long long) * g->n_cells);
+        g->cy = (long long*)malloc(sizeof(long long) * g->n_cells);
+        g->cell_start = (size_t*)malloc(sizeof(size_t) * (g->n_cells + 1));
+        g->order = (size_t*)malloc(sizeof(size_t) * n);
+        ok = g->key && g->cx && g->cy && g->cell_start && g->order;
+    }
+
+    if (ok)
+    {
+        /* ordena cada celula por coordenada e conta os pontos distintos (usa `first` de novo) */
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (size_t c = 0; c < g->n_cells; c++)
+        {
+            size_t b = starts[c], e = starts[c + 1];
+            qsort(pts + b, e - b, sizeof(grid_point), cmp_grid_point);
+            for (size_t i = b; i < e; i++)
+            {
+                first[i] = i == b || pts[i].x != pts[i - 1].x || pts[i].y != pts[i - 1].y;
+                g->order[i] = pts[i].idx;
+            }
+            g->key[c] = key[b];
+            g->cx[c] = (long long)(key[b] / (unsigned long long)g->gy);
+            g->cy[c] = (long long)(key[b] % (unsigned long long)g->gy);
+        }
+        /* `idx` passa a guardar o inicio de cada ponto distinto em `order` */
+        g->n_distinct = kmeans_compact(NULL, first, n, idx);
+        idx[g->n_distinct] = n;
+
+        size_t d = g->n_distinct;
+        g->px = (double*)malloc(sizeof(double) * d);
+        g->py = (double*)malloc(sizeof(double) * d);
+        g->mult = (size_t*)malloc(sizeof(size_t) * d);
+        g->dstart = (size_t*)malloc(sizeof(size_t) * (d + 1));
+        g->core = (unsigned char*)calloc(d, 1);
+        g->label = (int*)malloc(sizeof(int) * d);
+        g->core_cell = (unsigned char*)calloc(g->n_cells, 1);
+        g->parent = (_Atomic size_t*)malloc(sizeof(_Atomic size_t) * g->n_cells);
+        ok = g->px && g->py && g->mult && g->dstart && g->core && g->label && g->core_cell && g->parent;
+    }
+
+    if (ok)
+    {
+        size_t d = g->n_distinct;
+        memcpy(g->dstart, idx, sizeof(size_t) * (d + 1));
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < d; i++)
+        {
+            g->px[i] = pts[idx[i]].x;
+            g->py[i] = pts[idx[i]].y;
+            g->mult[i] = idx[i + 1] - idx[i];
+        }
+        /* inicio de cada celula em pontos distintos: busca binaria do inicio em pontos */
+        #pragma omp parallel for schedule(static)
+        for (size_t c = 0; c <= g->n_cells; c++)
+        {
+            size_t lo = 0, hi = d;
+            while (lo < hi)
+            {
+                size_t mid = lo + (hi - lo) / 2;
+                if (idx[mid] < starts[c])
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            g->cell_start[c] = lo;
+        }
+    }
+
+    free(key);
+    free(tkey);
+    free(idx);
+    free(tidx);
+    free(first);
+    free(pts);
+    free(starts);
+    if (!ok)
+    {
+        grid_free(g);
+        return -1;
+    }
+    return 0;
+}
+
+/* indice da celula (cx, cy) ou -1 se vazia / fora da grade */
+static long long grid_cell(const dbscan_grid* g, long long cx, long long cy)
+{
+    if (cx < 0 || cy < 0 || cx >= g->gx || cy >= g->gy)
+    {
+        return -1;
+    }
+    unsigned long long k = (unsigned long long)cx * (unsigned long long)g->gy + (unsigned long long)cy;
+    size_t lo = 0, hi = g->n_cells;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (g->key[mid] < k)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo < g->n_cells && g->key[lo] == k ? (long long)lo : -1;
+}
+
+static inline double dist2(const dbscan_grid* g, size_t a, size_t b)
+{
+    double dx = g->px[a] - g->px[b], dy = g->py[a] - g->py[b];
+    return dx * dx + dy * dy;
+}
+
+/* ---------------------------------------------------------------------- */
+/* DBSCAN                                                                 */
+/* ---------------------------------------------------------------------- */
+
+/* nucleos: celula densa inteira; senao conta vizinhos (com multiplicidade) ate min_pts */
+static void find_core(dbscan_grid* g)
+{
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t c = 0; c < g->n_cells; c++)
+    {
+        size_t b = g->cell_start[c], e = g->cell_start[c + 1];
+        size_t in_cell = 0;
+        for (size_t p = b; p < e; p++)
+        {
+            in_cell += g->mult[p];
+        }
+        if (in_cell >= g->min_pts)
+        {
+            memset(g->core + b, 1, e - b);
+            g->core_cell[c] = 1;
+            continue;
+        }
+
+        long long nb[NEIGHBORS];
+        for (int o = 0; o < NEIGHBORS; o++)
+        {
+            nb[o] = grid_cell(g, g->cx[c] + NEIGHBOR_DX[o], g->cy[c] + NEIGHBOR_DY[o]);
+        }
+        for (size_t p = b; p < e; p++)
+        {
+            size_t count = in_cell;
+            for (int o = 0; o < NEIGHBORS && count < g->min_pts; o++)
+            {
+                if (nb[o] < 0)
+                {
+                    continue;
+                }
+                for (size_t q = g->cell_start[nb[o]]; q < g->cell_start[nb[o] + 1] && count < g->min_pts; q++)
+                {
+                    count += dist2(g, p, q) <= g->eps2 ? g->mult[q] : 0;
+                }
+            }
+            if (count >= g->min_pts)
+            {
+                g->core[p] = 1;
+                g->core_cell[c] = 1;
+            }
+        }
+    }
+}
+
+/* algum nucleo de a esta a <= eps de algum nucleo de b? */
+static int cells_connected(const dbscan_grid* g, size_t a, size_t b)
+{
+    for (size_t p = g->cell_start[a]; p < g->cell_start[a + 1]; p++)
+    {
+        if (!g->core[p])
+        {
+            continue;
+        }
+        for (size_t q = g->cell_start[b]; q < g->cell_start[b + 1]; q++)
+        {
+            if (g->core[q] && dist2(g, p, q) <= g->eps2)
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* une celulas com nucleo conectadas; cada par e examinado uma vez (b > a) */
+static void merge_cells(dbscan_grid* g)
+{
+    #pragma omp parallel for schedule(static)
+    for (size_t c = 0; c < g->n_cells; c++)
+    {
+        atomic_init(&g->parent[c], c);
+    }
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t a = 0; a < g->n_cells; a++)
+    {
+        if (!g->core_cell[a])
+        {
+            continue;
+        }
+        for (int o = 0; o < NEIGHBORS; o++)
+        {
+            long long b = grid_cell(g, g->cx[a] + NEIGHBOR_DX[o], g->cy[a] + NEIGHBOR_DY[o]);
+            if (b <= (long long)a || !g->core_cell[b])
+            {
+                continue;
+            }
+            if (uf_find(g->parent, a) != uf_find(g->parent, (size_t)b) && cells_connected(g, a, (size_t)b))
+            {
+                uf_union(g->parent, a, (size_t)b);
+            }
+        }
+    }
+}
+
+/*
+ * Numeracao dos clusters (ordem das raizes), nucleos e bordas; `clusters`
+ * recebe o numero de clusters. Retorna 0, ou -1 sem memoria.
+ */
+static int label_points(dbscan_grid* g, size_t* clusters)
+{
+    int* cluster_of = (int*)malloc(sizeof(int) * (g->n_cells > 0 ? g->n_cells : 1));
+    if (!cluster_of)
+    {
+        return -1;
+    }
+    size_t found = 0;
+    for (size_t c = 0; c < g->n_cells; c++)
+    {
+        cluster_of[c] = g->core_cell[c] && uf_find(g->parent, c) == c ? (int)found++ : -1;
+    }
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t c = 0; c < g->n_cells; c++)
+    {
+        int own = g->core_cell[c] ? cluster_of[uf_find(g->parent, c)] : -1;
+        long long nb[NEIGHBORS];
+        int have_nb = 0;
+        for (size_t p = g->cell_start[c]; p < g->cell_start[c + 1]; p++)
+        {
+            if (g->core[p])
+            {
+                g->label[p] = own;
+                continue;
+            }
+            /* borda: nucleo mais proximo a <= eps (a propria celula primeiro) */
+            if (!have_nb)
+            {
+                for (int o = 0; o < NEIGHBORS; o++)
+                {
+                    nb[o] = grid_cell(g, g->cx[c] + NEIGHBOR_DX[o], g->cy[c] + NEIGHBOR_DY[o]);
+                }
+                have_nb = 1;
+            }
+            double best = INFINITY;
+            int label = -1;
+            for (int o = -1; o < NEIGHBORS; o++)
+            {
+                long long cell = o < 0 ? (long long)c : nb[o];
+                if (cell < 0 || !g->core_cell[cell])
+                {
+                    continue;
+                }
+                for (size_t q = g->cell_start[cell]; q < g->cell_start[cell + 1]; q++)
+                {
+                    double d = dist2(g, p, q);
+                    if (g->core[q] && d <= g->eps2 && d < best)
+                    {
+                        best = d;
+                        label = cluster_of[uf_find(g->parent, (size_t)cell)];
+                    }
+                }
+            }
+            g->label[p] = label;
+        }
+    }
+
+    free(cluster_of);
+    *clusters = found;
+    return 0;
+}
+
+/*
+ * DBSCAN(eps, min_pts) sobre as observacoes; grupo em observations[].group
+ * (-1 = ruido). Retorna 0, ou -1 sem memoria.
+ */
+static int dbscan_omp(observation* observations, size_t size, double eps, size_t min_pts, dbscan_stats* stats)
+{
+    dbscan_grid g;
+    memset(&g, 0, sizeof(g));
+    memset(stats, 0, sizeof(*stats));
+    if (grid_build(&g, observations, size, eps) != 0)
+    {
+        return -1;
+    }
+    g.eps2 = eps * eps;
+    g.min_pts = min_pts;
+
+    find_core(&g);
+    merge_cells(&g);
+    if (label_points(&g, &stats->clusters) != 0)
+    {
+        grid_free(&g);
+        return -1;
+    }
+    stats->cells = g.n_cells;
+    stats->distinct = g.n_distinct;
+
+    size_t noise = 0, core = 0;
+    #pragma omp parallel for reduction(+ : noise, core) schedule(static)
+    for (size_t p = 0; p < g.n_distinct; p++)
+    {
+        for (size_t i = g.dstart[p]; i < g.dstart[p + 1]; i++)
+        {
+            observations[g.order[i]].group = g.label[p];
+        }
+        noise += g.label[p] < 0 ? g.mult[p] : 0;
+        core += g.core[p] ? g.mult[p] : 0;
+    }
+    stats->noise = noise;
+    stats->core = core;
+
+    grid_free(&g);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    double eps = argc > 1 ? atof(argv[1]) : DBSCAN_EPS;
+    size_t min_pts = argc > 2 ? (size_t)strtoull(argv[2], NULL, 10) : (size_t)DBSCAN_MIN_PTS;
+    if (!(eps > 0.0) || min_pts < 1)
+    {
+        fprintf(stderr, "Erro: eps deve ser > 0 e min_pts >= 1.\n");
+        return 1;
+    }
+
+    size_t size = 0;
+    observation* observations = load_observations(filename, &size);
+    if (!observations)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
+
+    int thread_configs[] = {1, 2, 4, 8, 16, 32};
+    int num_configs = (int)(sizeof(thread_configs) / sizeof(thread_configs[0]));
+
+    printf("DBSCAN OpenMP (CPU) - grade de lado eps/sqrt(2)\n");
+    printf("Observacoes efetivas: %zu, eps: %.4f, min_pts: %zu\n", size, eps, min_pts);
+
+    dbscan_stats stats;
+    for (int c = 0; c < num_configs; c++)
+    {
+        int threads = thread_configs[c];
+        omp_set_num_threads(threads);
+
+        double start = omp_get_wtime();
+        for (int run = 0; run < NUM_RUNS; run++)
+        {
+            if (dbscan_omp(observations, size, eps, min_pts, &stats) != 0)
+            {
+                fprintf(stderr, "Erro de memoria (ou eps pequeno demais para a grade).\n");
+                free(observations);
+                return 1;
+            }
+        }
+        double end = omp_get_wtime();
+
+        double elapsed = end - start;
+        printf("Threads: %2d -> tempo total (%d execucoes): %.6f s, medio: %.6f s\n",
+               threads, NUM_RUNS, elapsed, elapsed / NUM_RUNS);
+    }
+
+    printf("Clusters: %zu, nucleos: %zu, ruido: %zu, celulas: %zu, pontos distintos: %zu\n", stats.clusters,
+           stats.core, stats.noise, stats.cells, stats.distinct);
+
+    /* mesma saida das versoes do k-means: centroide e tamanho de cada grupo */
+    cluster* clusters = (cluster*)calloc(stats.clusters > 0 ? stats.clusters : 1, sizeof(cluster));
+    if (!clusters)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        free(observations);
+        return 1;
+    }
+    for (size_t j = 0; j < size; j++)
+    {
+        int g = observations[j].group;
+        if (g >= 0)
+        {
+            clusters[g].x += observations[j].x;
+            clusters[g].y += observations[j].y;
+            clusters[g].count++;
+        }
+    }
+    for (size_t i = 0; i < stats.clusters; i++)
+    {
+        printf("Cluster %zu: centroid (%.4f, %.4f), pontos=%zu\n", i, clusters[i].x / clusters[i].count,
+               clusters[i].y / clusters[i].count, clusters[i].count);
+    }
+
+    free(clusters);
+    free(observations);
+    return 0;
+}
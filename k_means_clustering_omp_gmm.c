@@ -0,0 +1,604 @@
+#include <float.h>
+#include <math.h>
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kmeans_common.h"
+
+// Mistura de gaussianas (EM) inicializada pelo resultado do kMeans_omp:
+// atribuicao suave (responsabilidade de cada componente por ponto) e uma
+// covariancia 2x2 por componente. O E-step e o M-step sao fundidos numa unica
+// passada paralela: cada bloco de EM_BLOCK pontos (vetores x/y separados)
+// calcula os log-densidades, normaliza com log-sum-exp (exp vetorizado, ver
+// exp_simd) e acumula as estatisticas suficientes em buffers locais por
+// thread, reduzidos no fim como no acumulo do k-means. As estatisticas sao
+// deslocadas pela media anterior de cada componente (somas de r*dx, r*dx^2),
+// o que evita o cancelamento de E[x^2] - E[x]^2.
+//
+// Uso: ./kmeans_omp_gmm [k]
+
+#ifndef EM_BLOCK
+#define EM_BLOCK 512         /* pontos por bloco na passada fundida */
+#endif
+#ifndef GMM_TOL
+#define GMM_TOL 1e-5         /* variacao relativa da log-verossimilhanca media que encerra o EM */
+#endif
+#ifndef GMM_MAX_ITERS
+#define GMM_MAX_ITERS 500
+#endif
+#ifndef GMM_REG
+#define GMM_REG 1e-6         /* somado a diagonal das covariancias */
+#endif
+
+#define GMM_STATS 6          /* estatisticas por componente: N, Sdx, Sdy, Sdxdx, Sdxdy, Sdydy */
+
+typedef struct
+{
+    double pi;
+    double mx, my;
+    double sxx, sxy, syy;    /* covariancia */
+    double log_norm;         /* log pi - log 2pi - log|S| / 2 */
+    double pxx, pxy, pyy;    /* inversa da covariancia */
+} gaussian;
+
+typedef struct
+{
+    size_t iterations;
+    double log_likelihood;   /* media por ponto, na ultima passada */
+    int converged;           /* 0 = parou em GMM_MAX_ITERS */
+    size_t reseeded;         /* componentes sem massa refeitas por divisao */
+} gmm_result;
+
+/* buffers por thread das passadas paralelas, alocados uma vez */
+typedef struct
+{
+    int nthreads;
+    double* local;           /* GMM_STATS * k por thread */
+    double* block;           /* (k + 2) * EM_BLOCK por thread: log-densidades, maximo e soma */
+    size_t* counts;          /* k por thread, na atribuicao final */
+} gmm_workspace;
+
+static void gmm_workspace_free(gmm_workspace* ws)
+{
+    free(ws->local);
+    free(ws->block);
+    free(ws->counts);
+    memset(ws, 0, sizeof(*ws));
+}
+
+/* retorna 0, ou -1 sem memoria */
+static int gmm_workspace_alloc(gmm_workspace* ws, int k)
+{
+    size_t nt = (size_t)omp_get_max_threads();
+    ws->nthreads = (int)nt;
+    ws->local = (double*)malloc(sizeof(double) * GMM_STATS * (size_t)k * nt);
+    ws->block = (double*)malloc(sizeof(double) * ((size_t)k + 2) * EM_BLOCK * nt);
+    ws->counts = (size_t*)malloc(sizeof(size_t) * (size_t)k * nt);
+    if (!ws->local || !ws->block || !ws->counts)
+    {
+        gmm_workspace_free(ws);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * exp(x) para -708 <= x <= 0 sem desvios e sem chamada de biblioteca, para o
+ * laco vetorizar: x = n ln2 + r com |r| <= ln2 / 2 (n por arredondamento com
+ * a constante 1.5 * 2^52), polinomio de Taylor de grau 12 em r e 2^n montado
+ * direto no expoente. Erro relativo ~3e-16. O limite inferior fica com quem
+ * chama (num laco separado: a selecao junto das contas impede a
+ * vetorizacao sem -fno-trapping-math); abaixo de -708 o expoente estoura.
+ */
+static inline double exp_simd(double x)
+{
+    double kd = x * 1.4426950408889634 + 0x1.8p52;
+    double n = kd - 0x1.8p52;
+    double r = x - n * 6.93147180369123816490e-01;
+    r = r - n * 1.90821492927058770002e-10;
+    double p = 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+    uint64_t bits;
+    memcpy(&bits, &kd, sizeof(bits));
+    bits = (bits + 1023) << 52; /* os bits altos de 1.5 * 2^52 saem pelo deslocamento */
+    double scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+/* inversa e normalizacao a partir de pi, media e covariancia */
+static void gaussian_prepare(gaussian* g)
+{
+    double det = g->sxx * g->syy - g->sxy * g->sxy;
+    g->pxx = g->syy / det;
+    g->pyy = g->sxx / det;
+    g->pxy = -g->sxy / det;
+    g->log_norm = log(g->pi) - log(2.0 * M_PI) - 0.5 * log(det);
+}
+
+/* componente com massa na passada que gerou `stats` */
+static inline int gmm_alive(const double* stats, size_t n, int c)
+{
+    return stats[GMM_STATS * c] >= 1e-9 * (double)n;
+}
+
+/*
+ * Refaz a componente `dead` dividindo a mais pesada ao longo do eixo
+ * principal: as duas ficam com metade do peso e a mesma covariancia, com as
+ * medias a um desvio padrao para cada lado.
+ */
+static void gmm_split(const double* stats, size_t n, gaussian* comps, int k, int dead)
+{
+    int h = -1;
+    for (int c = 0; c < k; c++)
+    {
+        if (gmm_alive(stats, n, c) && (h < 0 || comps[c].pi > comps[h].pi))
+        {
+            h = c;
+        }
+    }
+    if (h < 0)
+    {
+        return;
+    }
+    gaussian* g = &comps[h];
+    double tr = g->sxx + g->syy, det = g->sxx * g->syy - g->sxy * g->sxy;
+    double l1 = tr / 2.0 + sqrt(fmax(0.0, tr * tr / 4.0 - det));
+    double vx = l1 - g->syy, vy = g->sxy;
+    double norm = hypot(vx, vy);
+    if (norm == 0.0)
+    {
+        vx = g->sxx >= g->syy ? 1.0 : 0.0;
+        vy = 1.0 - vx;
+        norm = 1.0;
+    }
+    double ox = sqrt(l1) * vx / norm, oy = sqrt(l1) * vy / norm;
+    g->pi /= 2.0;
+    comps[dead] = *g;
+    comps[dead].mx += ox;
+    comps[dead].my += oy;
+    g->mx -= ox;
+    g->my -= oy;
+    gaussian_prepare(g);
+    gaussian_prepare(&comps[dead]);
+}
+
+/*
+ * M-step: novos parametros a partir das estatisticas deslocadas pela media
+ * anterior. Componente sem massa (por exemplo, vinda de um grupo vazio do
+ * k-means) nunca recuperaria pontos: e refeita por gmm_split. Retorna
+ * quantas foram refeitas.
+ */
+static size_t m_step(const double* stats, size_t n, int k, gaussian* comps)
+{
+    size_t dead = 0;
+    for (int c = 0; c < k; c++)
+    {
+        const double* s = stats + GMM_STATS * c;
+        if (!gmm_alive(stats, n, c))
+        {
+            dead++;
+            continue;
+        }
+        double dx = s[1] / s[0], dy = s[2] / s[0];
+        comps[c].pi = s[0] / (double)n;
+        comps[c].mx += dx;
+        comps[c].my += dy;
+        comps[c].sxx = s[3] / s[0] - dx * dx + GMM_REG;
+        comps[c].sxy = s[4] / s[0] - dx * dy;
+        comps[c].syy = s[5] / s[0] - dy * dy + GMM_REG;
+        gaussian_prepare(&comps[c]);
+    }
+    for (int c = 0; c < k && dead > 0; c++)
+    {
+        if (!gmm_alive(stats, n, c))
+        {
+            gmm_split(stats, n, comps, k, c);
+        }
+    }
+    return dead;
+}
+
+/*
+ * Passada fundida E + M: responsabilidades com os parametros atuais e
+ * estatisticas suficientes (em `stats`, GMM_STATS * k) para os proximos.
+ * Retorna a log-verossimilhanca total. `simd_exp` escolhe exp_simd ou o
+ * exp da libm (para comparar).
+ */
+static double em_pass(const double* x, const double* y, size_t n, int k, const gaussian* comps, double* stats,
+                      int simd_exp, gmm_workspace* ws)
+{
+    double log_likelihood = 0.0;
+    memset(stats, 0, sizeof(double) * GMM_STATS * k);
+
+    // estatisticas em buffers locais por thread
+    #pragma omp parallel num_threads(ws->nthreads) reduction(+ : log_likelihood)
+    {
+        int t = omp_get_thread_num();
+        double* local = ws->local + (size_t)GMM_STATS * k * t;
+        double* l = ws->block + ((size_t)k + 2) * EM_BLOCK * t;
+        memset(local, 0, sizeof(double) * GMM_STATS * k);
+        double* top = l + (size_t)k * EM_BLOCK;
+        double* sum = top + EM_BLOCK;
+
+        #pragma omp for schedule(static)
+        for (size_t b = 0; b < n; b += EM_BLOCK)
+        {
+            size_t count = n - b < EM_BLOCK ? n - b : EM_BLOCK;
+            const double* bx = x + b;
+            const double* by = y + b;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                top[i] = -DBL_MAX;
+                sum[i] = 0.0;
+            }
+            for (int c = 0; c < k; c++)
+            {
+                const gaussian* g = &comps[c];
+                double* lc = l + (size_t)c * EM_BLOCK;
+                #pragma omp simd
+                for (size_t i = 0; i < count; i++)
+                {
+                    double dx = bx[i] - g->mx, dy = by[i] - g->my;
+                    double v = g->log_norm - 0.5 * (g->pxx * dx * dx + 2.0 * g->pxy * dx * dy + g->pyy * dy * dy);
+                    lc[i] = v;
+                    top[i] = v > top[i] ? v : top[i];
+                }
+            }
+
+            /* log-sum-exp: exp(l - max) em cada componente */
+            for (int c = 0; c < k; c++)
+            {
+                double* lc = l + (size_t)c * EM_BLOCK;
+                if (simd_exp)
+                {
+                    #pragma omp simd
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        double v = lc[i] - top[i];
+                        lc[i] = v < -708.0 ? -708.0 : v; /* exp(-708) ja e desprezivel na soma */
+                    }
+                    #pragma omp simd
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        double e = exp_simd(lc[i]);
+                        lc[i] = e;
+                        sum[i] += e;
+                    }
+                }
+                else
+                {
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        double e = exp(lc[i] - top[i]);
+                        lc[i] = e;
+                        sum[i] += e;
+                    }
+                }
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                log_likelihood += top[i] + log(sum[i]);
+                sum[i] = 1.0 / sum[i];
+            }
+
+            /* estatisticas suficientes, deslocadas pela media atual */
+            for (int c = 0; c < k; c++)
+            {
+                const gaussian* g = &comps[c];
+                const double* lc = l + (size_t)c * EM_BLOCK;
+                double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0, s4 = 0.0, s5 = 0.0;
+                #pragma omp simd reduction(+ : s0, s1, s2, s3, s4, s5)
+                for (size_t i = 0; i < count; i++)
+                {
+                    double r = lc[i] * sum[i];
+                    double dx = bx[i] - g->mx, dy = by[i] - g->my;
+                    s0 += r;
+                    s1 += r * dx;
+                    s2 += r * dy;
+                    s3 += r * dx * dx;
+                    s4 += r * dx * dy;
+                    s5 += r * dy * dy;
+                }
+                double* lo = local + GMM_STATS * c;
+                lo[0] += s0;
+                lo[1] += s1;
+                lo[2] += s2;
+                lo[3] += s3;
+                lo[4] += s4;
+                lo[5] += s5;
+            }
+        }
+
+        #pragma omp critical // reduz buffers locais no acumulador global
+        {
+            for (int j = 0; j < GMM_STATS * k; j++)
+            {
+                stats[j] += local[j];
+            }
+        }
+    }
+
+    return log_likelihood;
+}
+
+/*
+ * Parametros iniciais a partir do k-means: peso = fracao do grupo, media =
+ * centroide, covariancia = dispersao dentro do grupo (mesmas estatisticas
+ * deslocadas, com responsabilidade 0/1).
+ */
+static void gmm_init_from_kmeans(const observation* observations, const double* x, const double* y, size_t n,
+                                 int k, const cluster* clusters, gaussian* comps, double* stats, gmm_workspace* ws)
+{
+    memset(stats, 0, sizeof(double) * GMM_STATS * k);
+    #pragma omp parallel num_threads(ws->nthreads)
+    {
+        double* local = ws->local + (size_t)GMM_STATS * k * omp_get_thread_num();
+        memset(local, 0, sizeof(double) * GMM_STATS * k);
+
+        #pragma omp for schedule(static)
+        for (size_t j = 0; j < n; j++)
+        {
+            int g = observations[j].group;
+            double dx = x[j] - clusters[g].x, dy = y[j] - clusters[g].y;
+            double* lo = local + GMM_STATS * g;
+            lo[0] += 1.0;
+            lo[1] += dx;
+            lo[2] += dy;
+            lo[3] += dx * dx;
+            lo[4] += dx * dy;
+            lo[5] += dy * dy;
+        }
+
+        #pragma omp critical
+        {
+            for (int j = 0; j < GMM_STATS * k; j++)
+            {
+                stats[j] += local[j];
+            }
+        }
+    }
+
+    for (int c = 0; c < k; c++)
+    {
+        /* grupo vazio: componente larga e leve no centroide */
+        comps[c].pi = 1.0 / (double)n;
+        comps[c].mx = clusters[c].x;
+        comps[c].my = clusters[c].y;
+        comps[c].sxx = 1.0;
+        comps[c].sxy = 0.0;
+        comps[c].syy = 1.0;
+        gaussian_prepare(&comps[c]);
+    }
+    m_step(stats, n, k, comps);
+}
+
+/*
+ * EM ate a log-verossimilhanca media variar menos que GMM_TOL * |ll|. Com
+ * milhoes de pontos a media ainda sobe ~1e-6 por iteracao depois de
+ * centenas delas, entao uma tolerancia absoluta apertada leva quase todo
+ * ajuste a GMM_MAX_ITERS; quem para no limite fica com converged = 0.
+ * Depois de refazer uma componente a comparacao recomeca.
+ */
+static void gmm_em(const double* x, const double* y, size_t n, int k, gaussian* comps, double* stats,
+                   int simd_exp, gmm_workspace* ws, gmm_result* res)
+{
+    double previous = -INFINITY;
+    memset(res, 0, sizeof(*res));
+    while (res->iterations < GMM_MAX_ITERS)
+    {
+        double ll = em_pass(x, y, n, k, comps, stats, simd_exp, ws) / (double)n;
+        res->iterations++;
+        res->log_likelihood = ll;
+        if (ll - previous < GMM_TOL * fabs(ll))
+        {
+            res->converged = 1;
+            break; /* parametros atuais sao os que deram ll */
+        }
+        size_t dead = m_step(stats, n, k, comps);
+        res->reseeded += dead;
+        previous = dead > 0 ? -INFINITY : ll;
+    }
+}
+
+/*
+ * Atribuicao dura final (componente de maior responsabilidade) em
+ * observations[].group; retorna quantos pontos tem responsabilidade maxima
+ * abaixo de `threshold` (pontos ambiguos entre componentes).
+ */
+static size_t gmm_assign(observation* observations, const double* x, const double* y, size_t n, int k,
+                         const gaussian* comps, double threshold, size_t* counts, gmm_workspace* ws)
+{
+    size_t ambiguous = 0;
+    memset(counts, 0, sizeof(size_t) * k);
+
+    #pragma omp parallel num_threads(ws->nthreads) reduction(+ : ambiguous)
+    {
+        size_t* local = ws->counts + (size_t)k * omp_get_thread_num();
+        memset(local, 0, sizeof(size_t) * k);
+
+        #pragma omp for schedule(static)
+        for (size_t j = 0; j < n; j++)
+        {
+            double top = -DBL_MAX, sum = 0.0;
+            int best = 0;
+            for (int c = 0; c < k; c++)
+            {
+                double dx = x[j] - comps[c].mx, dy = y[j] - comps[c].my;
+                double v = comps[c].log_norm -
+                           0.5 * (comps[c].pxx * dx * dx + 2.0 * comps[c].pxy * dx * dy + comps[c].pyy * dy * dy);
+                if (v > top)
+                {
+                    sum = sum * exp(top - v) + 1.0;
+                    top = v;
+                    best = c;
+                }
+                else
+                {
+                    sum += exp(v - top);
+                }
+            }
+            observations[j].group = best;
+            local[best]++;
+            ambiguous += 1.0 / sum < threshold;
+        }
+
+        #pragma omp critical
+        {
+            for (int c = 0; c < k; c++)
+            {
+                counts[c] += local[c];
+            }
+        }
+    }
+    return ambiguous;
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    int k = argc > 1 ? atoi(argv[1]) : 5;
+    if (k < 2)
+    {
+        fprintf(stderr, "Erro: k deve ser >= 2.\n");
+        return 1;
+    }
+
+    size_t size = 0;
+    observation* observations = load_observations(filename, &size);
+    if (!observations)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
+
+    /* vetores x/y separados para a passada fundida */
+    double* x = (double*)malloc(sizeof(double) * size);
+    double* y = (double*)malloc(sizeof(double) * size);
+    gaussian* comps = (gaussian*)malloc(sizeof(gaussian) * k);
+    gaussian* start_comps = (gaussian*)malloc(sizeof(gaussian) * k);
+    double* stats = (double*)malloc(sizeof(double) * GMM_STATS * k);
+    size_t* counts = (size_t*)malloc(sizeof(size_t) * k);
+    gmm_workspace ws;
+    memset(&ws, 0, sizeof(ws));
+    if (!x || !y || !comps || !start_comps || !stats || !counts || gmm_workspace_alloc(&ws, k) != 0)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        free(x);
+        free(y);
+        free(comps);
+        free(start_comps);
+        free(stats);
+        free(counts);
+        free(observations);
+        return 1;
+    }
+    #pragma omp parallel for schedule(static)
+    for (size_t j = 0; j < size; j++)
+    {
+        x[j] = observations[j].x;
+        y[j] = observations[j].y;
+    }
+
+    printf("Mistura de gaussianas (EM) OpenMP (CPU), inicializada pelo K-Means\n");
+    printf("Observacoes efetivas: %zu, componentes: %d, threads: %d, bloco: %d\n", size, k,
+           omp_get_max_threads(), EM_BLOCK);
+
+    srand((unsigned int)time(NULL));
+    double kmeans_elapsed = 0.0, simd_elapsed = 0.0, libm_elapsed = 0.0;
+    size_t kmeans_iters = 0, simd_iters = 0, libm_iters = 0;
+    size_t unconverged = 0, reseeded = 0;
+    double max_ll_diff = 0.0;
+    gmm_result simd_res, libm_res;
+    for (int run = 0; run < NUM_RUNS; run++)
+    {
+        for (size_t j = 0; j < size; j++)
+        {
+            observations[j].group = 0;
+        }
+        size_t iters = 0;
+        double start = omp_get_wtime();
+        cluster* clusters = kMeans_omp_iters(observations, size, k, &iters);
+        kmeans_elapsed += omp_get_wtime() - start;
+        kmeans_iters += iters;
+        if (!clusters)
+        {
+            fprintf(stderr, "Erro de memoria no K-Means.\n");
+            gmm_workspace_free(&ws);
+            free(x);
+            free(y);
+            free(comps);
+            free(start_comps);
+            free(stats);
+            free(counts);
+            free(observations);
+            return 1;
+        }
+
+        gmm_init_from_kmeans(observations, x, y, size, k, clusters, start_comps, stats, &ws);
+        free(clusters);
+
+        /* mesmo ponto de partida para o EM com exp da libm e com exp_simd */
+        memcpy(comps, start_comps, sizeof(gaussian) * k);
+        start = omp_get_wtime();
+        gmm_em(x, y, size, k, comps, stats, 0, &ws, &libm_res);
+        libm_elapsed += omp_get_wtime() - start;
+        libm_iters += libm_res.iterations;
+
+        memcpy(comps, start_comps, sizeof(gaussian) * k);
+        start = omp_get_wtime();
+        gmm_em(x, y, size, k, comps, stats, 1, &ws, &simd_res);
+        simd_elapsed += omp_get_wtime() - start;
+        simd_iters += simd_res.iterations;
+
+        max_ll_diff = fmax(max_ll_diff, fabs(simd_res.log_likelihood - libm_res.log_likelihood));
+        unconverged += !libm_res.converged + !simd_res.converged;
+        reseeded += libm_res.reseeded + simd_res.reseeded;
+    }
+
+    printf("K-Means           -> medio: %.6f s, %.2f iteracoes, %.6f s/iteracao\n", kmeans_elapsed / NUM_RUNS,
+           (double)kmeans_iters / NUM_RUNS, kmeans_elapsed / (double)kmeans_iters);
+    printf("EM (exp da libm)  -> medio: %.6f s, %.2f iteracoes, %.6f s/iteracao\n", libm_elapsed / NUM_RUNS,
+           (double)libm_iters / NUM_RUNS, libm_elapsed / (double)libm_iters);
+    printf("EM (exp SIMD)     -> medio: %.6f s, %.2f iteracoes, %.6f s/iteracao\n", simd_elapsed / NUM_RUNS,
+           (double)simd_iters / NUM_RUNS, simd_elapsed / (double)simd_iters);
+    printf("Log-verossimilhanca media: %.9f (maior diferenca libm x SIMD: %.3e)\n", simd_res.log_likelihood,
+           max_ll_diff);
+    printf("Ajustes sem convergir em %d iteracoes: %zu de %d; componentes vazias refeitas: %zu\n", GMM_MAX_ITERS,
+           unconverged, 2 * NUM_RUNS, reseeded);
+
+    size_t ambiguous = gmm_assign(observations, x, y, size, k, comps, 0.9, counts, &ws);
+    printf("Pontos com responsabilidade maxima < 0.9: %zu (%.2f%%)\n", ambiguous, 100.0 * ambiguous / size);
+    for (int c = 0; c < k; c++)
+    {
+        printf("Componente %d: peso %.4f, media (%.4f, %.4f), covariancia [%.3f %.3f; %.3f %.3f], pontos=%zu\n", c,
+               comps[c].pi, comps[c].mx, comps[c].my, comps[c].sxx, comps[c].sxy, comps[c].sxy, comps[c].syy,
+               counts[c]);
+    }
+
+    gmm_workspace_free(&ws);
+    free(x);
+    free(y);
+    free(comps);
+    free(start_comps);
+    free(stats);
+    free(counts);
+    free(observations);
+    return 0;
+}
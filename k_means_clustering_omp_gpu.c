@@ -1,4 +1,5 @@
 #include <float.h>
+#include <limits.h>
 #include <math.h>
 #include <omp.h>
 #include <stdio.h>
@@ -6,6 +7,8 @@
 #include <string.h>
 #include <time.h>
 
+#include "kmeans_shm.h"
+
 #define REPLICATION_FACTOR 1000
 #define NUM_RUNS 30
 
@@ -115,14 +118,23 @@ static observation* load_dataset(const char* filename, size_t* out_size)
 }
 
 
-static void kMeans_omp_gpu(double* x,
+/*
+ * x, y e groups ja estao residentes no dispositivo (target enter data em
+ * main, valido para todas as execucoes). A iteracao inteira roda em regioes
+ * target: o acumulo usa reducao sobre secoes de vetor (cada time/thread
+ * soma numa copia privada dos k centroides, combinadas no fim da regiao) e
+ * a reatribuicao usa os centroides ja divididos. Por iteracao so trafegam
+ * os k centroides/contagens e o escalar `changed`; os grupos voltam ao host
+ * uma vez, no fim do ajuste.
+ */
+static int kMeans_omp_gpu(double* x,
                            double* y,
                            int* groups,
                            size_t n,
                            int k,
                            double* cent_x,
                            double* cent_y,
-                           int* cent_count)
+                           long long* cent_count)
 {
     if (k <= 1)
     {
@@ -135,17 +147,21 @@ static void kMeans_omp_gpu(double* x,
         }
         cent_x[0] = sx / (double)n;
         cent_y[0] = sy / (double)n;
-        cent_count[0] = (int)n;
-        return;
+        cent_count[0] = (long long)n;
+        return 0;
     }
 
     for (size_t i = 0; i < n; i++)
     {
         groups[i] = rand() % k;
     }
+    #pragma omp target update to(groups[0:n]) // particao inicial: uma copia por execucao
 
     size_t minAcceptedError = n / 10000;
     long long changed;
+    int iterations = 0;
+    int small = n <= (size_t)INT_MAX;
+    int* count32 = (int*)calloc(k, sizeof(int));
     do
     {
         for (int c = 0; c < k; c++)
@@ -155,12 +171,39 @@ static void kMeans_omp_gpu(double* x,
             cent_count[c] = 0;
         }
 
-        for (size_t i = 0; i < n; i++)
+        if (small)
         {
-            int g = groups[i];
-            cent_x[g] += x[i];
-            cent_y[g] += y[i];
-            cent_count[g] += 1;
+            // caminho de 32 bits: indice e contagens int (reducao mais barata no dispositivo)
+            int n32 = (int)n;
+            #pragma omp target teams distribute parallel for \
+            map(tofrom : cent_x[0:k], cent_y[0:k], count32[0:k]) \
+            reduction(+ : cent_x[0:k], cent_y[0:k], count32[0:k])
+            for (int i = 0; i < n32; i++)
+            {
+                int g = groups[i];
+                cent_x[g] += x[i];
+                cent_y[g] += y[i];
+                count32[g] += 1;
+            }
+            for (int c = 0; c < k; c++)
+            {
+                cent_count[c] = count32[c];
+                count32[c] = 0;
+            }
+        }
+        else
+        {
+            // Offload do acumulo: reducao sobre as secoes cent_x/cent_y/cent_count
+            #pragma omp target teams distribute parallel for \
+            map(tofrom : cent_x[0:k], cent_y[0:k], cent_count[0:k]) \
+            reduction(+ : cent_x[0:k], cent_y[0:k], cent_count[0:k])
+            for (long long i = 0; i < (long long)n; i++)
+            {
+                int g = groups[i];
+                cent_x[g] += x[i];
+                cent_y[g] += y[i];
+                cent_count[g] += 1;
+            }
         }
 
         for (int c = 0; c < k; c++)
@@ -174,10 +217,9 @@ static void kMeans_omp_gpu(double* x,
 
         changed = 0;
 
-        // Offload da reatribuicao para GPU
-        #pragma omp target teams distribute parallel for \    // offload: reatribui pontos na GPU
-        map(to : x[0:n], y[0:n], cent_x[0:k], cent_y[0:k]) \
-        map(tofrom : groups[0:n]) reduction(+ : changed)
+        // Offload da reatribuicao para GPU: x/y/groups residentes, so os centroides sobem
+        #pragma omp target teams distribute parallel for \
+        map(to : cent_x[0:k], cent_y[0:k]) reduction(+ : changed)
         for (long long i = 0; i < (long long)n; i++)
         {
             double minD = DBL_MAX;
@@ -200,51 +242,860 @@ static void kMeans_omp_gpu(double* x,
             }
         }
 
+        iterations++;
+    } while ((size_t)changed > minAcceptedError);
+
+    #pragma omp target update from(groups[0:n]) // rotulos finais
+    free(count32);
+    return iterations;
+}
+
+/*
+ * Variante com o ajuste inteiro numa unica regiao target: o laco
+ * do { } while roda no dispositivo e o criterio de parada e avaliado la,
+ * sem ida e volta ao host por iteracao. Como nao ha barreira entre times,
+ * a regiao usa um unico time (num_teams(1)) e as fases sao separadas por
+ * barreiras do parallel; o acumulo e a contagem de `changed` sao reducoes
+ * do time. Troca-se ocupacao do dispositivo (um time so) por zero
+ * lancamentos e sincronizacoes por iteracao.
+ */
+static int kMeans_omp_gpu_fused(double* x,
+                                double* y,
+                                int* groups,
+                                size_t n,
+                                int k,
+                                double* cent_x,
+                                double* cent_y,
+                                long long* cent_count)
+{
+    if (k <= 1)
+    {
+        return kMeans_omp_gpu(x, y, groups, n, k, cent_x, cent_y, cent_count);
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        groups[i] = rand() % k;
+    }
+    #pragma omp target update to(groups[0:n])
+
+    size_t minAcceptedError = n / 10000;
+    int iterations = 0;
+
+    #pragma omp target teams num_teams(1) \
+    map(from : cent_x[0:k], cent_y[0:k], cent_count[0:k]) map(tofrom : iterations)
+    {
+        long long changed = 0;
+        #pragma omp parallel
+        {
+            long long seen;
+            do
+            {
+                #pragma omp single
+                {
+                    for (int c = 0; c < k; c++)
+                    {
+                        cent_x[c] = 0.0;
+                        cent_y[c] = 0.0;
+                        cent_count[c] = 0;
+                    }
+                    changed = 0;
+                }
+
+                #pragma omp for reduction(+ : cent_x[0:k], cent_y[0:k], cent_count[0:k])
+                for (long long i = 0; i < (long long)n; i++)
+                {
+                    int g = groups[i];
+                    cent_x[g] += x[i];
+                    cent_y[g] += y[i];
+                    cent_count[g] += 1;
+                }
+
+                #pragma omp single
+                {
+                    for (int c = 0; c < k; c++)
+                    {
+                        if (cent_count[c] > 0)
+                        {
+                            cent_x[c] /= (double)cent_count[c];
+                            cent_y[c] /= (double)cent_count[c];
+                        }
+                    }
+                    iterations++;
+                }
+
+                #pragma omp for reduction(+ : changed)
+                for (long long i = 0; i < (long long)n; i++)
+                {
+                    double minD = DBL_MAX;
+                    int best = 0;
+                    for (int c = 0; c < k; c++)
+                    {
+                        double dx = cent_x[c] - x[i];
+                        double dy = cent_y[c] - y[i];
+                        double dist = dx * dx + dy * dy;
+                        if (dist < minD)
+                        {
+                            minD = dist;
+                            best = c;
+                        }
+                    }
+                    if (best != groups[i])
+                    {
+                        changed += 1;
+                        groups[i] = best;
+                    }
+                }
+
+                // cada thread le `changed` antes que o proximo single o zere
+                seen = changed;
+                #pragma omp barrier
+            } while ((size_t)seen > minAcceptedError);
+        }
+    }
+
+    #pragma omp target update from(groups[0:n])
+    return iterations;
+}
+
+typedef int (*gpu_engine)(double*, double*, int*, size_t, int, double*, double*, long long*);
+
+#define PIPELINE_DEFAULT_CHUNK ((size_t)1 << 20)
+#define PIPELINE_SLOTS 2 /* buffers no dispositivo: transfere o bloco i+1 enquanto calcula o i */
+
+static size_t pipeline_chunk = PIPELINE_DEFAULT_CHUNK; /* KMEANS_CHUNK (pontos por bloco) */
+
+typedef struct
+{
+    double t[4]; /* inicio da copia, fim da copia/inicio do calculo, fim do calculo, fim da volta */
+} chunk_times;
+
+/*
+ * Uma passada em blocos para bases maiores que a memoria do dispositivo.
+ * Cada bloco passa por: copia para o dispositivo (target enter data
+ * nowait), calculo (target nowait) e volta dos grupos (target exit data
+ * nowait). Blocos em slots diferentes sao independentes, entao a copia do
+ * bloco i+1 sobrepoe o calculo do i; o depend no slot serializa as etapas
+ * de um bloco e impede reusar um buffer antes da volta. Pequenas tarefas
+ * no host marcam os instantes para a linha do tempo. As parciais de cada
+ * bloco (somas, contagens, changed) sao somadas no host no fim. Retorna
+ * `changed`, ou -1 sem memoria.
+ */
+static long long pipeline_pass(double* x, double* y, int* groups, size_t n, int k,
+                               double* cent_x, double* cent_y, int assign, double* sum,
+                               chunk_times* times)
+{
+    size_t chunk = pipeline_chunk;
+    size_t chunks = (n + chunk - 1) / chunk;
+    size_t stride = 3 * (size_t)k + 1;
+    double* partial = (double*)calloc(chunks * stride, sizeof(double));
+    if (!partial)
+    {
+        return -1;
+    }
+    char slot[PIPELINE_SLOTS]; /* so enderecos para os depend */
+    (void)slot;                /* o gcc nao conta o uso em depend */
+    double origin = omp_get_wtime();
+
+    #pragma omp target enter data map(to : cent_x[0:k], cent_y[0:k])
+
+    #pragma omp parallel
+    #pragma omp single
+    {
+        for (size_t c = 0; c < chunks; c++)
+        {
+            size_t off = c * chunk;
+            size_t len = n - off < chunk ? n - off : chunk;
+            double* part = partial + c * stride;
+            double* t = times ? times[c].t : NULL;
+            size_t b = c % PIPELINE_SLOTS;
+            /* base propria do bloco: o kernel so ve a faixa mapeada, indexada de 0 */
+            double* xc = x + off;
+            double* yc = y + off;
+            int* gc = groups + off;
+
+            /* marcas de tempo so na passada instrumentada; fora dela uma tarefa
+             * nao adiada bloquearia o single no depend e acabaria com a sobreposicao */
+            if (t)
+            {
+                #pragma omp task depend(inout : slot[b])
+                t[0] = omp_get_wtime() - origin;
+            }
+
+            #pragma omp target enter data nowait depend(inout : slot[b]) \
+            map(to : xc[0:len], yc[0:len], gc[0:len], part[0:stride])
+
+            if (t)
+            {
+                #pragma omp task depend(inout : slot[b])
+                t[1] = omp_get_wtime() - origin;
+            }
+
+            #pragma omp target teams distribute parallel for nowait depend(inout : slot[b]) \
+            reduction(+ : part[0:stride])
+            for (size_t i = 0; i < len; i++)
+            {
+                int g = gc[i];
+                if (assign)
+                {
+                    double minD = DBL_MAX;
+                    int best = 0;
+                    for (int j = 0; j < k; j++)
+                    {
+                        double dx = cent_x[j] - xc[i];
+                        double dy = cent_y[j] - yc[i];
+                        double dist = dx * dx + dy * dy;
+                        if (dist < minD)
+                        {
+                            minD = dist;
+                            best = j;
+                        }
+                    }
+                    if (best != g)
+                    {
+                        part[3 * k] += 1.0;
+                        gc[i] = best;
+                        g = best;
+                    }
+                }
+                part[g] += xc[i];
+                part[k + g] += yc[i];
+                part[2 * k + g] += 1.0;
+            }
+
+            if (t)
+            {
+                #pragma omp task depend(inout : slot[b])
+                t[2] = omp_get_wtime() - origin;
+            }
+
+            #pragma omp target exit data nowait depend(inout : slot[b]) \
+            map(from : gc[0:len], part[0:stride]) map(release : xc[0:len], yc[0:len])
+
+            if (t)
+            {
+                #pragma omp task depend(inout : slot[b])
+                t[3] = omp_get_wtime() - origin;
+            }
+        }
+        #pragma omp taskwait
+    }
+
+    #pragma omp target exit data map(release : cent_x[0:k], cent_y[0:k])
+
+    long long changed = 0;
+    memset(sum, 0, sizeof(double) * 3 * k);
+    for (size_t c = 0; c < chunks; c++)
+    {
+        const double* part = partial + c * stride;
+        for (int j = 0; j < 3 * k; j++)
+        {
+            sum[j] += part[j];
+        }
+        changed += (long long)part[3 * k];
+    }
+    free(partial);
+    return changed;
+}
+
+static void print_timeline(const chunk_times* times, size_t chunks)
+{
+    double busy = 0.0, wall = 0.0;
+    int devices = omp_get_num_devices();
+    printf("Linha do tempo (1a iteracao, ms desde o inicio; bloco de %zu pontos%s)\n", pipeline_chunk,
+           devices > 0 ? "" : "; sem dispositivo: copias e calculo rodam no host");
+    for (size_t c = 0; c < chunks; c++)
+    {
+        const double* t = times[c].t;
+        printf("  bloco %3zu slot %d: copia %8.3f-%8.3f  calculo %8.3f-%8.3f  volta %8.3f-%8.3f\n",
+               c, (int)(c % PIPELINE_SLOTS), 1e3 * t[0], 1e3 * t[1], 1e3 * t[1], 1e3 * t[2],
+               1e3 * t[2], 1e3 * t[3]);
+        busy += t[3] - t[0];
+        wall = fmax(wall, t[3]);
+    }
+    printf("Soma das etapas: %.3f ms, parede: %.3f ms (sobreposicao %.2fx%s)\n", 1e3 * busy, 1e3 * wall,
+           wall > 0.0 ? busy / wall : 0.0, devices > 0 ? "" : ", so entre calculos no host");
+}
+
+/* centroides a partir das somas de uma passada em blocos */
+static void pipeline_centroids(const double* sum, int k, double* cent_x, double* cent_y, long long* cent_count)
+{
+    for (int c = 0; c < k; c++)
+    {
+        cent_count[c] = (long long)sum[2 * k + c];
+        cent_x[c] = cent_count[c] > 0 ? sum[c] / (double)cent_count[c] : 0.0;
+        cent_y[c] = cent_count[c] > 0 ? sum[k + c] / (double)cent_count[c] : 0.0;
+    }
+}
+
+/*
+ * Uma primeira iteracao instrumentada do pipeline, fora do benchmark:
+ * particao aleatoria, acumulo e a reatribuicao com marcas de tempo.
+ * Retorna 0, ou -1 sem memoria.
+ */
+static int pipeline_timeline(double* x, double* y, int* groups, size_t n, int k, double* cent_x,
+                             double* cent_y, long long* cent_count)
+{
+    size_t chunks = (n + pipeline_chunk - 1) / pipeline_chunk;
+    chunk_times* times = (chunk_times*)calloc(chunks, sizeof(chunk_times));
+    double* sum = (double*)malloc(sizeof(double) * 3 * k);
+    if (!times || !sum)
+    {
+        free(times);
+        free(sum);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        groups[i] = rand() % k;
+    }
+    int rc = -1;
+    if (pipeline_pass(x, y, groups, n, k, cent_x, cent_y, 0, sum, NULL) >= 0)
+    {
+        pipeline_centroids(sum, k, cent_x, cent_y, cent_count);
+        if (pipeline_pass(x, y, groups, n, k, cent_x, cent_y, 1, sum, times) >= 0)
+        {
+            print_timeline(times, chunks);
+            rc = 0;
+        }
+    }
+    free(times);
+    free(sum);
+    return rc;
+}
+
+/*
+ * Lloyd em blocos com pipeline; mesma trajetoria de kMeans_omp_gpu, base
+ * fora do dispositivo. Retorna as iteracoes, ou -1 sem memoria.
+ */
+static int kMeans_omp_pipeline(double* x,
+                               double* y,
+                               int* groups,
+                               size_t n,
+                               int k,
+                               double* cent_x,
+                               double* cent_y,
+                               long long* cent_count)
+{
+    if (k <= 1)
+    {
+        return kMeans_omp_gpu(x, y, groups, n, k, cent_x, cent_y, cent_count);
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        groups[i] = rand() % k;
+    }
+
+    double* sum = (double*)malloc(sizeof(double) * 3 * k);
+    if (!sum || pipeline_pass(x, y, groups, n, k, cent_x, cent_y, 0, sum, NULL) < 0)
+    {
+        free(sum);
+        return -1;
+    }
+
+    size_t minAcceptedError = n / 10000;
+    long long changed;
+    int iterations = 0;
+    do
+    {
+        pipeline_centroids(sum, k, cent_x, cent_y, cent_count);
+        changed = pipeline_pass(x, y, groups, n, k, cent_x, cent_y, 1, sum, NULL);
+        if (changed < 0)
+        {
+            free(sum);
+            return -1;
+        }
+        iterations++;
     } while ((size_t)changed > minAcceptedError);
+
+    free(sum);
+    return iterations;
 }
 
-int main(void)
+/* fracao dos pontos entregue ao dispositivo na co-execucao; adaptada a cada iteracao */
+static double coexec_fraction = 0.5;
+
+#define COEXEC_MIN_FRACTION 0.02 /* cada lado sempre recebe algo, para continuar medindo */
+
+/*
+ * Uma passada de co-execucao: [0, split) no dispositivo, [split, n) nas
+ * threads do host. Com `assign` os pontos sao reatribuidos aos centroides
+ * e entram nas somas com o grupo novo (reatribuicao + acumulo numa leitura
+ * so); sem `assign` so acumula. A thread 0 lanca a regiao target e as
+ * demais fazem a parte do host ao mesmo tempo (com 1 thread, em sequencia).
+ * `sum` recebe 3k valores (somas x, somas y, contagens).
+ */
+static long long coexec_pass(double* x, double* y, int* groups, size_t n, int k, size_t split,
+                             double* cent_x, double* cent_y, int assign, double* sum,
+                             double* t_dev, double* t_host)
+{
+    int threads = omp_get_max_threads();
+    size_t stride = 3 * (size_t)k + 2; /* somas, changed, tempo */
+    double* partial = (double*)calloc((size_t)threads * stride, sizeof(double));
+    double* dsx = (double*)calloc(k, sizeof(double));
+    double* dsy = (double*)calloc(k, sizeof(double));
+    long long* dcnt = (long long*)calloc(k, sizeof(long long)); /* faixa do dispositivo pode passar de 2^31 */
+    long long dchanged = 0;
+    *t_dev = 0.0;
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int tid = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+
+        if (tid == 0 && split > 0)
+        {
+            double t0 = omp_get_wtime();
+            #pragma omp target teams distribute parallel for \
+            map(to : cent_x[0:k], cent_y[0:k]) map(tofrom : dsx[0:k], dsy[0:k], dcnt[0:k]) \
+            reduction(+ : dsx[0:k], dsy[0:k], dcnt[0:k], dchanged)
+            for (long long i = 0; i < (long long)split; i++)
+            {
+                int g = groups[i];
+                if (assign)
+                {
+                    double minD = DBL_MAX;
+                    int best = 0;
+                    for (int c = 0; c < k; c++)
+                    {
+                        double dx = cent_x[c] - x[i];
+                        double dy = cent_y[c] - y[i];
+                        double dist = dx * dx + dy * dy;
+                        if (dist < minD)
+                        {
+                            minD = dist;
+                            best = c;
+                        }
+                    }
+                    if (best != g)
+                    {
+                        dchanged += 1;
+                        groups[i] = best;
+                        g = best;
+                    }
+                }
+                dsx[g] += x[i];
+                dsy[g] += y[i];
+                dcnt[g] += 1;
+            }
+            *t_dev = omp_get_wtime() - t0;
+        }
+
+        int workers = nt > 1 ? nt - 1 : 1;
+        int w = nt > 1 ? tid - 1 : 0;
+        if (w >= 0)
+        {
+            double t0 = omp_get_wtime();
+            double* mine = partial + (size_t)tid * stride;
+            size_t host_n = n - split;
+            size_t first = split + host_n * (size_t)w / (size_t)workers;
+            size_t last = split + host_n * (size_t)(w + 1) / (size_t)workers;
+            for (size_t i = first; i < last; i++)
+            {
+                int g = groups[i];
+                if (assign)
+                {
+                    double minD = DBL_MAX;
+                    int best = 0;
+                    for (int c = 0; c < k; c++)
+                    {
+                        double dx = cent_x[c] - x[i];
+                        double dy = cent_y[c] - y[i];
+                        double dist = dx * dx + dy * dy;
+                        if (dist < minD)
+                        {
+                            minD = dist;
+                            best = c;
+                        }
+                    }
+                    if (best != g)
+                    {
+                        mine[3 * k] += 1.0;
+                        groups[i] = best;
+                        g = best;
+                    }
+                }
+                mine[g] += x[i];
+                mine[k + g] += y[i];
+                mine[2 * k + g] += 1.0;
+            }
+            mine[3 * k + 1] = omp_get_wtime() - t0;
+        }
+    }
+
+    long long changed = dchanged;
+    *t_host = 0.0;
+    for (int c = 0; c < k; c++)
+    {
+        sum[c] = dsx[c];
+        sum[k + c] = dsy[c];
+        sum[2 * k + c] = (double)dcnt[c];
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        const double* p = partial + (size_t)t * stride;
+        for (int j = 0; j < 3 * k; j++)
+        {
+            sum[j] += p[j];
+        }
+        changed += (long long)p[3 * k];
+        *t_host = fmax(*t_host, p[3 * k + 1]);
+    }
+
+    free(partial);
+    free(dsx);
+    free(dsy);
+    free(dcnt);
+    return changed;
+}
+
+/* move a fronteira host/dispositivo, levando os grupos da faixa que trocou de dono */
+static void coexec_move_split(int* groups, size_t* split, size_t new_split)
+{
+    (void)groups; /* o gcc nao conta o uso em target update */
+    if (new_split > *split)
+    {
+        size_t len = new_split - *split;
+        #pragma omp target update to(groups[*split:len])
+    }
+    else if (new_split < *split)
+    {
+        size_t len = *split - new_split;
+        #pragma omp target update from(groups[new_split:len])
+    }
+    *split = new_split;
+}
+
+/*
+ * Co-execucao host + dispositivo: cada iteracao divide os pontos entre o
+ * dispositivo e as threads do host, soma as parciais e o `changed` das
+ * duas partes e ajusta a fracao do dispositivo pela vazao medida
+ * (pontos/s de cada lado). Mesma trajetoria de kMeans_omp_gpu.
+ */
+static int kMeans_omp_coexec(double* x,
+                             double* y,
+                             int* groups,
+                             size_t n,
+                             int k,
+                             double* cent_x,
+                             double* cent_y,
+                             long long* cent_count)
+{
+    if (k <= 1)
+    {
+        return kMeans_omp_gpu(x, y, groups, n, k, cent_x, cent_y, cent_count);
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        groups[i] = rand() % k;
+    }
+    size_t split = (size_t)(coexec_fraction * (double)n);
+    #pragma omp target update to(groups[0:split])
+
+    double* sum = (double*)malloc(sizeof(double) * 3 * k);
+    double t_dev, t_host;
+    coexec_pass(x, y, groups, n, k, split, cent_x, cent_y, 0, sum, &t_dev, &t_host);
+
+    size_t minAcceptedError = n / 10000;
+    long long changed;
+    int iterations = 0;
+    do
+    {
+        for (int c = 0; c < k; c++)
+        {
+            cent_count[c] = (long long)sum[2 * k + c];
+            cent_x[c] = cent_count[c] > 0 ? sum[c] / (double)cent_count[c] : 0.0;
+            cent_y[c] = cent_count[c] > 0 ? sum[k + c] / (double)cent_count[c] : 0.0;
+        }
+
+        changed = coexec_pass(x, y, groups, n, k, split, cent_x, cent_y, 1, sum, &t_dev, &t_host);
+        iterations++;
+
+        if (t_dev > 0.0 && t_host > 0.0)
+        {
+            double dev_rate = (double)split / t_dev;
+            double host_rate = (double)(n - split) / t_host;
+            double target = dev_rate / (dev_rate + host_rate);
+            coexec_fraction = 0.5 * coexec_fraction + 0.5 * target;
+            coexec_fraction = fmin(fmax(coexec_fraction, COEXEC_MIN_FRACTION),
+                                   1.0 - COEXEC_MIN_FRACTION);
+            coexec_move_split(groups, &split, (size_t)(coexec_fraction * (double)n));
+        }
+    } while ((size_t)changed > minAcceptedError);
+
+    if (split > 0)
+    {
+        #pragma omp target update from(groups[0:split])
+    }
+    free(sum);
+    return iterations;
+}
+
+
+
+/* referencia sequencial (mesmo laco de k_means_clustering.c) para --validate */
+static void kMeans_seq_reference(const double* x,
+                                 const double* y,
+                                 int* groups,
+                                 size_t n,
+                                 int k,
+                                 double* cent_x,
+                                 double* cent_y,
+                                 long long* cent_count)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        groups[i] = rand() % k;
+    }
+
+    size_t minAcceptedError = n / 10000;
+    size_t changed;
+    do
+    {
+        for (int c = 0; c < k; c++)
+        {
+            cent_x[c] = 0.0;
+            cent_y[c] = 0.0;
+            cent_count[c] = 0;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            int g = groups[i];
+            cent_x[g] += x[i];
+            cent_y[g] += y[i];
+            cent_count[g] += 1;
+        }
+        for (int c = 0; c < k; c++)
+        {
+            if (cent_count[c] > 0)
+            {
+                cent_x[c] /= (double)cent_count[c];
+                cent_y[c] /= (double)cent_count[c];
+            }
+        }
+
+        changed = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            double minD = DBL_MAX;
+            int best = 0;
+            for (int c = 0; c < k; c++)
+            {
+                double dx = cent_x[c] - x[i];
+                double dy = cent_y[c] - y[i];
+                double dist = dx * dx + dy * dy;
+                if (dist < minD)
+                {
+                    minD = dist;
+                    best = c;
+                }
+            }
+            if (best != groups[i])
+            {
+                changed++;
+                groups[i] = best;
+            }
+        }
+    } while (changed > minAcceptedError);
+}
+
+/*
+ * Roda os motores target e a referencia sequencial com a mesma particao
+ * inicial e compara centroides, contagens e rotulos. A ordem das somas
+ * muda com a reducao, entao os centroides sao comparados com tolerancia.
+ */
+static int validate(double* x, double* y, int* groups, size_t n, int k)
+{
+    const char* names[4] = {"por iteracao", "regiao unica", "co-execucao", "pipeline"};
+    gpu_engine engines[4] = {kMeans_omp_gpu, kMeans_omp_gpu_fused, kMeans_omp_coexec,
+                             kMeans_omp_pipeline};
+    double* ref_x = (double*)malloc(sizeof(double) * k);
+    double* ref_y = (double*)malloc(sizeof(double) * k);
+    long long* ref_count = (long long*)malloc(sizeof(long long) * k);
+    double* dev_x = (double*)malloc(sizeof(double) * k);
+    double* dev_y = (double*)malloc(sizeof(double) * k);
+    long long* dev_count = (long long*)malloc(sizeof(long long) * k);
+    int* ref_groups = (int*)malloc(sizeof(int) * n);
+    unsigned int seed = (unsigned int)time(NULL);
+
+    srand(seed);
+    kMeans_seq_reference(x, y, ref_groups, n, k, ref_x, ref_y, ref_count);
+
+    printf("Validacao contra a versao sequencial (dispositivos: %d, seed %u)\n",
+           omp_get_num_devices(), seed);
+    int all_ok = 1;
+    #pragma omp target enter data map(to : x[0:n], y[0:n]) map(alloc : groups[0:n])
+    for (int e = 0; e < 4; e++)
+    {
+        srand(seed);
+        engines[e](x, y, groups, n, k, dev_x, dev_y, dev_count);
+
+        double max_rel = 0.0;
+        int ok = 1;
+        for (int c = 0; c < k; c++)
+        {
+            double ex = fabs(dev_x[c] - ref_x[c]) / fmax(fabs(ref_x[c]), 1.0);
+            double ey = fabs(dev_y[c] - ref_y[c]) / fmax(fabs(ref_y[c]), 1.0);
+            max_rel = fmax(max_rel, fmax(ex, ey));
+            ok &= dev_count[c] == ref_count[c];
+        }
+        size_t label_diff = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            label_diff += groups[i] != ref_groups[i];
+        }
+        ok &= max_rel < 1e-9 && label_diff == 0;
+        all_ok &= ok;
+
+        printf("  %-13s %s (maior erro relativo nos centroides: %.3e, rotulos diferentes: %zu)\n",
+               names[e], ok ? "OK" : "FALHOU", max_rel, label_diff);
+    }
+    #pragma omp target exit data map(release : x[0:n], y[0:n], groups[0:n])
+
+    free(ref_x);
+    free(ref_y);
+    free(ref_count);
+    free(dev_x);
+    free(dev_y);
+    free(dev_count);
+    free(ref_groups);
+    return all_ok ? 0 : 1;
+}
+
+/*
+ * Custo de lancamento: mesmas seeds nos dois motores. O por-iteracao faz
+ * 2 regioes target + leitura de `changed` por iteracao; o de regiao unica,
+ * uma regiao por ajuste.
+ */
+static void bench_launch(double* x, double* y, int* groups, size_t n, int k, double* cent_x,
+                         double* cent_y, long long* cent_count)
+{
+    const char* names[2] = {"por iteracao", "regiao unica"};
+    gpu_engine engines[2] = {kMeans_omp_gpu, kMeans_omp_gpu_fused};
+    unsigned int seed = (unsigned int)time(NULL);
+    double seconds[2];
+    long iterations[2];
+
+    #pragma omp target enter data map(to : x[0:n], y[0:n]) map(alloc : groups[0:n])
+    for (int e = 0; e < 2; e++)
+    {
+        srand(seed);
+        iterations[e] = 0;
+        double start = omp_get_wtime();
+        for (int run = 0; run < NUM_RUNS; run++)
+        {
+            iterations[e] += engines[e](x, y, groups, n, k, cent_x, cent_y, cent_count);
+        }
+        seconds[e] = omp_get_wtime() - start;
+        printf("%-13s: %.6f s (%d execucoes, %ld iteracoes, %.3f ms/iteracao)\n", names[e],
+               seconds[e], NUM_RUNS, iterations[e], 1e3 * seconds[e] / iterations[e]);
+    }
+    #pragma omp target exit data map(release : x[0:n], y[0:n], groups[0:n])
+
+    /* regiao vazia: custo puro de um lancamento + sincronizacao */
+    const int launches = 10000;
+    double start = omp_get_wtime();
+    for (int i = 0; i < launches; i++)
+    {
+        #pragma omp target
+        {
+        }
+    }
+    double empty = (omp_get_wtime() - start) / launches;
+    printf("Regiao target vazia: %.3f us por lancamento; por iteracao economizado: %.3f ms\n",
+           1e6 * empty,
+           1e3 * (seconds[0] / iterations[0] - seconds[1] / iterations[1]));
+}
+
+/*
+ * Vetores x/y da base: anexados do segmento KMEANS_SHM (sem copia, somente
+ * leitura) ou lidos do CSV. `shm->base` indica de onde vieram.
+ */
+static int load_columns(const char* filename, kmeans_shm_dataset* shm, double** x, double** y,
+                        size_t* size)
+{
+    const char* shm_name = getenv("KMEANS_SHM");
+    memset(shm, 0, sizeof(*shm));
+    if (shm_name)
+    {
+        if (kmeans_shm_attach(shm_name, shm) != 0)
+        {
+            return -1;
+        }
+        *x = (double*)shm->x;
+        *y = (double*)shm->y;
+        *size = shm->n;
+        return 0;
+    }
+
+    observation* obs = load_dataset(filename, size);
+    if (!obs)
+    {
+        return -1;
+    }
+
+    *x = (double*)malloc(sizeof(double) * *size);
+    *y = (double*)malloc(sizeof(double) * *size);
+    if (!*x || !*y)
+    {
+        free(obs);
+        free(*x);
+        free(*y);
+        return -1;
+    }
+
+    for (size_t i = 0; i < *size; i++)
+    {
+        (*x)[i] = obs[i].x;
+        (*y)[i] = obs[i].y;
+    }
+    free(obs);
+    return 0;
+}
+
+static void free_columns(kmeans_shm_dataset* shm, double* x, double* y)
+{
+    if (shm->base)
+    {
+        kmeans_shm_detach(shm);
+        return;
+    }
+    free(x);
+    free(y);
+}
+
+int main(int argc, char** argv)
 {
     const char* filename = "Instagram_visits_clustering.csv";
     int k = 5;
 
     size_t size = 0;
-    observation* obs = load_dataset(filename, &size);
-    if (!obs)
+    double* x = NULL;
+    double* y = NULL;
+    kmeans_shm_dataset shm;
+    if (load_columns(filename, &shm, &x, &y, &size) != 0)
     {
         fprintf(stderr, "Erro ao carregar dataset.\n");
         return 1;
     }
 
-    double* x = (double*)malloc(sizeof(double) * size);
-    double* y = (double*)malloc(sizeof(double) * size);
-    int* groups = (int*)malloc(sizeof(int) * size);
-    if (!x || !y || !groups)
+    int* groups = (int*)calloc(size, sizeof(int));
+    if (!groups)
     {
         fprintf(stderr, "Erro de memoria.\n");
-        free(obs);
-        free(x);
-        free(y);
-        free(groups);
+        free_columns(&shm, x, y);
         return 1;
     }
 
-    for (size_t i = 0; i < size; i++)
-    {
-        x[i] = obs[i].x;
-        y[i] = obs[i].y;
-        groups[i] = 0;
-    }
-    free(obs);
-
     double* cent_x = (double*)malloc(sizeof(double) * k);
     double* cent_y = (double*)malloc(sizeof(double) * k);
-    int* cent_count = (int*)malloc(sizeof(int) * k);
+    long long* cent_count = (long long*)malloc(sizeof(long long) * k);
     if (!cent_x || !cent_y || !cent_count)
     {
         fprintf(stderr, "Erro de memoria.\n");
-        free(x);
-        free(y);
+        free_columns(&shm, x, y);
         free(groups);
         free(cent_x);
         free(cent_y);
@@ -254,31 +1105,94 @@ int main(void)
 
     srand((unsigned int)time(NULL));
 
-    printf("K-Means OpenMP (GPU - target)\n");
+    if (argc > 1 && strcmp(argv[1], "--bench-launch") == 0)
+    {
+        bench_launch(x, y, groups, size, k, cent_x, cent_y, cent_count);
+    }
+    if (argc > 1 && (strcmp(argv[1], "--validate") == 0 || strcmp(argv[1], "--bench-launch") == 0))
+    {
+        int rc = strcmp(argv[1], "--validate") == 0 ? validate(x, y, groups, size, k) : 0;
+        free_columns(&shm, x, y);
+        free(groups);
+        free(cent_x);
+        free(cent_y);
+        free(cent_count);
+        return rc;
+    }
+
+    int fused = argc > 1 && strcmp(argv[1], "--fused") == 0;
+    int coexec = argc > 1 && strcmp(argv[1], "--coexec") == 0;
+    int pipeline = argc > 1 && strcmp(argv[1], "--pipeline") == 0;
+    gpu_engine engine = fused      ? kMeans_omp_gpu_fused
+                        : coexec   ? kMeans_omp_coexec
+                        : pipeline ? kMeans_omp_pipeline
+                                   : kMeans_omp_gpu;
+    const char* chunk_env = getenv("KMEANS_CHUNK");
+    if (chunk_env && strtoul(chunk_env, NULL, 10) > 0)
+    {
+        pipeline_chunk = (size_t)strtoul(chunk_env, NULL, 10);
+    }
+
+    printf("K-Means OpenMP (GPU - target%s)\n",
+           fused      ? ", regiao unica"
+           : coexec   ? ", co-execucao host + dispositivo"
+           : pipeline ? ", pipeline em blocos"
+                      : "");
     printf("Observacoes efetivas: %zu, clusters: %d\n", size, k);
 
+    /* linha do tempo de uma iteracao, fora das execucoes medidas */
+    if (pipeline && pipeline_timeline(x, y, groups, size, k, cent_x, cent_y, cent_count) != 0)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        free_columns(&shm, x, y);
+        free(groups);
+        free(cent_x);
+        free(cent_y);
+        free(cent_count);
+        return 1;
+    }
+
     double start = omp_get_wtime();
-    for (int run = 0; run < NUM_RUNS; run++)
+
+    // Base residente no dispositivo durante todas as execucoes (exceto no pipeline em blocos)
+    #pragma omp target enter data if (!pipeline) map(to : x[0:size], y[0:size]) map(alloc : groups[0:size])
+    int failed = 0;
+    for (int run = 0; run < NUM_RUNS && !failed; run++)
     {
         for (size_t i = 0; i < size; i++)
         {
             groups[i] = 0;
         }
-        kMeans_omp_gpu(x, y, groups, size, k, cent_x, cent_y, cent_count);
+        failed = engine(x, y, groups, size, k, cent_x, cent_y, cent_count) < 0;
     }
+    #pragma omp target exit data if (!pipeline) map(release : x[0:size], y[0:size], groups[0:size])
     double end = omp_get_wtime();
+    if (failed)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        free_columns(&shm, x, y);
+        free(groups);
+        free(cent_x);
+        free(cent_y);
+        free(cent_count);
+        return 1;
+    }
 
     double elapsed = end - start;
     printf("Tempo total (OpenMP GPU, %d execucoes): %.6f s\n", NUM_RUNS, elapsed);
     printf("Tempo medio por execucao: %.6f s\n", elapsed / NUM_RUNS);
+    if (coexec)
+    {
+        printf("Fracao final no dispositivo: %.1f%% (host: %d threads)\n", 100.0 * coexec_fraction,
+               omp_get_max_threads() > 1 ? omp_get_max_threads() - 1 : 1);
+    }
 
     for (int c = 0; c < k; c++)
     {
-        printf("Cluster %d: centroid (%.4f, %.4f), pontos=%d\n", c, cent_x[c], cent_y[c], cent_count[c]);
+        printf("Cluster %d: centroid (%.4f, %.4f), pontos=%lld\n", c, cent_x[c], cent_y[c], cent_count[c]);
     }
 
-    free(x);
-    free(y);
+    free_columns(&shm, x, y);
     free(groups);
     free(cent_x);
     free(cent_y);
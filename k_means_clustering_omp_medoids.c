@@ -0,0 +1,545 @@
+#include <math.h>
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kmeans_common.h"
+
+// K-medoids (CLARA + FasterPAM): os representantes sao usuarios reais da base
+// e o custo e a soma das distancias (nao ao quadrado), entao um gastador
+// extremo puxa muito menos o representante do grupo do que puxa a media.
+//
+// CLARA: CLARA_DRAWS amostras de CLARA_SAMPLE linhas (cada uma ja com os
+// melhores medoides da amostra anterior); duplicatas exatas da amostra viram
+// um ponto com peso, o que na base replicada reduz bastante o problema. Em
+// cada amostra roda o FasterPAM (Schubert & Rousseeuw): para cada candidato,
+// o ganho de troca contra os k medoides sai numa passada O(m) usando o mais
+// proximo e o segundo mais proximo de cada ponto. Os ganhos de um bloco de
+// SWAP_BLOCK candidatos sao avaliados em paralelo e a melhor troca do bloco e
+// aplicada na hora (troca ansiosa). Os medoides de cada amostra sao avaliados
+// na base completa e fica o de menor custo.
+//
+// Uso: ./kmeans_omp_medoids [k] [amostra]
+
+#ifndef CLARA_SAMPLE
+#define CLARA_SAMPLE 4000   /* linhas sorteadas por amostra */
+#endif
+#ifndef CLARA_DRAWS
+#define CLARA_DRAWS 5       /* amostras do CLARA */
+#endif
+#ifndef SWAP_BLOCK
+#define SWAP_BLOCK 64       /* candidatos avaliados em paralelo antes de cada troca */
+#endif
+#ifndef MAX_PASSES
+#define MAX_PASSES 50       /* passadas completas sobre os candidatos */
+#endif
+
+typedef struct
+{
+    size_t draws;
+    size_t sample_points;   /* pontos distintos somando as amostras */
+    size_t swaps;
+    size_t candidates;      /* ganhos de troca avaliados */
+    double cost;            /* soma das distancias na base completa */
+} medoid_stats;
+
+/* amostra ponderada: coordenadas, peso e linha de origem na base */
+typedef struct
+{
+    double x;
+    double y;
+    double w;
+    size_t row;
+} weighted_point;
+
+static int cmp_weighted_point(const void* a, const void* b)
+{
+    const weighted_point* p = (const weighted_point*)a;
+    const weighted_point* q = (const weighted_point*)b;
+    if (p->x != q->x)
+    {
+        return p->x < q->x ? -1 : 1;
+    }
+    return p->y < q->y ? -1 : p->y > q->y;
+}
+
+/* junta duplicatas exatas somando os pesos; retorna o novo tamanho */
+static size_t collapse_duplicates(weighted_point* pts, size_t m)
+{
+    qsort(pts, m, sizeof(weighted_point), cmp_weighted_point);
+    size_t u = 0;
+    for (size_t i = 0; i < m; i++)
+    {
+        if (u > 0 && pts[i].x == pts[u - 1].x && pts[i].y == pts[u - 1].y)
+        {
+            pts[u - 1].w += pts[i].w;
+        }
+        else
+        {
+            pts[u++] = pts[i];
+        }
+    }
+    return u;
+}
+
+/* sqrt direto: hypot evita overflow (impossivel nessas escalas) e custa bem mais */
+static inline double point_dist(const weighted_point* a, const weighted_point* b)
+{
+    double dx = a->x - b->x, dy = a->y - b->y;
+    return sqrt(dx * dx + dy * dy);
+}
+
+/* mais proximo e segundo mais proximo de cada ponto entre os medoides `med` */
+static void nearest_two(const weighted_point* pts, size_t m, const size_t* med, int k, int* nearest,
+                        double* dn, double* ds)
+{
+    #pragma omp parallel for schedule(static)
+    for (size_t o = 0; o < m; o++)
+    {
+        double d1 = INFINITY, d2 = INFINITY;
+        int best = 0;
+        for (int i = 0; i < k; i++)
+        {
+            double d = point_dist(&pts[o], &pts[med[i]]);
+            if (d < d1)
+            {
+                d2 = d1;
+                d1 = d;
+                best = i;
+            }
+            else if (d < d2)
+            {
+                d2 = d;
+            }
+        }
+        nearest[o] = best;
+        dn[o] = d1;
+        ds[o] = d2;
+    }
+}
+
+/*
+ * Ganho (variacao do custo, negativo = melhora) de trocar o melhor medoide
+ * pelo ponto c. `removal` e a perda de remover cada medoide; `dtd` e
+ * rascunho de k posicoes. Retorna o medoide a sair em *out.
+ */
+static double swap_gain(const weighted_point* pts, size_t m, size_t c, int k, const int* nearest,
+                        const double* dn, const double* ds, const double* removal, double* dtd, int* out)
+{
+    memcpy(dtd, removal, sizeof(double) * k);
+    double shared = 0.0;
+    for (size_t o = 0; o < m; o++)
+    {
+        double d = point_dist(&pts[o], &pts[c]);
+        double w = pts[o].w;
+        if (d < dn[o])
+        {
+            /* o vai para c qualquer que seja o medoide removido */
+            shared += w * (d - dn[o]);
+            dtd[nearest[o]] += w * (dn[o] - ds[o]);
+        }
+        else if (d < ds[o])
+        {
+            /* se o medoide de o sair, c fica mais perto que o segundo */
+            dtd[nearest[o]] += w * (d - ds[o]);
+        }
+    }
+    int best = 0;
+    for (int i = 1; i < k; i++)
+    {
+        best = dtd[i] < dtd[best] ? i : best;
+    }
+    *out = best;
+    return dtd[best] + shared;
+}
+
+static void removal_loss(const weighted_point* pts, size_t m, int k, const int* nearest, const double* dn,
+                         const double* ds, double* removal)
+{
+    memset(removal, 0, sizeof(double) * k);
+    for (size_t o = 0; o < m; o++)
+    {
+        removal[nearest[o]] += pts[o].w * (ds[o] - dn[o]);
+    }
+}
+
+/*
+ * FasterPAM sobre a amostra ponderada a partir dos medoides em `med`
+ * (indices na amostra, distintos). Soma as trocas em `swaps`. Retorna 0, ou
+ * -1 sem memoria.
+ */
+static int faster_pam(const weighted_point* pts, size_t m, int k, size_t* med, size_t* swaps,
+                      size_t* candidates)
+{
+    int nthreads = omp_get_max_threads();
+    int* nearest = (int*)malloc(sizeof(int) * m);
+    double* dn = (double*)malloc(sizeof(double) * m);
+    double* ds = (double*)malloc(sizeof(double) * m);
+    unsigned char* is_medoid = (unsigned char*)calloc(m, 1);
+    double* removal = (double*)malloc(sizeof(double) * k);
+    double* dtd_all = (double*)malloc(sizeof(double) * (size_t)k * nthreads); /* k por thread */
+    if (!nearest || !dn || !ds || !is_medoid || !removal || !dtd_all)
+    {
+        free(nearest);
+        free(dn);
+        free(ds);
+        free(is_medoid);
+        free(removal);
+        free(dtd_all);
+        return -1;
+    }
+    double gain[SWAP_BLOCK];
+    int target[SWAP_BLOCK];
+
+    for (int i = 0; i < k; i++)
+    {
+        is_medoid[med[i]] = 1;
+    }
+    nearest_two(pts, m, med, k, nearest, dn, ds);
+    removal_loss(pts, m, k, nearest, dn, ds, removal);
+
+    size_t since_swap = 0;  /* candidatos avaliados desde a ultima troca */
+    size_t evaluated = 0;
+    size_t next = 0;
+    while (since_swap < m && evaluated < (size_t)MAX_PASSES * m)
+    {
+        size_t block = m - next < SWAP_BLOCK ? m - next : SWAP_BLOCK;
+
+        #pragma omp parallel num_threads(nthreads)
+        {
+            double* dtd = dtd_all + (size_t)k * omp_get_thread_num();
+
+            #pragma omp for schedule(dynamic, 1)
+            for (size_t b = 0; b < block; b++)
+            {
+                size_t c = next + b;
+                target[b] = 0;
+                gain[b] = is_medoid[c] ? 0.0
+                                       : swap_gain(pts, m, c, k, nearest, dn, ds, removal, dtd, &target[b]);
+            }
+        }
+        evaluated += block;
+
+        size_t best = 0;
+        for (size_t b = 1; b < block; b++)
+        {
+            best = gain[b] < gain[best] ? b : best;
+        }
+        /* tolerancia relativa: ganhos de arredondamento nao contam como melhora */
+        if (gain[best] < -1e-12 * (1.0 + fabs(removal[target[best]])))
+        {
+            size_t c = next + best;
+            is_medoid[med[target[best]]] = 0;
+            med[target[best]] = c;
+            is_medoid[c] = 1;
+            nearest_two(pts, m, med, k, nearest, dn, ds);
+            removal_loss(pts, m, k, nearest, dn, ds, removal);
+            (*swaps)++;
+            /* candidatos do bloco foram avaliados contra os medoides antigos:
+             * so uma volta completa sem trocas prova o otimo local */
+            since_swap = 0;
+        }
+        else
+        {
+            since_swap += block;
+        }
+        next = next + block == m ? 0 : next + block;
+    }
+
+    *candidates += evaluated;
+    free(nearest);
+    free(dn);
+    free(ds);
+    free(is_medoid);
+    free(removal);
+    free(dtd_all);
+    return 0;
+}
+
+/* soma das distancias de toda a base ao medoide mais proximo */
+static double total_deviation(const observation* observations, size_t size, const cluster* medoids, int k)
+{
+    double cost = 0.0;
+    #pragma omp parallel for reduction(+ : cost) schedule(static)
+    for (size_t j = 0; j < size; j++)
+    {
+        int g = calculateNearest(&observations[j], medoids, k);
+        double dx = observations[j].x - medoids[g].x, dy = observations[j].y - medoids[g].y;
+        cost += sqrt(dx * dx + dy * dy);
+    }
+    return cost;
+}
+
+/*
+ * K-medoids com a mesma interface de kMeans_omp: rotulos em
+ * observations[].group e um cluster por medoide (coordenadas do medoide,
+ * pontos do grupo). `medoid_rows` (k, opcional) recebe o indice de cada
+ * medoide na base (SIZE_MAX para grupo sem medoide, quando k > size).
+ */
+static cluster* kMedoids_omp(observation* observations, size_t size, int k, size_t sample_size,
+                             size_t* medoid_rows, medoid_stats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    cluster* clusters = kMeans_omp_trivial(observations, size, k);
+    if (clusters)
+    {
+        /* k >= size: cada ponto e o proprio medoide */
+        for (int i = 0; medoid_rows && i < k; i++)
+        {
+            medoid_rows[i] = (size_t)i < size ? (size_t)i : SIZE_MAX;
+        }
+        return clusters;
+    }
+
+    size_t cap = sample_size + (size_t)k;
+    weighted_point* pts = (weighted_point*)malloc(sizeof(weighted_point) * cap);
+    size_t* med = (size_t*)malloc(sizeof(size_t) * k);
+    size_t* best_rows = (size_t*)malloc(sizeof(size_t) * k);
+    cluster* trial = (cluster*)calloc(k, sizeof(cluster));
+    clusters = (cluster*)calloc(k, sizeof(cluster));
+    if (!pts || !med || !best_rows || !trial || !clusters)
+    {
+        free(pts);
+        free(med);
+        free(best_rows);
+        free(trial);
+        free(clusters);
+        return NULL;
+    }
+
+    double best_cost = INFINITY;
+    for (int draw = 0; draw < CLARA_DRAWS; draw++)
+    {
+        /* amostra (com os melhores medoides ate aqui) e duplicatas como peso */
+        size_t m = 0;
+        if (best_cost < INFINITY)
+        {
+            for (int i = 0; i < k; i++, m++)
+            {
+                pts[m].x = observations[best_rows[i]].x;
+                pts[m].y = observations[best_rows[i]].y;
+                pts[m].w = 1.0;
+                pts[m].row = best_rows[i];
+            }
+        }
+        for (size_t s = 0; s < sample_size; s++, m++)
+        {
+            size_t j = (size_t)(((double)rand() / ((double)RAND_MAX + 1.0)) * size);
+            pts[m].x = observations[j].x;
+            pts[m].y = observations[j].y;
+            pts[m].w = 1.0;
+            pts[m].row = j;
+        }
+        m = collapse_duplicates(pts, m);
+        stats->sample_points += m;
+        if (m <= (size_t)k)
+        {
+            continue; /* amostra com menos pontos distintos que k */
+        }
+
+        /* medoides iniciais: k pontos distintos sorteados (o FasterPAM nao precisa do BUILD) */
+        for (int i = 0; i < k; i++)
+        {
+            int fresh;
+            do
+            {
+                med[i] = (size_t)rand() % m;
+                fresh = 1;
+                for (int p = 0; p < i; p++)
+                {
+                    fresh = fresh && med[p] != med[i];
+                }
+            } while (!fresh);
+        }
+        if (faster_pam(pts, m, k, med, &stats->swaps, &stats->candidates) != 0)
+        {
+            free(pts);
+            free(med);
+            free(best_rows);
+            free(trial);
+            free(clusters);
+            return NULL;
+        }
+        stats->draws++;
+
+        for (int i = 0; i < k; i++)
+        {
+            trial[i].x = pts[med[i]].x;
+            trial[i].y = pts[med[i]].y;
+        }
+        double cost = total_deviation(observations, size, trial, k);
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            for (int i = 0; i < k; i++)
+            {
+                best_rows[i] = pts[med[i]].row;
+            }
+        }
+    }
+
+    if (best_cost == INFINITY)
+    {
+        /* nenhuma amostra com k pontos distintos: primeiros pontos da base */
+        for (int i = 0; i < k; i++)
+        {
+            best_rows[i] = (size_t)i;
+        }
+    }
+    for (int i = 0; i < k; i++)
+    {
+        clusters[i].x = observations[best_rows[i]].x;
+        clusters[i].y = observations[best_rows[i]].y;
+        clusters[i].count = 0;
+        if (medoid_rows)
+        {
+            medoid_rows[i] = best_rows[i];
+        }
+    }
+    kMeans_omp_assign(observations, size, clusters, k);
+    for (size_t j = 0; j < size; j++)
+    {
+        clusters[observations[j].group].count++;
+    }
+    stats->cost = total_deviation(observations, size, clusters, k);
+
+    free(pts);
+    free(med);
+    free(best_rows);
+    free(trial);
+    return clusters;
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    int k = argc > 1 ? atoi(argv[1]) : 5;
+    size_t sample_size = argc > 2 ? (size_t)strtoull(argv[2], NULL, 10) : CLARA_SAMPLE;
+    if (k < 2 || sample_size < (size_t)k)
+    {
+        fprintf(stderr, "Erro: k deve ser >= 2 e a amostra >= k.\n");
+        return 1;
+    }
+
+    size_t size = 0;
+    observation* observations = load_observations(filename, &size);
+    if (!observations)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
+
+    int thread_configs[] = {1, 2, 4, 8, 16, 32};
+    int num_configs = (int)(sizeof(thread_configs) / sizeof(thread_configs[0]));
+
+    printf("K-Medoids OpenMP (CPU) - CLARA + FasterPAM\n");
+    printf("Observacoes efetivas: %zu, clusters: %d, amostra: %zu linhas x %d, bloco de trocas: %d\n",
+           size, k, sample_size, CLARA_DRAWS, SWAP_BLOCK);
+
+    size_t medoid_rows[64];
+    size_t* rows = k <= 64 ? medoid_rows : (size_t*)malloc(sizeof(size_t) * k);
+    if (!rows)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        free(observations);
+        return 1;
+    }
+    cluster* medoids = NULL;
+    cluster* means = NULL;
+    medoid_stats stats;
+    for (int c = 0; c < num_configs; c++)
+    {
+        int threads = thread_configs[c];
+        omp_set_num_threads(threads);
+
+        srand((unsigned int)time(NULL));
+
+        medoid_stats total = {0, 0, 0, 0, 0.0};
+        double start = omp_get_wtime();
+        for (int run = 0; run < NUM_RUNS; run++)
+        {
+            free(medoids);
+            medoids = kMedoids_omp(observations, size, k, sample_size, rows, &stats);
+            if (!medoids)
+            {
+                break;
+            }
+            total.sample_points += stats.sample_points;
+            total.swaps += stats.swaps;
+            total.candidates += stats.candidates;
+        }
+        double medoid_elapsed = omp_get_wtime() - start;
+        if (!medoids)
+        {
+            break;
+        }
+
+        /* mesmo laco de benchmark do kMeans_omp, para comparar */
+        start = omp_get_wtime();
+        for (int run = 0; run < NUM_RUNS; run++)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                observations[i].group = 0;
+            }
+            free(means);
+            means = kMeans_omp(observations, size, k);
+            if (!means)
+            {
+                break;
+            }
+        }
+        double means_elapsed = omp_get_wtime() - start;
+        if (!means)
+        {
+            break;
+        }
+
+        printf("Threads: %2d -> k-medoids: total (%d execucoes) %.6f s, medio %.6f s "
+               "(%.0f pontos distintos, %.1f trocas, %.0f candidatos por execucao); "
+               "k-means: medio %.6f s\n",
+               threads, NUM_RUNS, medoid_elapsed, medoid_elapsed / NUM_RUNS,
+               (double)total.sample_points / NUM_RUNS, (double)total.swaps / NUM_RUNS,
+               (double)total.candidates / NUM_RUNS, means_elapsed / NUM_RUNS);
+    }
+
+    if (!medoids || !means)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        if (rows != medoid_rows)
+        {
+            free(rows);
+        }
+        free(medoids);
+        free(means);
+        free(observations);
+        return 1;
+    }
+
+    /* custo em distancia (nao ao quadrado) das duas solucoes da ultima execucao */
+    double means_cost = total_deviation(observations, size, means, k);
+    printf("Soma das distancias: k-medoids %.6e, k-means %.6e\n", stats.cost, means_cost);
+    size_t rows_per_copy = size / REPLICATION_FACTOR > 0 ? size / REPLICATION_FACTOR : size;
+    for (int i = 0; i < k; i++)
+    {
+        if (rows[i] == SIZE_MAX)
+        {
+            printf("Medoide %d: sem pontos\n", i);
+            continue;
+        }
+        printf("Medoide %d: usuario da linha %zu, (%.4f, %.4f), pontos=%zu\n", i, rows[i] % rows_per_copy,
+               medoids[i].x, medoids[i].y, medoids[i].count);
+    }
+
+    if (rows != medoid_rows)
+    {
+        free(rows);
+    }
+    free(medoids);
+    free(means);
+    free(observations);
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "kmeans_common.h"
+
+// Multi-resolucao: Lloyd em subamostras cada vez maiores (1%, 10%, 100%),
+// cada etapa comecando dos centroides da anterior. Assim as iteracoes caras
+// sobre a base completa ja partem perto da convergencia.
+
+#define MAX_STAGES 3            /* 1%, 10%, 100% */
+#define STAGE_SHRINK 10         /* fator entre etapas consecutivas */
+#define MIN_POINTS_PER_CLUSTER 200 /* menor etapa precisa de pelo menos isso por cluster */
+
+/* indice aleatorio em [0, n) mesmo quando n > RAND_MAX */
+static size_t random_index(size_t n)
+{
+    size_t r = ((size_t)rand() << 31) ^ (size_t)rand();
+    return r % n;
+}
+
+/* escolhe os tamanhos das etapas: n/10^s enquanto houver pontos suficientes por cluster */
+static int plan_stages(size_t size, int k, size_t* stage_sizes)
+{
+    size_t sizes[MAX_STAGES];
+    int count = 0;
+    size_t s = size;
+    sizes[count++] = s;
+    while (count < MAX_STAGES && s / STAGE_SHRINK >= (size_t)MIN_POINTS_PER_CLUSTER * (size_t)k)
+    {
+        s /= STAGE_SHRINK;
+        sizes[count++] = s;
+    }
+
+    /* menor etapa primeiro */
+    for (int i = 0; i < count; i++)
+    {
+        stage_sizes[i] = sizes[count - 1 - i];
+    }
+    return count;
+}
+
+/*
+ * Ajuste hierarquico. `full_iterations` recebe quantas iteracoes de Lloyd
+ * rodaram sobre a base completa (a ultima etapa).
+ */
+static cluster* kMeans_omp_multires(observation* observations, size_t size, int k,
+                                    size_t* full_iterations)
+{
+    cluster* clusters = kMeans_omp_trivial(observations, size, k);
+    if (clusters)
+    {
+        *full_iterations = 0;
+        return clusters;
+    }
+
+    size_t stage_sizes[MAX_STAGES];
+    int stages = plan_stages(size, k, stage_sizes);
+
+    observation* sample = NULL;
+    if (stages > 1)
+    {
+        sample = (observation*)malloc(sizeof(observation) * stage_sizes[stages - 2]);
+        if (!sample)
+        {
+            return kMeans_omp_iters(observations, size, k, full_iterations);
+        }
+    }
+
+    for (int s = 0; s < stages - 1; s++)
+    {
+        size_t m = stage_sizes[s];
+        for (size_t j = 0; j < m; j++)
+        {
+            sample[j] = observations[random_index(size)];
+            sample[j].group = 0;
+        }
+
+        if (s == 0)
+        {
+            clusters = kMeans_omp(sample, m, k);
+        }
+        else
+        {
+            kMeans_omp_warm(sample, m, k, clusters, NULL);
+        }
+    }
+    free(sample);
+
+    if (!clusters)
+    {
+        return kMeans_omp_iters(observations, size, k, full_iterations);
+    }
+
+    kMeans_omp_warm(observations, size, k, clusters, full_iterations);
+    return clusters;
+}
+
+int main(void)
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    int k = 5;
+
+    size_t size = 0;
+    observation* observations = load_observations(filename, &size);
+    if (!observations)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
+
+    size_t stage_sizes[MAX_STAGES];
+    int stages = plan_stages(size, k, stage_sizes);
+
+    printf("K-Means OpenMP (CPU) - multi-resolucao\n");
+    printf("Observacoes efetivas: %zu, clusters: %d, threads: %d\n", size, k, omp_get_max_threads());
+    printf("Etapas:");
+    for (int s = 0; s < stages; s++)
+    {
+        printf(" %zu", stage_sizes[s]);
+    }
+    printf("\n");
+
+    srand((unsigned int)time(NULL));
+
+    /* referencia: particao aleatoria + Lloyd direto na base completa */
+    size_t base_iters_total = 0;
+    cluster* clusters = NULL;
+    double start = omp_get_wtime();
+    for (int run = 0; run < NUM_RUNS; run++)
+    {
+        size_t iters = 0;
+        free(clusters);
+        clusters = kMeans_omp_iters(observations, size, k, &iters);
+        base_iters_total += iters;
+    }
+    double base_elapsed = omp_get_wtime() - start;
+    free(clusters);
+    clusters = NULL;
+
+    size_t multi_iters_total = 0;
+    start = omp_get_wtime();
+    for (int run = 0; run < NUM_RUNS; run++)
+    {
+        size_t iters = 0;
+        free(clusters);
+        clusters = kMeans_omp_multires(observations, size, k, &iters);
+        multi_iters_total += iters;
+    }
+    double multi_elapsed = omp_get_wtime() - start;
+
+    double base_iters = (double)base_iters_total / NUM_RUNS;
+    double multi_iters = (double)multi_iters_total / NUM_RUNS;
+
+    printf("Particao aleatoria -> tempo total (%d execucoes): %.6f s, medio: %.6f s, iteracoes na base completa: %.2f\n",
+           NUM_RUNS, base_elapsed, base_elapsed / NUM_RUNS, base_iters);
+    printf("Multi-resolucao    -> tempo total (%d execucoes): %.6f s, medio: %.6f s, iteracoes na base completa: %.2f\n",
+           NUM_RUNS, multi_elapsed, multi_elapsed / NUM_RUNS, multi_iters);
+    printf("Iteracoes economizadas na base completa: %.2f por execucao (%.1f%%)\n",
+           base_iters - multi_iters,
+           base_iters > 0.0 ? 100.0 * (base_iters - multi_iters) / base_iters : 0.0);
+
+    for (int i = 0; i < k; i++)
+    {
+        printf("Cluster %d: centroid (%.4f, %.4f), pontos=%zu\n", i,
+               clusters[i].x, clusters[i].y, clusters[i].count);
+    }
+
+    free(clusters);
+    free(observations);
+    return 0;
+}
@@ -0,0 +1,710 @@
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kmeans_common.h"
+
+// Acumulo por rotulo ordenado: o acumulo padrao faz `clusters[g].x += ...`
+// com g dependente do dado, o que impede vetorizacao. Aqui os pontos ficam
+// fisicamente agrupados por rotulo (x e y em vetores separados), arrumados
+// por um counting sort paralelo e estavel; cada segmento contiguo e somado
+// com `omp simd` e as somas dos segmentos ficam guardadas. Como os dados nao
+// mudam, entre duas reordenacoes o acumulo e so: somas dos segmentos +
+// correcoes dos pontos cujo rotulo atual difere do rotulo do seu segmento
+// (lista compacta refeita na reatribuicao). Quando essa lista passa de
+// RESORT_FRACTION da base, os pontos sao reordenados, mas so depois que os
+// rotulos assentam: enquanto muitos pontos trocam por iteracao (inicio do
+// ajuste) ordenar nao se paga e o acumulo e a dispersao comum.
+//
+// Com COMPENSATED_SUM=1 as somas dos segmentos e o acumulo por dispersao
+// seguem o mesmo esquema de kMeans_omp_accumulate_compensated: blocos de
+// SUM_BLOCK pontos somados de forma ingenua e parciais com Neumaier.
+//
+// Uso: ./kmeans_omp_sorted [k]
+
+#ifndef RESORT_FRACTION
+#define RESORT_FRACTION 0.02 /* fracao de pontos fora do segmento que dispara a reordenacao */
+#endif
+
+#define BENCH_REPEATS 5
+
+typedef struct
+{
+    size_t n;
+    int k;
+    double* x;     /* coordenadas na ordem dos segmentos */
+    double* y;
+    size_t* perm;  /* posicao -> indice original */
+    int* label;    /* rotulo atual de cada posicao */
+    size_t* seg;   /* k + 1 inicios de segmento (rotulos da ultima ordenacao) */
+    double* seg_x; /* somas de cada segmento */
+    double* seg_y;
+    unsigned char* off;  /* posicao com rotulo diferente do segmento */
+    size_t* moved;       /* posicoes com off != 0 */
+    size_t n_moved;
+    int sorted;    /* segmentos validos (houve ordenacao) */
+    size_t resorts;
+
+    /* buffers da ordenacao */
+    double* tx;
+    double* ty;
+    size_t* tperm;
+    int* tlabel;
+    size_t* hist; /* nthreads x k */
+
+    /* buffers por thread dos acumulos, alocados uma vez */
+    int nthreads;
+    double* scratch;      /* nthreads x 6k: somas x/y, compensacao e parcial do bloco */
+    long long* scratch_n; /* nthreads x k: contagens ou deltas de contagem */
+    double* comp;         /* 2k: compensacao entre threads */
+} sorted_layout;
+
+static void layout_free(sorted_layout* l)
+{
+    free(l->x);
+    free(l->y);
+    free(l->perm);
+    free(l->label);
+    free(l->seg);
+    free(l->seg_x);
+    free(l->seg_y);
+    free(l->off);
+    free(l->moved);
+    free(l->tx);
+    free(l->ty);
+    free(l->tperm);
+    free(l->tlabel);
+    free(l->hist);
+    free(l->scratch);
+    free(l->scratch_n);
+    free(l->comp);
+}
+
+static int layout_alloc(sorted_layout* l, size_t n, int k)
+{
+    memset(l, 0, sizeof(*l));
+    l->n = n;
+    l->k = k;
+    l->x = (double*)malloc(sizeof(double) * n);
+    l->y = (double*)malloc(sizeof(double) * n);
+    l->perm = (size_t*)malloc(sizeof(size_t) * n);
+    l->label = (int*)malloc(sizeof(int) * n);
+    l->seg = (size_t*)calloc((size_t)k + 1, sizeof(size_t));
+    l->seg_x = (double*)calloc((size_t)k, sizeof(double));
+    l->seg_y = (double*)calloc((size_t)k, sizeof(double));
+    l->off = (unsigned char*)malloc(n);
+    l->moved = (size_t*)malloc(sizeof(size_t) * n);
+    l->tx = (double*)malloc(sizeof(double) * n);
+    l->ty = (double*)malloc(sizeof(double) * n);
+    l->tperm = (size_t*)malloc(sizeof(size_t) * n);
+    l->tlabel = (int*)malloc(sizeof(int) * n);
+    l->nthreads = omp_get_max_threads();
+    l->hist = (size_t*)malloc(sizeof(size_t) * (size_t)l->nthreads * k);
+    l->scratch = (double*)malloc(sizeof(double) * (size_t)l->nthreads * 6 * k);
+    l->scratch_n = (long long*)malloc(sizeof(long long) * (size_t)l->nthreads * k);
+    l->comp = (double*)malloc(sizeof(double) * 2 * (size_t)k);
+    if (!l->x || !l->y || !l->perm || !l->label || !l->seg || !l->seg_x || !l->seg_y || !l->off ||
+        !l->moved || !l->tx || !l->ty || !l->tperm || !l->tlabel || !l->hist || !l->scratch ||
+        !l->scratch_n || !l->comp)
+    {
+        layout_free(l);
+        return -1;
+    }
+    return 0;
+}
+
+/* somas de cada segmento contiguo com reducao SIMD */
+static void segment_sums(sorted_layout* l)
+{
+    const double* x = l->x;
+    const double* y = l->y;
+    for (int c = 0; c < l->k; c++)
+    {
+#if COMPENSATED_SUM
+        /* blocos SIMD ingenuos; parciais dos blocos e das threads com Neumaier */
+        double sx = 0.0, sy = 0.0, cx = 0.0, cy = 0.0;
+        #pragma omp parallel num_threads(l->nthreads)
+        {
+            double lx = 0.0, ly = 0.0, lcx = 0.0, lcy = 0.0;
+            #pragma omp for schedule(static)
+            for (size_t b = l->seg[c]; b < l->seg[c + 1]; b += SUM_BLOCK)
+            {
+                size_t end = b + SUM_BLOCK < l->seg[c + 1] ? b + SUM_BLOCK : l->seg[c + 1];
+                double bx = 0.0, by = 0.0;
+                #pragma omp simd reduction(+ : bx, by)
+                for (size_t i = b; i < end; i++)
+                {
+                    bx += x[i];
+                    by += y[i];
+                }
+                neumaier_add(&lx, &lcx, bx);
+                neumaier_add(&ly, &lcy, by);
+            }
+            #pragma omp critical
+            {
+                neumaier_add(&sx, &cx, lx + lcx);
+                neumaier_add(&sy, &cy, ly + lcy);
+            }
+        }
+        l->seg_x[c] = sx + cx;
+        l->seg_y[c] = sy + cy;
+#else
+        double sx = 0.0, sy = 0.0;
+        #pragma omp parallel for simd reduction(+ : sx, sy) schedule(static) num_threads(l->nthreads)
+        for (size_t i = l->seg[c]; i < l->seg[c + 1]; i++)
+        {
+            sx += x[i];
+            sy += y[i];
+        }
+        l->seg_x[c] = sx;
+        l->seg_y[c] = sy;
+#endif
+    }
+}
+
+/*
+ * Counting sort paralelo e estavel das posicoes pelo rotulo atual: cada
+ * thread conta o proprio bloco estatico, a soma de prefixos na ordem
+ * (rotulo, thread) da o destino de cada bloco e a dispersao e feita sem
+ * sincronizacao. Depois recalcula as somas dos segmentos.
+ */
+static void layout_sort(sorted_layout* l)
+{
+    size_t n = l->n;
+    int k = l->k;
+    int nthreads = l->nthreads;
+    size_t* hist = l->hist;
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        size_t begin = n * t / nt;
+        size_t end = n * (t + 1) / nt;
+        size_t* mine = hist + (size_t)t * k;
+
+        for (int c = 0; c < k; c++)
+        {
+            mine[c] = 0;
+        }
+        for (size_t i = begin; i < end; i++)
+        {
+            mine[l->label[i]]++;
+        }
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            size_t pos = 0;
+            for (int c = 0; c < k; c++)
+            {
+                l->seg[c] = pos;
+                for (int u = 0; u < nt; u++)
+                {
+                    size_t count = hist[(size_t)u * k + c];
+                    hist[(size_t)u * k + c] = pos;
+                    pos += count;
+                }
+            }
+            l->seg[k] = pos;
+        }
+
+        for (size_t i = begin; i < end; i++)
+        {
+            size_t dst = mine[l->label[i]]++;
+            l->tx[dst] = l->x[i];
+            l->ty[dst] = l->y[i];
+            l->tperm[dst] = l->perm[i];
+            l->tlabel[dst] = l->label[i];
+        }
+    }
+
+    double* swap_d = l->x;
+    l->x = l->tx;
+    l->tx = swap_d;
+    swap_d = l->y;
+    l->y = l->ty;
+    l->ty = swap_d;
+    size_t* swap_s = l->perm;
+    l->perm = l->tperm;
+    l->tperm = swap_s;
+    int* swap_i = l->label;
+    l->label = l->tlabel;
+    l->tlabel = swap_i;
+
+    l->n_moved = 0;
+    l->sorted = 1;
+    l->resorts++;
+    segment_sums(l);
+}
+
+/* copia as observacoes para o layout, ainda sem ordenar (rotulos atuais) */
+static void layout_build(sorted_layout* l, const observation* observations)
+{
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < l->n; i++)
+    {
+        l->x[i] = observations[i].x;
+        l->y[i] = observations[i].y;
+        l->perm[i] = i;
+        l->label[i] = observations[i].group;
+    }
+    /* sem ordenacao a reatribuicao percorre tudo como um segmento so */
+    l->seg[0] = 0;
+    for (int c = 1; c <= l->k; c++)
+    {
+        l->seg[c] = l->n;
+    }
+    l->n_moved = 0;
+    l->sorted = 0;
+    l->resorts = 0;
+}
+
+/* segmento (rotulo da ultima ordenacao) que contem a posicao `pos` */
+static inline int segment_of(const size_t* seg, int k, size_t pos)
+{
+    int lo = 0, hi = k - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (seg[mid] <= pos)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/*
+ * Acumulo por dispersao sobre o layout (buffers por thread), sem segmentos.
+ * Com COMPENSATED_SUM os pontos sao somados em blocos de SUM_BLOCK e os
+ * parciais dos blocos e das threads passam pela soma de Neumaier.
+ */
+static void layout_scatter_accumulate(sorted_layout* l, cluster* clusters)
+{
+    int k = l->k;
+    const double* x = l->x;
+    const double* y = l->y;
+    const int* label = l->label;
+    double* comp = l->comp;
+    for (int c = 0; c < k; c++)
+    {
+        clusters[c].x = 0.0;
+        clusters[c].y = 0.0;
+        clusters[c].count = 0;
+        comp[c] = 0.0;
+        comp[k + c] = 0.0;
+    }
+
+    #pragma omp parallel num_threads(l->nthreads)
+    {
+        int t = omp_get_thread_num();
+        double* sx = l->scratch + (size_t)t * 6 * k; /* [0,k) x, [k,2k) y */
+        double* sy = sx + k;
+        long long* sn = l->scratch_n + (size_t)t * k;
+        memset(sx, 0, sizeof(double) * 6 * k);
+        memset(sn, 0, sizeof(long long) * k);
+
+#if COMPENSATED_SUM
+        double* scomp = sx + 2 * k;
+        double* block = sx + 4 * k;
+        #pragma omp for schedule(static)
+        for (size_t b = 0; b < l->n; b += SUM_BLOCK)
+        {
+            size_t end = b + SUM_BLOCK < l->n ? b + SUM_BLOCK : l->n;
+            for (size_t i = b; i < end; i++)
+            {
+                int g = label[i];
+                block[g] += x[i];
+                block[k + g] += y[i];
+                sn[g]++;
+            }
+            for (int c = 0; c < 2 * k; c++)
+            {
+                neumaier_add(&sx[c], &scomp[c], block[c]);
+                block[c] = 0.0;
+            }
+        }
+
+        #pragma omp critical
+        {
+            for (int c = 0; c < k; c++)
+            {
+                neumaier_add(&clusters[c].x, &comp[c], sx[c] + scomp[c]);
+                neumaier_add(&clusters[c].y, &comp[k + c], sy[c] + scomp[k + c]);
+                clusters[c].count += (size_t)sn[c];
+            }
+        }
+#else
+        #pragma omp for schedule(static)
+        for (size_t i = 0; i < l->n; i++)
+        {
+            int g = label[i];
+            sx[g] += x[i];
+            sy[g] += y[i];
+            sn[g]++;
+        }
+
+        #pragma omp critical
+        {
+            for (int c = 0; c < k; c++)
+            {
+                clusters[c].x += sx[c];
+                clusters[c].y += sy[c];
+                clusters[c].count += (size_t)sn[c];
+            }
+        }
+#endif
+    }
+
+    for (int c = 0; c < k; c++)
+    {
+        clusters[c].x += comp[c];
+        clusters[c].y += comp[k + c];
+    }
+}
+
+/*
+ * Acumulo incremental: somas dos segmentos + correcoes das posicoes fora do
+ * segmento (sai do segmento, entra no rotulo atual), com deltas por thread.
+ */
+static void layout_accumulate(sorted_layout* l, cluster* clusters)
+{
+    int k = l->k;
+    for (int c = 0; c < k; c++)
+    {
+        clusters[c].x = l->seg_x[c];
+        clusters[c].y = l->seg_y[c];
+        clusters[c].count = l->seg[c + 1] - l->seg[c];
+    }
+    if (l->n_moved == 0)
+    {
+        return;
+    }
+
+    #pragma omp parallel num_threads(l->nthreads)
+    {
+        int t = omp_get_thread_num();
+        double* dx = l->scratch + (size_t)t * 6 * k;
+        double* dy = dx + k;
+        long long* dn = l->scratch_n + (size_t)t * k;
+        memset(dx, 0, sizeof(double) * 2 * k);
+        memset(dn, 0, sizeof(long long) * k);
+
+        #pragma omp for schedule(static)
+        for (size_t m = 0; m < l->n_moved; m++)
+        {
+            size_t i = l->moved[m];
+            int home = segment_of(l->seg, k, i);
+            int g = l->label[i];
+            dx[home] -= l->x[i];
+            dy[home] -= l->y[i];
+            dn[home]--;
+            dx[g] += l->x[i];
+            dy[g] += l->y[i];
+            dn[g]++;
+        }
+
+        #pragma omp critical
+        {
+            for (int c = 0; c < k; c++)
+            {
+                clusters[c].x += dx[c];
+                clusters[c].y += dy[c];
+                clusters[c].count = (size_t)((long long)clusters[c].count + dn[c]);
+            }
+        }
+    }
+}
+
+/*
+ * Reatribuicao sobre o layout: percorre cada segmento em ordem, marca as
+ * posicoes cujo rotulo novo difere do segmento e refaz a lista `moved`.
+ */
+static size_t layout_assign(sorted_layout* l, const cluster* clusters)
+{
+    int k = l->k;
+    const double* x = l->x;
+    const double* y = l->y;
+    const size_t* seg = l->seg;
+    int* label = l->label;
+    unsigned char* off = l->off;
+    size_t changed = 0;
+
+    #pragma omp parallel reduction(+ : changed)
+    {
+        for (int c = 0; c < k; c++)
+        {
+            #pragma omp for schedule(static) nowait
+            for (size_t i = seg[c]; i < seg[c + 1]; i++)
+            {
+                double minD = DBL_MAX;
+                int g = 0;
+                for (int h = 0; h < k; h++)
+                {
+                    double dx = clusters[h].x - x[i];
+                    double dy = clusters[h].y - y[i];
+                    double dist = dx * dx + dy * dy;
+                    if (dist < minD)
+                    {
+                        minD = dist;
+                        g = h;
+                    }
+                }
+                changed += g != label[i];
+                label[i] = g;
+                off[i] = g != c;
+            }
+        }
+    }
+
+    l->n_moved = l->sorted ? kmeans_compact(NULL, l->off, l->n, l->moved) : 0;
+    return changed;
+}
+
+/* rotulos de volta para as observacoes (ordem original) */
+static void layout_scatter_labels(const sorted_layout* l, observation* observations)
+{
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < l->n; i++)
+    {
+        observations[l->perm[i]].group = l->label[i];
+    }
+}
+
+/*
+ * Lloyd sobre o layout `l` (ja alocado) a partir dos grupos presentes em
+ * `observations`; mesma semantica de kMeans_omp_lloyd.
+ */
+static void kMeans_omp_sorted(sorted_layout* l, observation* observations, size_t size, int k,
+                              cluster* clusters, size_t* iterations)
+{
+    layout_build(l, observations);
+
+    size_t minAcceptedError = size / 10000;
+    size_t settled = (size_t)(RESORT_FRACTION * size);
+    size_t changed = size;
+    size_t iters = 0;
+    do
+    {
+        if (!l->sorted || l->n_moved > settled)
+        {
+            if (changed <= settled)
+            {
+                layout_sort(l);
+            }
+        }
+        if (l->sorted && l->n_moved <= settled)
+        {
+            layout_accumulate(l, clusters);
+        }
+        else
+        {
+            layout_scatter_accumulate(l, clusters);
+        }
+        for (int c = 0; c < k; c++)
+        {
+            if (clusters[c].count > 0)
+            {
+                clusters[c].x /= clusters[c].count;
+                clusters[c].y /= clusters[c].count;
+            }
+        }
+        changed = layout_assign(l, clusters);
+        iters++;
+    } while (changed > minAcceptedError);
+
+    layout_scatter_labels(l, observations);
+    *iterations = iters;
+}
+
+/* particao aleatoria reprodutivel para comparar os motores */
+static void random_partition(observation* observations, size_t size, int k, unsigned int seed)
+{
+    for (size_t j = 0; j < size; j++)
+    {
+        observations[j].group = (int)(rand_r(&seed) % (unsigned int)k);
+    }
+}
+
+/* melhor tempo de BENCH_REPEATS chamadas */
+#define BEST_OF(best, stmt)                                   \
+    do                                                        \
+    {                                                         \
+        best = 1e30;                                          \
+        for (int r_ = 0; r_ < BENCH_REPEATS; r_++)            \
+        {                                                     \
+            double s_ = omp_get_wtime();                      \
+            stmt;                                             \
+            double e_ = omp_get_wtime() - s_;                 \
+            best = e_ < best ? e_ : best;                     \
+        }                                                     \
+    } while (0)
+
+/*
+ * Micro-benchmark do acumulo com os rotulos de `observations` fixos:
+ * dispersao com buffers por thread (kMeans_omp_accumulate) contra ordenar +
+ * somar segmentos, so somar segmentos e o caminho incremental com `churn`
+ * pontos fora do segmento.
+ */
+static void bench_accumulate(observation* observations, size_t size, int k, size_t churn)
+{
+    sorted_layout l;
+    if (layout_alloc(&l, size, k) != 0)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        return;
+    }
+    layout_build(&l, observations);
+    layout_sort(&l);
+    cluster* scatter = (cluster*)calloc(k, sizeof(cluster));
+    cluster* sorted = (cluster*)calloc(k, sizeof(cluster));
+
+    double t_scatter, t_sort, t_segments, t_incremental;
+    BEST_OF(t_scatter, kMeans_omp_accumulate(observations, size, k, scatter));
+    BEST_OF(t_sort, layout_sort(&l));
+    BEST_OF(t_segments, segment_sums(&l));
+
+    /* `churn` posicoes espalhadas trocam para o rotulo seguinte */
+    size_t stride = churn ? size / churn : size;
+    for (size_t i = 0; i < size; i++)
+    {
+        l.off[i] = 0;
+    }
+    for (size_t i = 0; churn && i < size; i += stride)
+    {
+        l.label[i] = (l.label[i] + 1) % k;
+        l.off[i] = 1;
+    }
+    l.n_moved = kmeans_compact(NULL, l.off, size, l.moved);
+    BEST_OF(t_incremental, layout_accumulate(&l, sorted));
+
+    printf("Acumulo (%zu pontos, %d threads, melhor de %d):\n", size, omp_get_max_threads(),
+           BENCH_REPEATS);
+    printf("  Dispersao com buffers por thread : %.6f s\n", t_scatter);
+    printf("  Counting sort paralelo            : %.6f s\n", t_sort);
+    printf("  Somas SIMD dos segmentos          : %.6f s (%.2fx a dispersao)\n", t_segments,
+           t_scatter / t_segments);
+    printf("  Incremental (%zu fora do segmento): %.6f s (%.2fx a dispersao)\n", l.n_moved,
+           t_incremental, t_scatter / t_incremental);
+
+    free(scatter);
+    free(sorted);
+    layout_free(&l);
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    int k = argc > 1 ? atoi(argv[1]) : 5;
+    if (k < 2)
+    {
+        fprintf(stderr, "Erro: k deve ser >= 2.\n");
+        return 1;
+    }
+
+    size_t size = 0;
+    observation* observations = load_observations(filename, &size);
+    if (!observations)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
+    int* reference = (int*)malloc(sizeof(int) * size);
+    cluster* clusters = (cluster*)calloc(k, sizeof(cluster));
+    cluster* ref_clusters = (cluster*)calloc(k, sizeof(cluster));
+    if (!reference || !clusters || !ref_clusters)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        return 1;
+    }
+
+    printf("K-Means OpenMP (CPU) - acumulo por rotulo ordenado\n");
+    printf("Observacoes efetivas: %zu, clusters: %d, threads: %d, reordena acima de %.1f%% fora do segmento\n",
+           size, k, omp_get_max_threads(), 100.0 * RESORT_FRACTION);
+
+    unsigned int base_seed = (unsigned int)time(NULL);
+
+    /* referencia: Lloyd com acumulo por dispersao */
+    size_t base_iters_total = 0;
+    double base_elapsed = 0.0;
+    for (int run = 0; run < NUM_RUNS; run++)
+    {
+        size_t iters = 0;
+        random_partition(observations, size, k, base_seed + run);
+        memset(ref_clusters, 0, sizeof(cluster) * k);
+        double start = omp_get_wtime();
+        kMeans_omp_lloyd(observations, size, k, ref_clusters, &iters);
+        base_elapsed += omp_get_wtime() - start;
+        base_iters_total += iters;
+    }
+    for (size_t j = 0; j < size; j++)
+    {
+        reference[j] = observations[j].group;
+    }
+
+    /* rotulos convergidos: micro-benchmark com 0,1% dos pontos fora do segmento */
+    bench_accumulate(observations, size, k, size / 1000);
+
+    sorted_layout layout;
+    if (layout_alloc(&layout, size, k) != 0)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        return 1;
+    }
+    size_t sorted_iters_total = 0, resorts_total = 0;
+    double sorted_elapsed = 0.0;
+    for (int run = 0; run < NUM_RUNS; run++)
+    {
+        size_t iters = 0;
+        random_partition(observations, size, k, base_seed + run);
+        memset(clusters, 0, sizeof(cluster) * k);
+        double start = omp_get_wtime();
+        kMeans_omp_sorted(&layout, observations, size, k, clusters, &iters);
+        sorted_elapsed += omp_get_wtime() - start;
+        sorted_iters_total += iters;
+        resorts_total += layout.resorts;
+    }
+    layout_free(&layout);
+
+    /* mesma particao inicial da ultima execucao de referencia */
+    size_t mismatches = 0;
+    for (size_t j = 0; j < size; j++)
+    {
+        mismatches += observations[j].group != reference[j];
+    }
+    double max_diff = 0.0;
+    for (int c = 0; c < k; c++)
+    {
+        max_diff = fmax(max_diff, fabs(clusters[c].x - ref_clusters[c].x));
+        max_diff = fmax(max_diff, fabs(clusters[c].y - ref_clusters[c].y));
+    }
+
+    printf("Lloyd (dispersao) -> tempo total (%d execucoes): %.6f s, medio: %.6f s, iteracoes: %.2f\n",
+           NUM_RUNS, base_elapsed, base_elapsed / NUM_RUNS, (double)base_iters_total / NUM_RUNS);
+    printf("Lloyd (ordenado)  -> tempo total (%d execucoes): %.6f s, medio: %.6f s, iteracoes: %.2f, "
+           "reordenacoes: %.2f\n",
+           NUM_RUNS, sorted_elapsed, sorted_elapsed / NUM_RUNS, (double)sorted_iters_total / NUM_RUNS,
+           (double)resorts_total / NUM_RUNS);
+    printf("Rotulos diferentes da referencia na ultima execucao: %zu, maior diferenca nos centroides: %.3e\n",
+           mismatches, max_diff);
+
+    for (int i = 0; i < k; i++)
+    {
+        printf("Cluster %d: centroid (%.4f, %.4f), pontos=%zu\n", i,
+               clusters[i].x, clusters[i].y, clusters[i].count);
+    }
+
+    free(clusters);
+    free(ref_clusters);
+    free(reference);
+    free(observations);
+    return 0;
+}
@@ -0,0 +1,841 @@
+/**
+ * @file k_means_clustering_predict.c
+ * @brief Exporta um modelo ajustado (centroides + metadados) e rotula em lote
+ *        novos pontos a partir dele, sem reajustar.
+ *
+ * Uso:
+ *   ./kmeans_predict fit [arquivo.csv] [modelo] [k] [seed] [--cache DIR] [--checkpoint ARQ ...]
+ *   ./kmeans_predict predict <modelo> <entrada|-> <saida|-> [--bin] [--text]
+ *
+ * Entrada: CSV "id,x,y" (cabecalho opcional) ou, com --bin ou extensao
+ * .bin, pares (x, y) em double. "-" le de stdin. A entrada e lida em blocos
+ * grandes; cada bloco e dividido entre as threads em fronteiras de linha,
+ * contado, parseado e rotulado em paralelo pelo kernel vetorizado de
+ * centroide mais proximo.
+ *
+ * Saida: rotulos binarios (uint8 se k <= 255, senao int32), escritos com
+ * write() direto do vetor de rotulos, ou texto (--text), uma linha por
+ * ponto, formatado em buffers por thread e escrito com writev. Linhas
+ * invalidas recebem o rotulo -1 (255 em uint8).
+ *
+ * Com --cache DIR o fit consulta antes o cache de resultados
+ * (kmeans_cache.h): mesmo conteudo, k, seed e criterio devolvem centroides
+ * e rotulos gravados sem rodar o K-Means; mesma base com outra seed parte
+ * dos centroides em cache (warm start) em vez da particao aleatoria. So o
+ * fit frio e gravado na chave exata; warm start e --resume gravam na chave
+ * marcada como warm.
+ *
+ * Com --checkpoint ARQ o laco de Lloyd grava, de forma assincrona
+ * (kmeans_checkpoint.h), centroides, iteracao, estado do RNG e, com
+ * --checkpoint-labels, os rotulos a cada N iteracoes (--checkpoint-every)
+ * ou S segundos (--checkpoint-sec). --resume continua do checkpoint se ele
+ * for da mesma base (hash de conteudo) e do mesmo k.
+ */
+#include <fcntl.h>
+#include <limits.h>
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kmeans_cache.h"
+#include "kmeans_checkpoint.h"
+#include "kmeans_common.h"
+#include "kmeans_model.h"
+
+#define CHUNK_BYTES ((size_t)64 << 20)
+#define MAX_THREADS 256
+
+typedef struct
+{
+    int k;
+    const double* cx; /* centroides em SoA para o kernel */
+    const double* cy;
+} predict_model;
+
+static int write_full(int fd, const void* buf, size_t len)
+{
+    const char* p = (const char*)buf;
+    while (len > 0)
+    {
+        ssize_t w = write(fd, p, len);
+        if (w <= 0)
+        {
+            return -1;
+        }
+        p += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+/* kernel de centroide mais proximo sobre pontos intercalados (x, y) */
+static void assign_points(const predict_model* model, const double* pts, size_t m, int32_t* labels)
+{
+    const int k = model->k;
+    const double* cx = model->cx;
+    const double* cy = model->cy;
+
+    #pragma omp parallel for simd schedule(static)
+    for (size_t i = 0; i < m; i++)
+    {
+        double px = pts[2 * i];
+        double py = pts[2 * i + 1];
+        double minD = DBL_MAX;
+        int32_t best = 0;
+        for (int c = 0; c < k; c++)
+        {
+            double dx = cx[c] - px;
+            double dy = cy[c] - py;
+            double dist = dx * dx + dy * dy;
+            if (dist < minD)
+            {
+                minD = dist;
+                best = c;
+            }
+        }
+        labels[i] = (px == px && py == py) ? best : -1; /* NaN marca linha invalida */
+    }
+}
+
+/* uma linha "id,x,y"; sem strtok para poder rodar em paralelo */
+static void parse_line(const char* line, const char* end, double* x, double* y)
+{
+    const char* p = memchr(line, ',', (size_t)(end - line));
+    char* q = NULL;
+    *x = NAN;
+    *y = NAN;
+    if (!p)
+    {
+        return;
+    }
+    double vx = strtod(p + 1, &q);
+    if (q == p + 1 || q >= end || *q != ',')
+    {
+        return;
+    }
+    const char* r = q + 1;
+    double vy = strtod(r, &q);
+    if (q == r)
+    {
+        return;
+    }
+    *x = vx;
+    *y = vy;
+}
+
+/*
+ * Parse paralelo de [buf, end) (termina em '\n'): cada thread pega uma faixa
+ * alinhada em fronteira de linha, conta as linhas, faz prefix-sum dos
+ * deslocamentos e parseia direto na posicao final. Retorna o numero de linhas.
+ */
+static size_t parse_csv_block(const char* buf, const char* end, double** pts, size_t* pts_cap)
+{
+    int threads = omp_get_max_threads();
+    if (threads > MAX_THREADS)
+    {
+        threads = MAX_THREADS;
+    }
+    const char* seg_begin[MAX_THREADS + 1];
+    size_t seg_lines[MAX_THREADS + 1];
+    size_t len = (size_t)(end - buf);
+
+    seg_begin[0] = buf;
+    for (int t = 1; t < threads; t++)
+    {
+        const char* p = buf + len * (size_t)t / (size_t)threads;
+        if (p < seg_begin[t - 1])
+        {
+            p = seg_begin[t - 1];
+        }
+        const char* nl = p < end ? memchr(p, '\n', (size_t)(end - p)) : NULL;
+        seg_begin[t] = nl ? nl + 1 : end;
+    }
+    seg_begin[threads] = end;
+
+    #pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for (int t = 0; t < threads; t++)
+    {
+        size_t lines = 0;
+        for (const char* p = seg_begin[t]; p < seg_begin[t + 1]; p++)
+        {
+            lines += (*p == '\n');
+        }
+        seg_lines[t] = lines;
+    }
+
+    size_t total = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        size_t lines = seg_lines[t];
+        seg_lines[t] = total;
+        total += lines;
+    }
+
+    if (total > *pts_cap)
+    {
+        free(*pts);
+        *pts = (double*)malloc(sizeof(double) * 2 * total);
+        *pts_cap = *pts ? total : 0;
+        if (!*pts)
+        {
+            return 0;
+        }
+    }
+    double* out = *pts;
+
+    #pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for (int t = 0; t < threads; t++)
+    {
+        size_t idx = seg_lines[t];
+        const char* p = seg_begin[t];
+        const char* stop = seg_begin[t + 1];
+        while (p < stop)
+        {
+            const char* nl = memchr(p, '\n', (size_t)(stop - p));
+            parse_line(p, nl, &out[2 * idx], &out[2 * idx + 1]);
+            idx++;
+            p = nl + 1;
+        }
+    }
+
+    return total;
+}
+
+/* grava m rotulos; `scratch` tem ao menos 12*m bytes para o modo texto */
+static int write_labels(int fd, const int32_t* labels, size_t m, int k, int text, char* scratch)
+{
+    if (!text)
+    {
+        if (k > 255)
+        {
+            return write_full(fd, labels, sizeof(int32_t) * m);
+        }
+        uint8_t* small = (uint8_t*)scratch;
+        #pragma omp parallel for simd schedule(static)
+        for (size_t i = 0; i < m; i++)
+        {
+            small[i] = (uint8_t)labels[i];
+        }
+        return write_full(fd, small, m);
+    }
+
+    int threads = omp_get_max_threads();
+    if (threads > MAX_THREADS)
+    {
+        threads = MAX_THREADS;
+    }
+    struct iovec iov[MAX_THREADS];
+
+    #pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for (int t = 0; t < threads; t++)
+    {
+        size_t first = m * (size_t)t / (size_t)threads;
+        size_t last = m * (size_t)(t + 1) / (size_t)threads;
+        char* base = scratch + 12 * first;
+        char* p = base;
+        for (size_t i = first; i < last; i++)
+        {
+            int32_t v = labels[i];
+            if (v < 0)
+            {
+                *p++ = '-';
+                v = -v;
+            }
+            char digits[11];
+            int nd = 0;
+            do
+            {
+                digits[nd++] = (char)('0' + v % 10);
+                v /= 10;
+            } while (v > 0);
+            while (nd > 0)
+            {
+                *p++ = digits[--nd];
+            }
+            *p++ = '\n';
+        }
+        iov[t].iov_base = base;
+        iov[t].iov_len = (size_t)(p - base);
+    }
+
+    /* uma chamada para todas as fatias; escrita parcial continua de onde parou */
+    struct iovec* cur = iov;
+    int left = threads;
+    while (left > 0)
+    {
+        ssize_t w = writev(fd, cur, left);
+        if (w < 0)
+        {
+            return -1;
+        }
+        while (left > 0 && (size_t)w >= cur->iov_len)
+        {
+            w -= (ssize_t)cur->iov_len;
+            cur++;
+            left--;
+        }
+        if (left > 0)
+        {
+            cur->iov_base = (char*)cur->iov_base + w;
+            cur->iov_len -= (size_t)w;
+        }
+    }
+    return 0;
+}
+
+static size_t read_some(int fd, char* buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len)
+    {
+        ssize_t r = read(fd, buf + got, len - got);
+        if (r <= 0)
+        {
+            break;
+        }
+        got += (size_t)r;
+    }
+    return got;
+}
+
+static int predict(const char* model_path, const char* in_path, const char* out_path, int binary,
+                   int text)
+{
+    kmeans_model model;
+    if (kmeans_model_load(model_path, &model) != 0 || model.header.dims != 2)
+    {
+        fprintf(stderr, "Modelo invalido: %s\n", model_path);
+        return 1;
+    }
+    int k = (int)model.header.k;
+    double* cx = (double*)malloc(sizeof(double) * k);
+    double* cy = (double*)malloc(sizeof(double) * k);
+    if (!cx || !cy)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        kmeans_model_free(&model);
+        free(cx);
+        free(cy);
+        return 1;
+    }
+    for (int c = 0; c < k; c++)
+    {
+        cx[c] = model.centroids[2 * c];
+        cy[c] = model.centroids[2 * c + 1];
+    }
+    predict_model pm = {k, cx, cy};
+
+    int in_fd = strcmp(in_path, "-") == 0 ? STDIN_FILENO : open(in_path, O_RDONLY);
+    int out_fd = strcmp(out_path, "-") == 0 ? STDOUT_FILENO
+                                            : open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (in_fd < 0 || out_fd < 0)
+    {
+        fprintf(stderr, "Erro ao abrir entrada/saida.\n");
+        kmeans_model_free(&model);
+        free(cx);
+        free(cy);
+        return 1;
+    }
+
+    size_t in_len = strlen(in_path);
+    binary = binary || (in_len > 4 && strcmp(in_path + in_len - 4, ".bin") == 0);
+
+    char* buf = (char*)malloc(CHUNK_BYTES + 1);
+    double* pts = NULL;
+    size_t pts_cap = 0;
+    int32_t* labels = NULL;
+    char* scratch = NULL;
+    size_t labels_cap = 0;
+    size_t carry = 0;
+    size_t total = 0;
+    int first_block = 1;
+    int rc = 0;
+    if (!buf)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        rc = 1;
+    }
+
+    double start = omp_get_wtime();
+    while (rc == 0)
+    {
+        size_t got = read_some(in_fd, buf + carry, CHUNK_BYTES - carry);
+        size_t len = carry + got;
+        if (len == 0)
+        {
+            break;
+        }
+
+        size_t m = 0;
+        size_t used = 0;
+        if (binary)
+        {
+            m = len / (2 * sizeof(double));
+            used = m * 2 * sizeof(double);
+            pts = (double*)buf; /* sem copia: o bloco lido ja e o vetor de pontos */
+        }
+        else
+        {
+            if (got == 0 && buf[len - 1] != '\n')
+            {
+                buf[len++] = '\n'; /* ultima linha sem quebra */
+            }
+            char* last_nl = NULL;
+            for (size_t i = len; i > 0; i--)
+            {
+                if (buf[i - 1] == '\n')
+                {
+                    last_nl = buf + i - 1;
+                    break;
+                }
+            }
+            if (!last_nl)
+            {
+                fprintf(stderr, "Linha maior que o bloco de leitura.\n");
+                rc = 1;
+                break;
+            }
+
+            char* begin = buf;
+            if (first_block && !(*begin == '-' || *begin == '+' || *begin == '.' ||
+                                 (*begin >= '0' && *begin <= '9')))
+            {
+                begin = memchr(begin, '\n', (size_t)(last_nl - begin));
+                begin = begin ? begin + 1 : last_nl + 1; /* descarta cabecalho */
+            }
+            used = (size_t)(last_nl + 1 - buf);
+            m = begin < last_nl + 1 ? parse_csv_block(begin, last_nl + 1, &pts, &pts_cap) : 0;
+        }
+        first_block = 0;
+
+        if (m > labels_cap)
+        {
+            free(labels);
+            free(scratch);
+            labels = (int32_t*)malloc(sizeof(int32_t) * m);
+            scratch = (char*)malloc(12 * m);
+            labels_cap = m;
+            if (!labels || !scratch)
+            {
+                fprintf(stderr, "Erro de memoria.\n");
+                rc = 1;
+                break;
+            }
+        }
+
+        if (m > 0)
+        {
+            assign_points(&pm, pts, m, labels);
+            if (write_labels(out_fd, labels, m, k, text, scratch) != 0)
+            {
+                fprintf(stderr, "Erro ao gravar rotulos.\n");
+                rc = 1;
+                break;
+            }
+            total += m;
+        }
+
+        carry = len - used;
+        memmove(buf, buf + used, carry);
+        if (got == 0)
+        {
+            break;
+        }
+    }
+    double elapsed = omp_get_wtime() - start;
+
+    if (!binary)
+    {
+        free(pts);
+    }
+    free(buf);
+    free(labels);
+    free(scratch);
+    free(cx);
+    free(cy);
+    kmeans_model_free(&model);
+    if (in_fd != STDIN_FILENO)
+    {
+        close(in_fd);
+    }
+    if (out_fd != STDOUT_FILENO)
+    {
+        close(out_fd);
+    }
+
+    fprintf(stderr, "Predict: %zu pontos em %.3f s (%.1f M pontos/min, %d threads)\n",
+            total, elapsed, elapsed > 0.0 ? total / elapsed * 60.0 / 1e6 : 0.0,
+            omp_get_max_threads());
+    return rc;
+}
+
+typedef struct
+{
+    const char* cache_dir;   /* --cache */
+    const char* checkpoint;  /* --checkpoint */
+    long every_iters;        /* --checkpoint-every */
+    double every_sec;        /* --checkpoint-sec */
+    int checkpoint_labels;   /* --checkpoint-labels */
+    int resume;              /* --resume */
+} fit_options;
+
+/* estado do laco de Lloyd que vai para o checkpoint */
+typedef struct
+{
+    kmeans_checkpointer* ck; /* NULL = sem checkpoint */
+    int with_labels;
+    uint64_t seed;
+    uint64_t rng_state;
+    uint64_t data_hash;
+    const char* source;
+    double elapsed_before; /* computo ja feito antes de uma retomada */
+} fit_progress;
+
+static void submit_checkpoint(fit_progress* p, observation* observations, size_t size, int k,
+                              const cluster* clusters, size_t iters, double elapsed)
+{
+    double* payload = (double*)malloc(sizeof(double) * 3 * k);
+    for (int c = 0; c < k; c++)
+    {
+        payload[3 * c] = clusters[c].x;
+        payload[3 * c + 1] = clusters[c].y;
+        payload[3 * c + 2] = (double)clusters[c].count;
+    }
+
+    kmeans_checkpoint_header h;
+    memset(&h, 0, sizeof(h));
+    h.kind = KMEANS_CKPT_LLOYD;
+    h.k = (uint32_t)k;
+    h.dims = 2;
+    h.iteration = iters;
+    h.n = size;
+    h.seed = p->seed;
+    h.rng_state = p->rng_state;
+    h.data_hash = p->data_hash;
+    h.payload_doubles = 3 * (uint64_t)k;
+    h.elapsed = p->elapsed_before + elapsed;
+    snprintf(h.source, sizeof(h.source), "%s", p->source);
+    kmeans_checkpoint_submit(p->ck, &h, payload, p->with_labels ? observations : NULL);
+    free(payload);
+}
+
+/*
+ * Mesmo laco de kMeans_omp_lloyd, a partir da iteracao `*iters`, com
+ * checkpoint apos a reatribuicao na cadencia configurada. Os rotulos
+ * gravados sao exatamente a atribuicao aos centroides gravados, por isso
+ * retomar sem eles (reatribuindo) continua a mesma trajetoria.
+ */
+static void lloyd_checkpointed(observation* observations, size_t size, int k, cluster* clusters,
+                               size_t* iters, fit_progress* p)
+{
+    size_t minAcceptedError = size / 10000;
+    size_t changed;
+    double start = omp_get_wtime();
+    do
+    {
+        kMeans_omp_update(observations, size, k, clusters);
+        changed = kMeans_omp_assign(observations, size, clusters, k);
+        ++*iters;
+        if (p->ck && changed > minAcceptedError && kmeans_checkpoint_due(p->ck, *iters))
+        {
+            submit_checkpoint(p, observations, size, k, clusters, *iters, omp_get_wtime() - start);
+        }
+    } while (changed > minAcceptedError);
+}
+
+/* retoma do checkpoint; retorna 0 se o arquivo casa com a base e com k */
+static int resume_checkpoint(const char* path, observation* observations, size_t size, int k,
+                             cluster* clusters, size_t* iters, fit_progress* p)
+{
+    kmeans_checkpoint_header h;
+    double* payload;
+    int32_t* labels;
+    if (kmeans_checkpoint_load(path, &h, &payload, &labels) != 0)
+    {
+        return -1;
+    }
+    int ok = h.kind == KMEANS_CKPT_LLOYD && (int)h.k == k && h.n == size &&
+             h.payload_doubles == 3 * (uint64_t)k && h.data_hash == p->data_hash;
+    if (ok)
+    {
+        for (int c = 0; c < k; c++)
+        {
+            clusters[c].x = payload[3 * c];
+            clusters[c].y = payload[3 * c + 1];
+            clusters[c].count = (size_t)payload[3 * c + 2];
+        }
+        if (labels)
+        {
+            #pragma omp parallel for schedule(static)
+            for (size_t i = 0; i < size; i++)
+            {
+                observations[i].group = labels[i];
+            }
+        }
+        else
+        {
+            kMeans_omp_assign(observations, size, clusters, k);
+        }
+        *iters = h.iteration;
+        p->seed = h.seed;
+        p->rng_state = h.rng_state;
+        p->elapsed_before = h.elapsed;
+        printf("Retomando de %s: iteracao %llu, %.3f s de computo anterior, rotulos %s\n", path,
+               (unsigned long long)h.iteration, h.elapsed, labels ? "gravados" : "reatribuidos");
+    }
+    free(payload);
+    free(labels);
+    return ok ? 0 : -1;
+}
+
+/*
+ * Ajuste com cache e checkpoint opcionais. Retorna os clusters (NULL sem
+ * memoria); `origin` diz de onde vieram ("cache", "warm", "resume" ou "fit").
+ */
+static cluster* fit_cached(observation* observations, size_t size, int k, unsigned int seed,
+                           const char* filename, const fit_options* opt, size_t* iters,
+                           const char** origin)
+{
+    *origin = "fit";
+    *iters = 0;
+    cluster* clusters = kMeans_omp_trivial(observations, size, k);
+    if (clusters)
+    {
+        return clusters;
+    }
+
+    double start = omp_get_wtime();
+    kmeans_cache_key key;
+    key.hash = opt->cache_dir || opt->checkpoint ? kmeans_content_hash(observations, size) : 0;
+    key.k = k;
+    key.dims = 2;
+    key.seed = seed;
+    key.engine = "omp";
+    key.tol = 10000; /* changed <= size / 10000 */
+    key.warm = 0;
+    if (key.hash)
+    {
+        printf("Hash do conteudo: %016llx (%.6f s)\n", (unsigned long long)key.hash,
+               omp_get_wtime() - start);
+    }
+
+    char path[1024];
+    clusters = (cluster*)calloc(k, sizeof(cluster));
+    if (!clusters)
+    {
+        return NULL;
+    }
+    if (opt->cache_dir)
+    {
+        kmeans_cache_path(opt->cache_dir, &key, path, sizeof(path));
+        if (kmeans_cache_read(path, &key, size, clusters, observations, iters) == 0)
+        {
+            *origin = "cache";
+            return clusters;
+        }
+    }
+
+    kmeans_checkpointer ck;
+    fit_progress progress;
+    memset(&progress, 0, sizeof(progress));
+    progress.seed = seed;
+    progress.data_hash = key.hash;
+    progress.source = filename;
+    if (opt->checkpoint)
+    {
+        kmeans_checkpointer_start(&ck, opt->checkpoint, opt->every_iters, opt->every_sec);
+        progress.ck = &ck;
+        progress.with_labels = opt->checkpoint_labels;
+    }
+
+    size_t cached_iters = 0;
+    kmeans_cache_key warm_key = key;
+    if (opt->checkpoint && opt->resume &&
+        resume_checkpoint(opt->checkpoint, observations, size, k, clusters, iters, &progress) == 0)
+    {
+        *origin = "resume";
+    }
+    else if (opt->cache_dir &&
+             kmeans_cache_find_warm(opt->cache_dir, &key, path, sizeof(path), &warm_key.warm) == 0 &&
+             kmeans_cache_read(path, &warm_key, size, clusters, NULL, &cached_iters) == 0)
+    {
+        *origin = "warm";
+        kMeans_omp_assign(observations, size, clusters, k);
+    }
+    else
+    {
+        /* particao aleatoria com rand_r: o estado do RNG vai para o checkpoint */
+        unsigned int rng = seed;
+        for (size_t j = 0; j < size; j++)
+        {
+            observations[j].group = rand_r(&rng) % k;
+        }
+        progress.rng_state = rng;
+    }
+
+    lloyd_checkpointed(observations, size, k, clusters, iters, &progress);
+
+    if (opt->checkpoint)
+    {
+        kmeans_checkpointer_stop(&ck);
+        printf("Checkpoints: %llu gravados, %llu com falha, %llu pulados (escrita em andamento), "
+               "%.3f s na escritora\n",
+               (unsigned long long)ck.written, (unsigned long long)ck.failed, (unsigned long long)ck.skipped,
+               ck.write_seconds);
+    }
+    /* resultado que dependeu do historico nao pode ocupar a chave exata */
+    key.warm = strcmp(*origin, "fit") != 0;
+    if (opt->cache_dir &&
+        kmeans_cache_write(opt->cache_dir, &key, size, clusters, observations, *iters) != 0)
+    {
+        fprintf(stderr, "Aviso: nao foi possivel gravar o cache em %s\n", opt->cache_dir);
+    }
+    return clusters;
+}
+
+static int fit(const char* filename, const char* model_path, int k, unsigned int seed,
+               const fit_options* opt)
+{
+    size_t size = 0;
+    observation* observations = load_observations(filename, &size);
+    if (!observations)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
+
+    size_t iters = 0;
+    const char* origin;
+    double start = omp_get_wtime();
+    cluster* clusters = fit_cached(observations, size, k, seed, filename, opt, &iters, &origin);
+    double elapsed = omp_get_wtime() - start;
+    int kk = k <= 1 ? 1 : k;
+    if (!clusters)
+    {
+        fprintf(stderr, "Erro de memoria no K-Means.\n");
+        free(observations);
+        return 1;
+    }
+
+    kmeans_model model;
+    memset(&model, 0, sizeof(model));
+    model.header.k = (uint32_t)kk;
+    model.header.dims = 2;
+    model.header.n_train = size;
+    model.header.seed = seed;
+    model.header.iterations = (uint32_t)iters;
+    model.header.fit_seconds = elapsed;
+    snprintf(model.header.source, sizeof(model.header.source), "%s", filename);
+    model.centroids = (double*)malloc(sizeof(double) * 2 * kk);
+    model.counts = (uint64_t*)malloc(sizeof(uint64_t) * kk);
+    if (!model.centroids || !model.counts)
+    {
+        fprintf(stderr, "Erro de memoria ao montar o modelo.\n");
+        kmeans_model_free(&model);
+        free(clusters);
+        free(observations);
+        return 1;
+    }
+    for (int c = 0; c < kk; c++)
+    {
+        model.centroids[2 * c] = clusters[c].x;
+        model.centroids[2 * c + 1] = clusters[c].y;
+        model.counts[c] = clusters[c].count;
+    }
+
+    int rc = kmeans_model_save(model_path, &model);
+    printf("K-Means OpenMP (CPU) - fit exportado para %s\n", model_path);
+    printf("Observacoes efetivas: %zu, clusters: %d, iteracoes: %zu, tempo: %.6f s (%s)\n",
+           size, kk, iters, elapsed, origin);
+    for (int c = 0; c < kk; c++)
+    {
+        printf("Cluster %d: centroid (%.4f, %.4f), pontos=%zu\n", c,
+               clusters[c].x, clusters[c].y, clusters[c].count);
+    }
+
+    free(clusters);
+    free(observations);
+    kmeans_model_free(&model);
+    if (rc != 0)
+    {
+        fprintf(stderr, "Erro ao gravar modelo.\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && strcmp(argv[1], "fit") == 0)
+    {
+        fit_options opt;
+        memset(&opt, 0, sizeof(opt));
+        const char* positional[4] = {NULL, NULL, NULL, NULL};
+        int npos = 0;
+        for (int i = 2; i < argc; i++)
+        {
+            if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+            {
+                opt.cache_dir = argv[++i];
+            }
+            else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+            {
+                opt.checkpoint = argv[++i];
+            }
+            else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc)
+            {
+                opt.every_iters = atol(argv[++i]);
+            }
+            else if (strcmp(argv[i], "--checkpoint-sec") == 0 && i + 1 < argc)
+            {
+                opt.every_sec = atof(argv[++i]);
+            }
+            else if (strcmp(argv[i], "--checkpoint-labels") == 0)
+            {
+                opt.checkpoint_labels = 1;
+            }
+            else if (strcmp(argv[i], "--resume") == 0)
+            {
+                opt.resume = 1;
+            }
+            else if (npos < 4)
+            {
+                positional[npos++] = argv[i];
+            }
+        }
+        const char* filename = positional[0] ? positional[0] : "Instagram_visits_clustering.csv";
+        const char* model_path = positional[1] ? positional[1] : "kmeans_model.bin";
+        int k = positional[2] ? atoi(positional[2]) : 5;
+        unsigned int seed = positional[3] ? (unsigned int)strtoul(positional[3], NULL, 10)
+                                          : (unsigned int)time(NULL);
+        if (opt.checkpoint && opt.every_iters <= 0 && opt.every_sec <= 0.0)
+        {
+            opt.every_iters = 1;
+        }
+        return fit(filename, model_path, k, seed, &opt);
+    }
+
+    if (argc > 4 && strcmp(argv[1], "predict") == 0)
+    {
+        int binary = 0;
+        int text = 0;
+        for (int i = 5; i < argc; i++)
+        {
+            binary |= strcmp(argv[i], "--bin") == 0;
+            text |= strcmp(argv[i], "--text") == 0;
+        }
+        return predict(argv[2], argv[3], argv[4], binary, text);
+    }
+
+    fprintf(stderr,
+            "Uso: %s fit [arquivo] [modelo] [k] [seed] [--cache DIR] [--checkpoint ARQ]\n"
+            "         [--checkpoint-every N] [--checkpoint-sec S] [--checkpoint-labels] [--resume]\n"
+            "     %s predict <modelo> <entrada|-> <saida|-> [--bin] [--text]\n",
+            argv[0], argv[0]);
+    return 1;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file k_means_clustering_shm_publish.c
+ * @brief Carrega o CSV (ja replicado) uma vez e publica os vetores x/y num
+ *        segmento de memoria compartilhada; as versoes anexam com KMEANS_SHM.
+ *
+ * Uso:
+ *   ./kmeans_shm_publish [/nome] [arquivo.csv]   publica (padrao /kmeans_instagram)
+ *   ./kmeans_shm_publish --unlink [/nome]        remove o segmento
+ *   ./kmeans_shm_publish --info [/nome]          anexa e mostra o cabecalho
+ */
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kmeans_common.h"
+#include "kmeans_shm.h"
+
+#define DEFAULT_SHM_NAME "/kmeans_instagram"
+
+int main(int argc, char** argv)
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    const char* name = DEFAULT_SHM_NAME;
+
+    if (argc > 1 && strcmp(argv[1], "--unlink") == 0)
+    {
+        name = argc > 2 ? argv[2] : name;
+        if (shm_unlink(name) != 0)
+        {
+            perror("shm_unlink");
+            return 1;
+        }
+        printf("Segmento %s removido.\n", name);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--info") == 0)
+    {
+        name = argc > 2 ? argv[2] : name;
+        kmeans_shm_dataset ds;
+        double start = omp_get_wtime();
+        if (kmeans_shm_attach(name, &ds) != 0)
+        {
+            return 1;
+        }
+        double attach_us = (omp_get_wtime() - start) * 1e6;
+        printf("Segmento %s: versao %u, observacoes %zu (replicacao %llu), origem %s, %zu bytes\n",
+               name, ds.header->version, ds.n, (unsigned long long)ds.header->replication,
+               ds.header->source, ds.bytes);
+        printf("Tempo para anexar: %.1f us\n", attach_us);
+        kmeans_shm_detach(&ds);
+        return 0;
+    }
+
+    if (argc > 1)
+    {
+        name = argv[1];
+    }
+    if (argc > 2)
+    {
+        filename = argv[2];
+    }
+
+    double start = omp_get_wtime();
+    size_t size = 0;
+    observation* obs = load_dataset(filename, &size);
+    if (!obs)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
+
+    double* x = (double*)malloc(sizeof(double) * size);
+    double* y = (double*)malloc(sizeof(double) * size);
+    if (!x || !y)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        free(obs);
+        free(x);
+        free(y);
+        return 1;
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        x[i] = obs[i].x;
+        y[i] = obs[i].y;
+    }
+    free(obs);
+    double load_s = omp_get_wtime() - start;
+
+    start = omp_get_wtime();
+    int rc = kmeans_shm_publish(name, x, y, size, REPLICATION_FACTOR, filename);
+    double publish_s = omp_get_wtime() - start;
+    free(x);
+    free(y);
+    if (rc != 0)
+    {
+        return 1;
+    }
+
+    printf("Segmento %s publicado: %zu observacoes (carga %.3f s, publicacao %.3f s)\n",
+           name, size, load_s, publish_s);
+    return 0;
+}
@@ -0,0 +1,452 @@
+/**
+ * @file k_means_clustering_stream.c
+ * @brief K-Means em fluxo: le eventos de visita de stdin (ou pipe) e mantem
+ *        os centroides sobre uma janela deslizante, sem reprocessar o historico.
+ *
+ * Cada cluster guarda somas e peso com decaimento exponencial. Os eventos
+ * chegam em micro-lotes; cada lote e atribuido em paralelo aos centroides
+ * atuais (buffers locais por thread, como no kMeans_omp) e entra nas somas
+ * com uma atualizacao estilo MacQueen em lote:
+ *     S_c = lambda * S_c + soma do lote em c,   centroide_c = S_c / W_c
+ * Janela por contagem de N eventos: lambda = exp(-b / N) para um lote de b
+ * eventos. Janela por tempo de T s: lambda = exp(-dt / T), com dt tirado da
+ * 4a coluna (timestamp em segundos) se existir, senao do relogio.
+ *
+ * Uso: ./kmeans_stream [-k K] [--window N | --time-window T] [--batch B]
+ *                      [--snapshot N] [--snapshot-sec S]
+ *                      [--checkpoint ARQ [--checkpoint-every L] [--checkpoint-sec S]
+ *                       [--resume [--skip-consumed]]] < eventos.csv
+ * Linhas: "id,x,y[,timestamp]"; cabecalho e linhas invalidas sao ignorados.
+ *
+ * Checkpoint (kmeans_checkpoint.h): somas, pesos, centroides e eventos
+ * consumidos, gravados em segundo plano a cada L micro-lotes ou S segundos.
+ * --resume restaura esse estado; com --skip-consumed os primeiros eventos
+ * validos da entrada (os ja consumidos) sao descartados, para quando o
+ * produtor reenvia o fluxo desde o inicio.
+ */
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kmeans_checkpoint.h"
+#include "kmeans_common.h"
+
+#define DEFAULT_WINDOW 100000
+#define DEFAULT_BATCH 4096
+#define DEFAULT_SNAPSHOT 100000
+
+typedef struct
+{
+    int k;
+    int seeded;      /* centroides ja inicializados (primeiros k pontos) */
+    double* sum_x;   /* somas com decaimento */
+    double* sum_y;
+    double* weight;
+    double* cx;
+    double* cy;
+    unsigned long long events;
+    double last_time; /* tempo do ultimo lote (janela por tempo) */
+} stream_state;
+
+typedef struct
+{
+    long window;        /* janela por contagem (eventos) */
+    double time_window; /* janela por tempo (s); > 0 tem prioridade */
+    int batch;
+    long snapshot_every;
+    double snapshot_sec;
+} stream_config;
+
+static int stream_state_init(stream_state* st, int k)
+{
+    memset(st, 0, sizeof(*st));
+    st->k = k;
+    st->sum_x = (double*)calloc((size_t)k, sizeof(double));
+    st->sum_y = (double*)calloc((size_t)k, sizeof(double));
+    st->weight = (double*)calloc((size_t)k, sizeof(double));
+    st->cx = (double*)calloc((size_t)k, sizeof(double));
+    st->cy = (double*)calloc((size_t)k, sizeof(double));
+    st->last_time = -1.0;
+    return st->sum_x && st->sum_y && st->weight && st->cx && st->cy ? 0 : -1;
+}
+
+static void stream_state_free(stream_state* st)
+{
+    free(st->sum_x);
+    free(st->sum_y);
+    free(st->weight);
+    free(st->cx);
+    free(st->cy);
+}
+
+/* "id,x,y[,t]"; t = -1 se ausente */
+static int parse_event(char* buffer, double* x, double* y, double* t)
+{
+    if (!parse_csv_line(buffer, x, y))
+    {
+        return 0;
+    }
+    char* token = strtok(NULL, ",");
+    *t = token ? strtod(token, NULL) : -1.0;
+    return 1;
+}
+
+static void stream_update(stream_state* st, const double* bx, const double* by, const double* bt,
+                          int m, const stream_config* cfg)
+{
+    int k = st->k;
+    int first = 0;
+
+    /* semente: os primeiros k eventos viram os centroides iniciais */
+    while (st->seeded < k && first < m)
+    {
+        st->cx[st->seeded] = bx[first];
+        st->cy[st->seeded] = by[first];
+        st->sum_x[st->seeded] = bx[first];
+        st->sum_y[st->seeded] = by[first];
+        st->weight[st->seeded] = 1.0;
+        st->seeded++;
+        first++;
+    }
+    if (first == m)
+    {
+        st->events += (unsigned long long)m;
+        return;
+    }
+
+    double* lot_x = (double*)calloc((size_t)k, sizeof(double));
+    double* lot_y = (double*)calloc((size_t)k, sizeof(double));
+    double* lot_w = (double*)calloc((size_t)k, sizeof(double));
+    const double* cx = st->cx;
+    const double* cy = st->cy;
+
+    #pragma omp parallel // atribui o micro-lote com buffers locais por thread
+    {
+        double* local_x = (double*)calloc((size_t)k, sizeof(double));
+        double* local_y = (double*)calloc((size_t)k, sizeof(double));
+        double* local_w = (double*)calloc((size_t)k, sizeof(double));
+
+        #pragma omp for schedule(static)
+        for (int i = first; i < m; i++)
+        {
+            double minD = DBL_MAX;
+            int g = 0;
+            for (int c = 0; c < k; c++)
+            {
+                double dx = cx[c] - bx[i];
+                double dy = cy[c] - by[i];
+                double dist = dx * dx + dy * dy;
+                if (dist < minD)
+                {
+                    minD = dist;
+                    g = c;
+                }
+            }
+            local_x[g] += bx[i];
+            local_y[g] += by[i];
+            local_w[g] += 1.0;
+        }
+
+        #pragma omp critical
+        {
+            for (int c = 0; c < k; c++)
+            {
+                lot_x[c] += local_x[c];
+                lot_y[c] += local_y[c];
+                lot_w[c] += local_w[c];
+            }
+        }
+
+        free(local_x);
+        free(local_y);
+        free(local_w);
+    }
+
+    /* decaimento da janela */
+    double lambda;
+    if (cfg->time_window > 0.0)
+    {
+        double now = bt[m - 1] >= 0.0 ? bt[m - 1] : omp_get_wtime();
+        double dt = st->last_time >= 0.0 && now > st->last_time ? now - st->last_time : 0.0;
+        st->last_time = now;
+        lambda = exp(-dt / cfg->time_window);
+    }
+    else
+    {
+        lambda = exp(-(double)(m - first) / (double)cfg->window);
+    }
+
+    for (int c = 0; c < k; c++)
+    {
+        st->sum_x[c] = lambda * st->sum_x[c] + lot_x[c];
+        st->sum_y[c] = lambda * st->sum_y[c] + lot_y[c];
+        st->weight[c] = lambda * st->weight[c] + lot_w[c];
+        if (st->weight[c] > 1e-12)
+        {
+            st->cx[c] = st->sum_x[c] / st->weight[c];
+            st->cy[c] = st->sum_y[c] / st->weight[c];
+        }
+    }
+
+    st->events += (unsigned long long)m;
+    free(lot_x);
+    free(lot_y);
+    free(lot_w);
+}
+
+/* payload do checkpoint: sum_x, sum_y, weight, cx, cy (k cada), last_time, seeded */
+static void stream_checkpoint(kmeans_checkpointer* ck, const stream_state* st,
+                              unsigned long long batches, double elapsed)
+{
+    int k = st->k;
+    size_t count = 5 * (size_t)k + 2;
+    double* payload = (double*)malloc(sizeof(double) * count);
+    memcpy(payload, st->sum_x, sizeof(double) * k);
+    memcpy(payload + k, st->sum_y, sizeof(double) * k);
+    memcpy(payload + 2 * k, st->weight, sizeof(double) * k);
+    memcpy(payload + 3 * k, st->cx, sizeof(double) * k);
+    memcpy(payload + 4 * k, st->cy, sizeof(double) * k);
+    payload[5 * k] = st->last_time;
+    payload[5 * k + 1] = (double)st->seeded;
+
+    kmeans_checkpoint_header h;
+    memset(&h, 0, sizeof(h));
+    h.kind = KMEANS_CKPT_STREAM;
+    h.k = (uint32_t)k;
+    h.dims = 2;
+    h.iteration = batches;
+    h.n = st->events;
+    h.payload_doubles = count;
+    h.elapsed = elapsed;
+    snprintf(h.source, sizeof(h.source), "stdin");
+    kmeans_checkpoint_submit(ck, &h, payload, NULL);
+    free(payload);
+}
+
+static int stream_resume(const char* path, stream_state* st, unsigned long long* batches)
+{
+    kmeans_checkpoint_header h;
+    double* payload;
+    if (kmeans_checkpoint_load(path, &h, &payload, NULL) != 0)
+    {
+        return -1;
+    }
+    int k = st->k;
+    int ok = h.kind == KMEANS_CKPT_STREAM && (int)h.k == k && h.payload_doubles == 5 * (uint64_t)k + 2;
+    if (ok)
+    {
+        memcpy(st->sum_x, payload, sizeof(double) * k);
+        memcpy(st->sum_y, payload + k, sizeof(double) * k);
+        memcpy(st->weight, payload + 2 * k, sizeof(double) * k);
+        memcpy(st->cx, payload + 3 * k, sizeof(double) * k);
+        memcpy(st->cy, payload + 4 * k, sizeof(double) * k);
+        st->last_time = payload[5 * k];
+        st->seeded = (int)payload[5 * k + 1];
+        st->events = h.n;
+        *batches = h.iteration;
+    }
+    free(payload);
+    return ok ? 0 : -1;
+}
+
+static void emit_snapshot(const stream_state* st, double elapsed)
+{
+    printf("Snapshot: eventos=%llu, t=%.3f s\n", st->events, elapsed);
+    for (int c = 0; c < st->k; c++)
+    {
+        printf("Cluster %d: centroid (%.4f, %.4f), peso=%.1f\n", c, st->cx[c], st->cy[c],
+               st->weight[c]);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+    int k = 5;
+    stream_config cfg = {DEFAULT_WINDOW, 0.0, DEFAULT_BATCH, DEFAULT_SNAPSHOT, 0.0};
+    const char* checkpoint = NULL;
+    long checkpoint_every = 0;
+    double checkpoint_sec = 0.0;
+    int resume = 0;
+    int skip_consumed = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+        {
+            k = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc)
+        {
+            cfg.window = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--time-window") == 0 && i + 1 < argc)
+        {
+            cfg.time_window = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            cfg.batch = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc)
+        {
+            cfg.snapshot_every = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--snapshot-sec") == 0 && i + 1 < argc)
+        {
+            cfg.snapshot_sec = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+        {
+            checkpoint = argv[++i];
+        }
+        else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc)
+        {
+            checkpoint_every = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--checkpoint-sec") == 0 && i + 1 < argc)
+        {
+            checkpoint_sec = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--resume") == 0)
+        {
+            resume = 1;
+        }
+        else if (strcmp(argv[i], "--skip-consumed") == 0)
+        {
+            skip_consumed = 1;
+        }
+        else
+        {
+            fprintf(stderr, "Opcao desconhecida: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (k < 1 || cfg.window < 1 || cfg.batch < 1)
+    {
+        fprintf(stderr, "Parametros invalidos.\n");
+        return 1;
+    }
+
+    stream_state st;
+    double* bx = (double*)malloc(sizeof(double) * cfg.batch);
+    double* by = (double*)malloc(sizeof(double) * cfg.batch);
+    double* bt = (double*)malloc(sizeof(double) * cfg.batch);
+    if (stream_state_init(&st, k) != 0 || !bx || !by || !bt)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        return 1;
+    }
+
+    unsigned long long batches = 0;
+    unsigned long long to_skip = 0;
+    if (resume && checkpoint)
+    {
+        if (stream_resume(checkpoint, &st, &batches) == 0)
+        {
+            fprintf(stderr, "Retomando de %s: %llu eventos, %llu micro-lotes\n", checkpoint,
+                    st.events, batches);
+            to_skip = skip_consumed ? st.events : 0;
+        }
+        else
+        {
+            fprintf(stderr, "Checkpoint %s ausente ou incompativel; comecando do zero.\n", checkpoint);
+        }
+    }
+    kmeans_checkpointer ck;
+    if (checkpoint)
+    {
+        if (checkpoint_every <= 0 && checkpoint_sec <= 0.0)
+        {
+            checkpoint_every = 100;
+        }
+        kmeans_checkpointer_start(&ck, checkpoint, checkpoint_every, checkpoint_sec);
+        ck.last_iter = batches;
+    }
+
+    fprintf(stderr, "K-Means em fluxo: clusters %d, janela %s %g, lote %d, threads %d\n", k,
+            cfg.time_window > 0.0 ? "por tempo (s)" : "por contagem",
+            cfg.time_window > 0.0 ? cfg.time_window : (double)cfg.window, cfg.batch,
+            omp_get_max_threads());
+
+    char buffer[512];
+    int m = 0;
+    double start = omp_get_wtime();
+    double last_snapshot_time = start;
+    unsigned long long next_snapshot = st.events + (unsigned long long)cfg.snapshot_every;
+
+    unsigned long long events_at_start = st.events;
+    int first_line = 1;
+    for (;;)
+    {
+        int eof = fgets(buffer, sizeof(buffer), stdin) == NULL;
+        if (!eof && first_line)
+        {
+            first_line = 0;
+            if (!(buffer[0] >= '0' && buffer[0] <= '9'))
+            {
+                continue; /* descarta cabecalho */
+            }
+        }
+        if (!eof && parse_event(buffer, &bx[m], &by[m], &bt[m]))
+        {
+            if (to_skip > 0)
+            {
+                to_skip--; /* ja consumido antes do checkpoint */
+                continue;
+            }
+            m++;
+        }
+        if (m == cfg.batch || (eof && m > 0))
+        {
+            stream_update(&st, bx, by, bt, m, &cfg);
+            m = 0;
+            batches++;
+
+            double now = omp_get_wtime();
+            if (checkpoint && kmeans_checkpoint_due(&ck, batches))
+            {
+                stream_checkpoint(&ck, &st, batches, now - start);
+            }
+            int due = (cfg.snapshot_every > 0 && st.events >= next_snapshot) ||
+                      (cfg.snapshot_sec > 0.0 && now - last_snapshot_time >= cfg.snapshot_sec);
+            if (due)
+            {
+                emit_snapshot(&st, now - start);
+                last_snapshot_time = now;
+                while (cfg.snapshot_every > 0 && next_snapshot <= st.events)
+                {
+                    next_snapshot += (unsigned long long)cfg.snapshot_every;
+                }
+            }
+        }
+        if (eof)
+        {
+            break;
+        }
+    }
+
+    double elapsed = omp_get_wtime() - start;
+    if (checkpoint)
+    {
+        /* checkpoint final: um novo --resume continua exatamente daqui */
+        kmeans_checkpoint_wait(&ck);
+        stream_checkpoint(&ck, &st, batches, elapsed);
+        kmeans_checkpointer_stop(&ck);
+        fprintf(stderr, "Checkpoints: %llu gravados, %llu com falha, %llu pulados\n",
+                (unsigned long long)ck.written, (unsigned long long)ck.failed, (unsigned long long)ck.skipped);
+    }
+    emit_snapshot(&st, elapsed);
+    unsigned long long processed = st.events - events_at_start;
+    fprintf(stderr, "Eventos: %llu em %.3f s (%.2f M eventos/s)\n", processed, elapsed,
+            elapsed > 0.0 ? processed / elapsed / 1e6 : 0.0);
+
+    stream_state_free(&st);
+    free(bx);
+    free(by);
+    free(bt);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file k_means_clustering_sum_bench.c
+ * @brief Custo e precisao do acumulo compensado (COMPENSATED_SUM) contra a
+ *        soma ingenua dos centroides.
+ *
+ * Carrega a base (replicada como nas outras versoes), replica mais `fator`
+ * vezes, soma `offset` as coordenadas (dados com valores grandes, como
+ * coordenadas projetadas, pioram o arredondamento), agrupa uma vez e entao
+ * mede kMeans_omp_accumulate_plain e kMeans_omp_accumulate_compensated
+ * sobre os mesmos grupos. A referencia e uma soma de Neumaier em long double
+ * ponto a ponto. Tambem conta quantos rotulos mudam entre os centroides
+ * ingenuos e os compensados.
+ *
+ * Uso: ./kmeans_sum_bench [fator] [offset]
+ */
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "kmeans_common.h"
+
+#define BENCH_REPEATS 5
+
+/* referencia: Neumaier em long double, sequencial */
+static void reference_centroids(const observation* observations, size_t size, int k,
+                                long double* ref_x, long double* ref_y)
+{
+    long double* comp = (long double*)calloc(2 * (size_t)k, sizeof(long double));
+    size_t* count = (size_t*)calloc((size_t)k, sizeof(size_t));
+    for (int c = 0; c < k; c++)
+    {
+        ref_x[c] = 0.0L;
+        ref_y[c] = 0.0L;
+    }
+    for (size_t j = 0; j < size; j++)
+    {
+        int g = observations[j].group;
+        long double* sums[2] = {&ref_x[g], &ref_y[g]};
+        long double vals[2] = {observations[j].x, observations[j].y};
+        for (int d = 0; d < 2; d++)
+        {
+            long double t = *sums[d] + vals[d];
+            if (fabsl(*sums[d]) >= fabsl(vals[d]))
+            {
+                comp[2 * g + d] += (*sums[d] - t) + vals[d];
+            }
+            else
+            {
+                comp[2 * g + d] += (vals[d] - t) + *sums[d];
+            }
+            *sums[d] = t;
+        }
+        count[g]++;
+    }
+    for (int c = 0; c < k; c++)
+    {
+        ref_x[c] = count[c] ? (ref_x[c] + comp[2 * c]) / count[c] : 0.0L;
+        ref_y[c] = count[c] ? (ref_y[c] + comp[2 * c + 1]) / count[c] : 0.0L;
+    }
+    free(comp);
+    free(count);
+}
+
+typedef void (*accumulate_fn)(const observation*, size_t, int, cluster*);
+
+static double time_accumulate(accumulate_fn fn, const observation* observations, size_t size,
+                              int k, cluster* clusters)
+{
+    double best = 1e30;
+    for (int r = 0; r < BENCH_REPEATS; r++)
+    {
+        double start = omp_get_wtime();
+        fn(observations, size, k, clusters);
+        double elapsed = omp_get_wtime() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    for (int c = 0; c < k; c++)
+    {
+        clusters[c].x /= clusters[c].count;
+        clusters[c].y /= clusters[c].count;
+    }
+    return best;
+}
+
+static double max_rel_error(const cluster* clusters, const long double* ref_x,
+                            const long double* ref_y, int k)
+{
+    double worst = 0.0;
+    for (int c = 0; c < k; c++)
+    {
+        double ex = (double)fabsl((clusters[c].x - ref_x[c]) / ref_x[c]);
+        double ey = (double)fabsl((clusters[c].y - ref_y[c]) / ref_y[c]);
+        worst = fmax(worst, fmax(ex, ey));
+    }
+    return worst;
+}
+
+/* rotulos que mudam entre dois conjuntos de centroides */
+static size_t label_flips(const observation* observations, size_t size, const cluster* a,
+                          const cluster* b, int k)
+{
+    size_t flips = 0;
+    #pragma omp parallel for reduction(+ : flips) schedule(static)
+    for (size_t j = 0; j < size; j++)
+    {
+        flips += calculateNearest(&observations[j], a, k) != calculateNearest(&observations[j], b, k);
+    }
+    return flips;
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    int k = 5;
+    size_t factor = argc > 1 ? (size_t)atol(argv[1]) : 4;
+    double offset = argc > 2 ? atof(argv[2]) : 0.0;
+
+    size_t base_size = 0;
+    observation* base = load_observations(filename, &base_size);
+    if (!base || factor < 1)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
+    size_t size = 0;
+    observation* observations = replicate_dataset(base, base_size, factor, &size);
+    free(base);
+    if (!observations)
+    {
+        fprintf(stderr, "Erro de memoria.\n");
+        return 1;
+    }
+    for (size_t j = 0; j < size; j++)
+    {
+        observations[j].x += offset;
+        observations[j].y += offset;
+    }
+
+    srand((unsigned int)time(NULL));
+    cluster* fit = kMeans_omp(observations, size, k);
+    free(fit);
+
+    long double* ref_x = (long double*)malloc(sizeof(long double) * k);
+    long double* ref_y = (long double*)malloc(sizeof(long double) * k);
+    reference_centroids(observations, size, k, ref_x, ref_y);
+
+    cluster* plain = (cluster*)calloc(k, sizeof(cluster));
+    cluster* comp = (cluster*)calloc(k, sizeof(cluster));
+    double t_plain = time_accumulate(kMeans_omp_accumulate_plain, observations, size, k, plain);
+    double t_comp = time_accumulate(kMeans_omp_accumulate_compensated, observations, size, k, comp);
+
+    printf("Acumulo dos centroides: %zu pontos, offset %.3g, %d threads, bloco %d\n", size, offset,
+           omp_get_max_threads(), SUM_BLOCK);
+    printf("Ingenuo    : %.6f s, maior erro relativo %.3e\n", t_plain,
+           max_rel_error(plain, ref_x, ref_y, k));
+    printf("Compensado : %.6f s, maior erro relativo %.3e (custo %+.1f%%)\n", t_comp,
+           max_rel_error(comp, ref_x, ref_y, k), 100.0 * (t_comp / t_plain - 1.0));
+    printf("Rotulos diferentes entre os dois conjuntos de centroides: %zu\n",
+           label_flips(observations, size, plain, comp, k));
+
+    free(plain);
+    free(comp);
+    free(ref_x);
+    free(ref_y);
+    free(observations);
+    return 0;
+}
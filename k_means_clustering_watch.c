@@ -0,0 +1,324 @@
+/**
+ * @file k_means_clustering_watch.c
+ * @brief Modo "watch": acompanha um CSV que cresce por append e reagrupa de
+ *        forma incremental, sem recarregar nem reajustar do zero.
+ *
+ * Guarda o deslocamento em bytes ja lido (ate a ultima linha completa).
+ * Quando o arquivo cresce, so o trecho novo e parseado; os pontos novos
+ * (replicados como na carga inicial) sao atribuidos aos centroides atuais
+ * e seguem algumas iteracoes de Lloyd com warm start sobre a base toda.
+ * Se o arquivo encolher (rotacao/truncamento) a base e recarregada.
+ *
+ * Uso: ./kmeans_watch [arquivo] [--interval ms] [--max-warm N] [--compare] [--once]
+ *   --compare  mede tambem recarga + reajuste completo para comparar o custo
+ *   --once     sai depois de processar a primeira mudanca
+ */
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kmeans_common.h"
+
+#define DEFAULT_INTERVAL_MS 1000
+#define DEFAULT_MAX_WARM 5
+
+typedef struct
+{
+    observation* observations;
+    size_t size;
+    size_t capacity;
+    long offset; /* bytes ja ingeridos (fim da ultima linha completa) */
+} watched_dataset;
+
+static int reserve(watched_dataset* ds, size_t needed)
+{
+    if (needed <= ds->capacity)
+    {
+        return 0;
+    }
+    size_t capacity = ds->capacity ? ds->capacity : 1024;
+    while (capacity < needed)
+    {
+        capacity *= 2;
+    }
+    observation* tmp = (observation*)realloc(ds->observations, sizeof(observation) * capacity);
+    if (!tmp)
+    {
+        return -1;
+    }
+    ds->observations = tmp;
+    ds->capacity = capacity;
+    return 0;
+}
+
+/*
+ * Le [ds->offset, fim) e acrescenta as linhas completas, cada uma replicada
+ * REPLICATION_FACTOR vezes. Retorna quantas observacoes entraram ou -1.
+ */
+static long ingest_tail(watched_dataset* ds, const char* filename)
+{
+    FILE* f = fopen(filename, "r");
+    if (!f)
+    {
+        return -1;
+    }
+    fseek(f, ds->offset, SEEK_SET);
+
+    char buffer[512];
+    size_t rows_cap = 1024, rows = 0;
+    double* row_x = (double*)malloc(sizeof(double) * rows_cap);
+    double* row_y = (double*)malloc(sizeof(double) * rows_cap);
+    long pos = ds->offset;
+    if (!row_x || !row_y)
+    {
+        free(row_x);
+        free(row_y);
+        fclose(f);
+        return -1;
+    }
+
+    int failed = 0;
+    while (fgets(buffer, sizeof(buffer), f))
+    {
+        size_t len = strlen(buffer);
+        long line_start = pos;
+        int overlong = 0;
+        while (len > 0 && buffer[len - 1] != '\n' && len == sizeof(buffer) - 1)
+        {
+            /* buffer cheio sem '\n': linha longa demais, consome o resto dela */
+            pos += (long)len;
+            overlong = 1;
+            if (!fgets(buffer, sizeof(buffer), f))
+            {
+                len = 0;
+                break;
+            }
+            len = strlen(buffer);
+        }
+        if (len == 0 || buffer[len - 1] != '\n')
+        {
+            pos = line_start;
+            break; /* linha ainda sendo escrita (EOF antes do '\n'): fica para a proxima vez */
+        }
+        pos += (long)len;
+        if (overlong)
+        {
+            continue; /* linha completa mas longa demais para ser uma observacao: pula */
+        }
+
+        double x, y;
+        if (line_start == 0 || !parse_csv_line(buffer, &x, &y))
+        {
+            continue; /* cabecalho ou linha invalida */
+        }
+        if (rows >= rows_cap)
+        {
+            double* grown_x = (double*)realloc(row_x, sizeof(double) * rows_cap * 2);
+            if (grown_x)
+            {
+                row_x = grown_x;
+            }
+            double* grown_y = grown_x ? (double*)realloc(row_y, sizeof(double) * rows_cap * 2) : NULL;
+            if (grown_y)
+            {
+                row_y = grown_y;
+            }
+            if (!grown_x || !grown_y)
+            {
+                failed = 1;
+                break;
+            }
+            rows_cap *= 2;
+        }
+        row_x[rows] = x;
+        row_y[rows] = y;
+        rows++;
+    }
+    fclose(f);
+
+    size_t added = rows * REPLICATION_FACTOR;
+    if (failed || reserve(ds, ds->size + added) != 0)
+    {
+        free(row_x);
+        free(row_y);
+        return -1;
+    }
+
+    /* mesmo esquema das versoes: bloco r e a copia r de todas as linhas novas */
+    for (size_t r = 0; r < REPLICATION_FACTOR; r++)
+    {
+        for (size_t i = 0; i < rows; i++)
+        {
+            observation* o = &ds->observations[ds->size + r * rows + i];
+            o->x = row_x[i];
+            o->y = row_y[i];
+            o->group = -1;
+        }
+    }
+
+    ds->size += added;
+    ds->offset = pos;
+    free(row_x);
+    free(row_y);
+    return (long)added;
+}
+
+/* Lloyd com warm start limitado a `max_iters`; retorna iteracoes feitas */
+static size_t warm_lloyd(watched_dataset* ds, int k, cluster* clusters, size_t max_iters)
+{
+    size_t minAcceptedError = ds->size / 10000;
+    size_t iters = 0;
+    size_t changed;
+    do
+    {
+        kMeans_omp_update(ds->observations, ds->size, k, clusters);
+        changed = kMeans_omp_assign(ds->observations, ds->size, clusters, k);
+        iters++;
+    } while (changed > minAcceptedError && iters < max_iters);
+    return iters;
+}
+
+/* referencia: o que custaria recarregar o arquivo todo e reajustar do zero */
+static double full_reload_and_refit(const char* filename, int k)
+{
+    double start = omp_get_wtime();
+    size_t size = 0;
+    observation* observations = load_dataset(filename, &size);
+    if (!observations)
+    {
+        return -1.0;
+    }
+    cluster* clusters = kMeans_omp(observations, size, k);
+    double elapsed = omp_get_wtime() - start;
+    free(clusters);
+    free(observations);
+    return elapsed;
+}
+
+static void print_clusters(const cluster* clusters, int k)
+{
+    for (int i = 0; i < k; i++)
+    {
+        printf("Cluster %d: centroid (%.4f, %.4f), pontos=%zu\n", i,
+               clusters[i].x, clusters[i].y, clusters[i].count);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = "Instagram_visits_clustering.csv";
+    int k = 5;
+    int interval_ms = DEFAULT_INTERVAL_MS;
+    size_t max_warm = DEFAULT_MAX_WARM;
+    int compare = 0;
+    int once = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+        {
+            interval_ms = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-warm") == 0 && i + 1 < argc)
+        {
+            max_warm = (size_t)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--compare") == 0)
+        {
+            compare = 1;
+        }
+        else if (strcmp(argv[i], "--once") == 0)
+        {
+            once = 1;
+        }
+        else
+        {
+            filename = argv[i];
+        }
+    }
+
+    srand((unsigned int)time(NULL));
+
+    watched_dataset ds;
+    memset(&ds, 0, sizeof(ds));
+    double start = omp_get_wtime();
+    if (ingest_tail(&ds, filename) <= 0)
+    {
+        fprintf(stderr, "Erro ao carregar dataset.\n");
+        return 1;
+    }
+    cluster* clusters = kMeans_omp(ds.observations, ds.size, k);
+    double initial = omp_get_wtime() - start;
+
+    printf("K-Means OpenMP (CPU) - watch de %s\n", filename);
+    printf("Observacoes efetivas: %zu, clusters: %d, carga + ajuste inicial: %.6f s\n",
+           ds.size, k, initial);
+    print_clusters(clusters, k);
+
+    for (;;)
+    {
+        usleep((useconds_t)interval_ms * 1000);
+
+        struct stat st;
+        if (stat(filename, &st) != 0 || (long)st.st_size == ds.offset)
+        {
+            continue;
+        }
+
+        if ((long)st.st_size < ds.offset)
+        {
+            /* arquivo truncado ou rotacionado: recomeca do zero */
+            printf("Arquivo encolheu; recarregando.\n");
+            ds.size = 0;
+            ds.offset = 0;
+            start = omp_get_wtime();
+            if (ingest_tail(&ds, filename) <= 0)
+            {
+                continue;
+            }
+            free(clusters);
+            clusters = kMeans_omp(ds.observations, ds.size, k);
+            printf("Recarga + ajuste: %.6f s\n", omp_get_wtime() - start);
+            print_clusters(clusters, k);
+            continue;
+        }
+
+        start = omp_get_wtime();
+        size_t old_size = ds.size;
+        long added = ingest_tail(&ds, filename);
+        if (added <= 0)
+        {
+            continue; /* so uma linha parcial por enquanto */
+        }
+        double ingest_s = omp_get_wtime() - start;
+
+        kMeans_omp_assign(ds.observations + old_size, ds.size - old_size, clusters, k);
+        size_t iters = warm_lloyd(&ds, k, clusters, max_warm);
+        double incremental = omp_get_wtime() - start;
+
+        printf("Novas observacoes: %ld (total %zu); leitura do trecho: %.6f s, "
+               "atribuicao + %zu iteracoes com warm start: %.6f s\n",
+               added, ds.size, ingest_s, iters, incremental - ingest_s);
+        if (compare)
+        {
+            double full = full_reload_and_refit(filename, k);
+            printf("Incremental: %.6f s, recarga + reajuste completo: %.6f s (%.1fx mais barato)\n",
+                   incremental, full, incremental > 0.0 ? full / incremental : 0.0);
+        }
+        print_clusters(clusters, k);
+
+        if (once)
+        {
+            break;
+        }
+    }
+
+    free(clusters);
+    free(ds.observations);
+    return 0;
+}
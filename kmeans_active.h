@@ -0,0 +1,110 @@
+/**
+ * @file kmeans_active.h
+ * @brief Agenda de passadas do conjunto ativo (k_means_clustering_omp_active.c
+ *        e motor ativo do driver).
+ *
+ * Cada passada com margens congela os pontos com margem >= limiar T da vez.
+ * Um ponto congelado quando o deslocamento acumulado desde a ultima passada
+ * completa era d continua no mesmo grupo enquanto
+ * 2 * (deslocamento acumulado - d) < T, isto e, enquanto o deslocamento
+ * acumulado nao chega a d + T / 2. Basta guardar o menor desses limites.
+ *
+ *   kmeans_active_schedule s;
+ *   kmeans_active_init(&s, 8, 0.5, 0.01, 2);
+ *   for (;;) {
+ *       int full = kmeans_active_begin(&s, drift, &threshold);
+ *       if (full) { ...; if (convergiu) break; kmeans_active_after_full(&s, ...); }
+ *       else      { ...; kmeans_active_after_list(&s, convergiu); }
+ *       kmeans_active_freeze(&s, threshold);
+ *   }
+ */
+#ifndef KMEANS_ACTIVE_H
+#define KMEANS_ACTIVE_H
+
+#include <math.h>
+#include <stddef.h>
+
+typedef struct
+{
+    int verify_every;        /* iteracoes entre passadas completas */
+    double dense;            /* lista acima dessa fracao da base: volta as passadas simples */
+    double dense_exit;       /* trocas abaixo dessa fracao: vale montar a lista */
+    double margin_iters;     /* iteracoes de deslocamento cobertas pelo limiar */
+    double drift_since_full; /* deslocamento acumulado desde a ultima passada completa */
+    double limit;            /* menor d + T / 2 dos congelamentos desde entao */
+    int since_full;
+    int have_list;           /* lista ativa valida */
+    int build_list;          /* a proxima passada completa mede margens */
+} kmeans_active_schedule;
+
+static inline void kmeans_active_init(kmeans_active_schedule* s, int verify_every, double dense,
+                                      double dense_exit, double margin_iters)
+{
+    s->verify_every = verify_every;
+    s->dense = dense;
+    s->dense_exit = dense_exit;
+    s->margin_iters = margin_iters;
+    s->drift_since_full = 0.0;
+    s->limit = INFINITY;
+    s->since_full = 0;
+    s->have_list = 0;
+    s->build_list = 0;
+}
+
+/*
+ * Registra o deslocamento da iteracao e decide se a passada e completa.
+ * `threshold` recebe o limiar de margem que cobre margin_iters iteracoes com
+ * o deslocamento atual. Numa passada completa o estado ja volta a zero.
+ */
+static inline int kmeans_active_begin(kmeans_active_schedule* s, double drift, double* threshold)
+{
+    s->drift_since_full += drift;
+    *threshold = 2.0 * s->margin_iters * drift;
+    int full = !s->have_list || s->since_full >= s->verify_every || s->drift_since_full >= s->limit;
+    if (full)
+    {
+        s->drift_since_full = 0.0;
+        s->limit = INFINITY;
+        s->since_full = 0;
+    }
+    return full;
+}
+
+/* passada completa mede margens? (lista em construcao ou a renovar) */
+static inline int kmeans_active_wants_marks(const kmeans_active_schedule* s)
+{
+    return s->build_list || s->have_list;
+}
+
+/*
+ * Depois de uma passada completa que nao convergiu: `listed` diz se ela
+ * mediu margens e montou uma lista de `n_active` de `n` pontos; `changed` de
+ * `total` (pesos, no driver) decide se a proxima ja monta a lista.
+ */
+static inline void kmeans_active_after_full(kmeans_active_schedule* s, double changed, double total,
+                                            int listed, size_t n_active, size_t n)
+{
+    if (listed)
+    {
+        s->have_list = n_active <= s->dense * n;
+    }
+    s->build_list = changed <= s->dense_exit * total;
+}
+
+/*
+ * Depois de uma passada so na lista. Pontos congelados sao exatos pelo
+ * limite, mas a parada e confirmada na base toda: com `converged` a proxima
+ * passada e completa.
+ */
+static inline void kmeans_active_after_list(kmeans_active_schedule* s, int converged)
+{
+    s->since_full = converged ? s->verify_every : s->since_full + 1;
+}
+
+/* congela os pontos da passada que acabou de rodar com `threshold` */
+static inline void kmeans_active_freeze(kmeans_active_schedule* s, double threshold)
+{
+    s->limit = fmin(s->limit, s->drift_since_full + threshold / 2.0);
+}
+
+#endif /* KMEANS_ACTIVE_H */
@@ -0,0 +1,369 @@
+/**
+ * @file kmeans_cache.h
+ * @brief Hash de conteudo da base (XXH64, em paralelo por blocos) e cache em
+ *        disco de resultados (centroides + rotulos) por
+ *        (hash, k, D, seed, motor, tolerancia).
+ *
+ * O hash trata as colunas x/y como o fluxo de bytes (x0, y0, x1, y1, ...):
+ * cada bloco de KMEANS_HASH_BLOCK observacoes e resumido com XXH64 em
+ * paralelo e os resumos dos blocos passam por um XXH64 final (semente = n).
+ * O resultado depende so dos valores e da ordem, nao do numero de threads.
+ *
+ * Arquivo de cache: <dir>/<hash>_k<k>_d2_<motor>_t<tol>_s<seed>.kmc. Um job
+ * com o mesmo conteudo e parametros mas outra seed acha um arquivo com o
+ * mesmo prefixo e pode comecar (warm start) dos centroides dele.
+ *
+ * A chave exata so guarda execucoes frias (particao aleatoria da seed), cujo
+ * resultado depende apenas da chave. Execucoes com warm start ou retomadas
+ * de checkpoint dependem do historico e vao para _s<seed>w.kmc (e warm = 1
+ * no cabecalho): servem de ponto de partida, nunca de acerto exato.
+ */
+#ifndef KMEANS_CACHE_H
+#define KMEANS_CACHE_H
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "kmeans_common.h"
+
+#define KMEANS_HASH_BLOCK 65536
+#define KMEANS_CACHE_MAGIC 0x48434D4Bu /* "KMCH" */
+#define KMEANS_CACHE_VERSION 2u
+
+/* ---- XXH64 ---- */
+
+static const uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t xxh_rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = xxh_rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge_round(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh64_round(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* XXH64 de `count` palavras de 64 bits (len = 8*count bytes, little-endian) */
+static inline uint64_t xxh64_words(const uint64_t* w, size_t count, uint64_t seed)
+{
+    size_t i = 0;
+    uint64_t h;
+    if (count >= 4)
+    {
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+        for (; i + 4 <= count; i += 4)
+        {
+            v1 = xxh64_round(v1, w[i]);
+            v2 = xxh64_round(v2, w[i + 1]);
+            v3 = xxh64_round(v3, w[i + 2]);
+            v4 = xxh64_round(v4, w[i + 3]);
+        }
+        h = xxh_rotl64(v1, 1) + xxh_rotl64(v2, 7) + xxh_rotl64(v3, 12) + xxh_rotl64(v4, 18);
+        h = xxh64_merge_round(h, v1);
+        h = xxh64_merge_round(h, v2);
+        h = xxh64_merge_round(h, v3);
+        h = xxh64_merge_round(h, v4);
+    }
+    else
+    {
+        h = seed + XXH_PRIME64_5;
+    }
+
+    h += (uint64_t)count * 8;
+    for (; i < count; i++)
+    {
+        h ^= xxh64_round(0, w[i]);
+        h = xxh_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    return xxh64_avalanche(h);
+}
+
+/* XXH64 de um bloco de observacoes como fluxo (x, y): 2 observacoes por faixa de 32 bytes */
+static inline uint64_t xxh64_observations(const observation* o, size_t n, uint64_t seed)
+{
+    size_t count = 2 * n;
+    size_t i = 0;
+    uint64_t h;
+
+    if (count >= 4)
+    {
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+        for (; i + 2 <= n; i += 2)
+        {
+            uint64_t a, b, c, d;
+            memcpy(&a, &o[i].x, 8);
+            memcpy(&b, &o[i].y, 8);
+            memcpy(&c, &o[i + 1].x, 8);
+            memcpy(&d, &o[i + 1].y, 8);
+            v1 = xxh64_round(v1, a);
+            v2 = xxh64_round(v2, b);
+            v3 = xxh64_round(v3, c);
+            v4 = xxh64_round(v4, d);
+        }
+        h = xxh_rotl64(v1, 1) + xxh_rotl64(v2, 7) + xxh_rotl64(v3, 12) + xxh_rotl64(v4, 18);
+        h = xxh64_merge_round(h, v1);
+        h = xxh64_merge_round(h, v2);
+        h = xxh64_merge_round(h, v3);
+        h = xxh64_merge_round(h, v4);
+    }
+    else
+    {
+        h = seed + XXH_PRIME64_5;
+    }
+
+    h += (uint64_t)count * 8;
+    for (; i < n; i++) /* sobra no maximo uma observacao: 16 bytes de cauda */
+    {
+        uint64_t a, b;
+        memcpy(&a, &o[i].x, 8);
+        memcpy(&b, &o[i].y, 8);
+        h ^= xxh64_round(0, a);
+        h = xxh_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        h ^= xxh64_round(0, b);
+        h = xxh_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    return xxh64_avalanche(h);
+}
+
+/* hash de conteudo das colunas x/y, em paralelo por blocos */
+static inline uint64_t kmeans_content_hash(const observation* observations, size_t size)
+{
+    size_t blocks = (size + KMEANS_HASH_BLOCK - 1) / KMEANS_HASH_BLOCK;
+    uint64_t* digests = (uint64_t*)malloc(sizeof(uint64_t) * (blocks ? blocks : 1));
+
+    #pragma omp parallel for schedule(static)
+    for (size_t b = 0; b < blocks; b++)
+    {
+        size_t first = b * KMEANS_HASH_BLOCK;
+        size_t n = size - first < KMEANS_HASH_BLOCK ? size - first : KMEANS_HASH_BLOCK;
+        digests[b] = xxh64_observations(observations + first, n, (uint64_t)b);
+    }
+
+    uint64_t h = xxh64_words(digests, blocks, (uint64_t)size);
+    free(digests);
+    return h;
+}
+
+/* ---- cache em disco ---- */
+
+typedef struct
+{
+    uint64_t hash;
+    int k;
+    int dims;
+    unsigned int seed;
+    const char* engine; /* ex.: "omp" */
+    unsigned int tol;   /* criterio de parada: changed <= n / tol */
+    int warm;           /* 1 = resultado de warm start/retomada (arquivo _s<seed>w) */
+} kmeans_cache_key;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash;
+    uint32_t k;
+    uint32_t dims;
+    uint32_t seed;
+    uint32_t tol;
+    uint64_t n;
+    uint32_t iterations;
+    uint32_t has_labels;
+    uint32_t warm;
+    uint32_t reserved;
+    char engine[16];
+} kmeans_cache_header;
+
+static inline void kmeans_cache_prefix(const kmeans_cache_key* key, char* out, size_t len)
+{
+    snprintf(out, len, "%016llx_k%d_d%d_%s_t%u_", (unsigned long long)key->hash, key->k, key->dims,
+             key->engine, key->tol);
+}
+
+static inline void kmeans_cache_path(const char* dir, const kmeans_cache_key* key, char* out,
+                                     size_t len)
+{
+    char prefix[128];
+    kmeans_cache_prefix(key, prefix, sizeof(prefix));
+    snprintf(out, len, "%s/%ss%u%s.kmc", dir, prefix, key->seed, key->warm ? "w" : "");
+}
+
+/*
+ * Le um resultado do cache. `clusters` recebe k centroides; `labels` (se nao
+ * NULL) recebe os grupos em observations[].group. Retorna 0 em caso de acerto.
+ */
+static inline int kmeans_cache_read(const char* path, const kmeans_cache_key* key, size_t n,
+                                    cluster* clusters, observation* labels, size_t* iterations)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        return -1;
+    }
+
+    kmeans_cache_header h;
+    int ok = fread(&h, sizeof(h), 1, f) == 1 && h.magic == KMEANS_CACHE_MAGIC &&
+             h.version == KMEANS_CACHE_VERSION && h.hash == key->hash && (int)h.k == key->k &&
+             (int)h.dims == key->dims && h.tol == key->tol && h.n == n && (int)h.warm == key->warm &&
+             strncmp(h.engine, key->engine, sizeof(h.engine)) == 0;
+    for (int c = 0; ok && c < key->k; c++)
+    {
+        ok = fread(&clusters[c].x, sizeof(double), 1, f) == 1 &&
+             fread(&clusters[c].y, sizeof(double), 1, f) == 1 &&
+             fread(&clusters[c].count, sizeof(size_t), 1, f) == 1;
+    }
+
+    if (ok && labels)
+    {
+        ok = h.has_labels != 0;
+        int32_t chunk[4096];
+        for (size_t i = 0; ok && i < n; i += 4096)
+        {
+            size_t m = n - i < 4096 ? n - i : 4096;
+            ok = fread(chunk, sizeof(int32_t), m, f) == m;
+            for (size_t j = 0; ok && j < m; j++)
+            {
+                labels[i + j].group = chunk[j];
+            }
+        }
+    }
+
+    fclose(f);
+    if (ok && iterations)
+    {
+        *iterations = h.iterations;
+    }
+    return ok ? 0 : -1;
+}
+
+/*
+ * Procura um resultado com mesma base/k/motor/tolerancia e outra seed (frio
+ * ou nao). `warm` recebe a marca do arquivo achado, para o kmeans_cache_read.
+ */
+static inline int kmeans_cache_find_warm(const char* dir, const kmeans_cache_key* key, char* out,
+                                         size_t len, int* warm)
+{
+    char prefix[128], own_cold[160], own_warm[160];
+    kmeans_cache_prefix(key, prefix, sizeof(prefix));
+    size_t plen = strlen(prefix);
+    snprintf(own_cold, sizeof(own_cold), "%ss%u.kmc", prefix, key->seed);
+    snprintf(own_warm, sizeof(own_warm), "%ss%uw.kmc", prefix, key->seed);
+
+    DIR* d = opendir(dir);
+    if (!d)
+    {
+        return -1;
+    }
+    struct dirent* e;
+    int found = -1;
+    while ((e = readdir(d)) != NULL)
+    {
+        size_t nlen = strlen(e->d_name);
+        if (strncmp(e->d_name, prefix, plen) == 0 && nlen > 5 &&
+            strcmp(e->d_name + nlen - 4, ".kmc") == 0 && strcmp(e->d_name, own_cold) != 0 &&
+            strcmp(e->d_name, own_warm) != 0)
+        {
+            snprintf(out, len, "%s/%s", dir, e->d_name);
+            *warm = e->d_name[nlen - 5] == 'w';
+            found = 0;
+            break;
+        }
+    }
+    closedir(d);
+    return found;
+}
+
+static inline int kmeans_cache_write(const char* dir, const kmeans_cache_key* key, size_t n,
+                                     const cluster* clusters, const observation* labels,
+                                     size_t iterations)
+{
+    mkdir(dir, 0755);
+
+    char path[1024], tmp[1100];
+    kmeans_cache_path(dir, key, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "wb");
+    if (!f)
+    {
+        return -1;
+    }
+
+    kmeans_cache_header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = KMEANS_CACHE_MAGIC;
+    h.version = KMEANS_CACHE_VERSION;
+    h.hash = key->hash;
+    h.k = (uint32_t)key->k;
+    h.dims = (uint32_t)key->dims;
+    h.seed = key->seed;
+    h.tol = key->tol;
+    h.n = n;
+    h.iterations = (uint32_t)iterations;
+    h.has_labels = labels != NULL;
+    h.warm = (uint32_t)(key->warm != 0);
+    snprintf(h.engine, sizeof(h.engine), "%s", key->engine);
+
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (int c = 0; ok && c < key->k; c++)
+    {
+        ok = fwrite(&clusters[c].x, sizeof(double), 1, f) == 1 &&
+             fwrite(&clusters[c].y, sizeof(double), 1, f) == 1 &&
+             fwrite(&clusters[c].count, sizeof(size_t), 1, f) == 1;
+    }
+    if (labels)
+    {
+        int32_t chunk[4096];
+        for (size_t i = 0; ok && i < n; i += 4096)
+        {
+            size_t m = n - i < 4096 ? n - i : 4096;
+            for (size_t j = 0; j < m; j++)
+            {
+                chunk[j] = labels[i + j].group;
+            }
+            ok = fwrite(chunk, sizeof(int32_t), m, f) == m;
+        }
+    }
+
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp, path) != 0)
+    {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+#endif /* KMEANS_CACHE_H */
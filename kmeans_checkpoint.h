@@ -0,0 +1,327 @@
+/**
+ * @file kmeans_checkpoint.h
+ * @brief Checkpoint periodico e retomada de execucoes longas.
+ *
+ * Um checkpoint guarda o cabecalho (iteracao, estado do RNG, seed, ...),
+ * um vetor de doubles com o estado do motor (centroides no Lloyd; somas,
+ * pesos e centroides no fluxo) e, opcionalmente, os rotulos em int32.
+ *
+ * A gravacao e assincrona: o laco so copia o estado para um buffer de
+ * preparo e sinaliza uma thread escritora, que grava em <arquivo>.tmp e
+ * faz rename (o arquivo anterior fica valido ate o rename). Se a escrita
+ * anterior ainda estiver em andamento, o checkpoint da vez e pulado em vez
+ * de bloquear o laco.
+ *
+ *   kmeans_checkpointer ck;
+ *   kmeans_checkpointer_start(&ck, "run.ckpt", 10, 0.0);   // a cada 10 iteracoes
+ *   ... if (kmeans_checkpoint_due(&ck, iter)) kmeans_checkpoint_submit(&ck, &h, state, obs);
+ *   kmeans_checkpointer_stop(&ck);
+ */
+#ifndef KMEANS_CHECKPOINT_H
+#define KMEANS_CHECKPOINT_H
+
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "kmeans_common.h"
+
+#define KMEANS_CKPT_MAGIC 0x50434D4Bu /* "KMCP" */
+#define KMEANS_CKPT_VERSION 1u
+
+#define KMEANS_CKPT_LLOYD 1u  /* payload: k x (x, y, count) */
+#define KMEANS_CKPT_STREAM 2u /* payload: sum_x, sum_y, weight, cx, cy (k cada) + last_time */
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t kind;
+    uint32_t k;
+    uint32_t dims;
+    uint32_t has_labels;
+    uint64_t iteration; /* iteracoes de Lloyd ou micro-lotes ja aplicados */
+    uint64_t n;         /* pontos da base (Lloyd) ou eventos consumidos (fluxo) */
+    uint64_t seed;
+    uint64_t rng_state; /* estado do rand_r apos a inicializacao */
+    uint64_t data_hash; /* hash de conteudo da base (0 = nao conferido) */
+    uint64_t payload_doubles;
+    double elapsed; /* segundos de computo ate o checkpoint */
+    char source[256];
+} kmeans_checkpoint_header;
+
+typedef struct
+{
+    char path[1024];
+    long every_iters;  /* 0 = desligado */
+    double every_sec;  /* 0 = desligado */
+    uint64_t last_iter;
+    double last_time;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int pending; /* buffer de preparo cheio, aguardando a escritora */
+    int busy;    /* escritora gravando */
+    int stop;
+
+    kmeans_checkpoint_header header;
+    double* payload;
+    size_t payload_cap;
+    int32_t* labels;
+    size_t labels_cap;
+
+    uint64_t written; /* gravados com sucesso */
+    uint64_t failed;  /* erro de escrita ou sem memoria para o buffer de preparo */
+    uint64_t skipped;
+    double write_seconds;
+} kmeans_checkpointer;
+
+static inline int kmeans_checkpoint_write_file(const char* path, const kmeans_checkpoint_header* h,
+                                               const double* payload, const int32_t* labels)
+{
+    char tmp[1100];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "wb");
+    if (!f)
+    {
+        return -1;
+    }
+    int ok = fwrite(h, sizeof(*h), 1, f) == 1 &&
+             fwrite(payload, sizeof(double), h->payload_doubles, f) == h->payload_doubles;
+    if (ok && h->has_labels)
+    {
+        ok = fwrite(labels, sizeof(int32_t), h->n, f) == h->n;
+    }
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp, path) != 0)
+    {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void* kmeans_checkpoint_writer(void* arg)
+{
+    kmeans_checkpointer* c = (kmeans_checkpointer*)arg;
+    pthread_mutex_lock(&c->lock);
+    for (;;)
+    {
+        while (!c->pending && !c->stop)
+        {
+            pthread_cond_wait(&c->cond, &c->lock);
+        }
+        if (!c->pending)
+        {
+            break; /* stop sem nada pendente */
+        }
+        c->busy = 1;
+        c->pending = 0;
+        pthread_mutex_unlock(&c->lock);
+
+        double start = omp_get_wtime();
+        int ok = kmeans_checkpoint_write_file(c->path, &c->header, c->payload, c->labels) == 0;
+        if (!ok)
+        {
+            fprintf(stderr, "Erro ao gravar checkpoint %s\n", c->path);
+        }
+        double elapsed = omp_get_wtime() - start;
+
+        pthread_mutex_lock(&c->lock);
+        c->busy = 0;
+        if (ok)
+        {
+            c->written++;
+        }
+        else
+        {
+            c->failed++;
+        }
+        c->write_seconds += elapsed;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+static inline int kmeans_checkpointer_start(kmeans_checkpointer* c, const char* path,
+                                            long every_iters, double every_sec)
+{
+    memset(c, 0, sizeof(*c));
+    snprintf(c->path, sizeof(c->path), "%s", path);
+    c->every_iters = every_iters;
+    c->every_sec = every_sec;
+    c->last_time = omp_get_wtime();
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+    return pthread_create(&c->thread, NULL, kmeans_checkpoint_writer, c);
+}
+
+/* cadencia por iteracoes e/ou por tempo de relogio */
+static inline int kmeans_checkpoint_due(kmeans_checkpointer* c, uint64_t iteration)
+{
+    if (c->every_iters > 0 && iteration >= c->last_iter + (uint64_t)c->every_iters)
+    {
+        return 1;
+    }
+    return c->every_sec > 0.0 && omp_get_wtime() - c->last_time >= c->every_sec;
+}
+
+/*
+ * Copia o estado para o buffer de preparo e acorda a escritora. Com
+ * `observations` != NULL os rotulos (h->n) entram no checkpoint. Retorna 0
+ * se enfileirou, 1 se pulou porque a escrita anterior nao terminou e -1 sem
+ * memoria para o buffer de preparo (conta como falha).
+ */
+static inline int kmeans_checkpoint_submit(kmeans_checkpointer* c, const kmeans_checkpoint_header* h,
+                                           const double* payload, const observation* observations)
+{
+    pthread_mutex_lock(&c->lock);
+    int free_slot = !c->pending && !c->busy;
+    pthread_mutex_unlock(&c->lock);
+    c->last_iter = h->iteration;
+    c->last_time = omp_get_wtime();
+    if (!free_slot)
+    {
+        c->skipped++;
+        return 1;
+    }
+
+    /* a escritora esta ociosa: o buffer de preparo pode ser reescrito sem lock */
+    if (h->payload_doubles > c->payload_cap)
+    {
+        free(c->payload);
+        c->payload = (double*)malloc(sizeof(double) * h->payload_doubles);
+        c->payload_cap = c->payload ? h->payload_doubles : 0;
+        if (!c->payload)
+        {
+            c->failed++;
+            return -1;
+        }
+    }
+    memcpy(c->payload, payload, sizeof(double) * h->payload_doubles);
+    c->header = *h;
+    c->header.magic = KMEANS_CKPT_MAGIC;
+    c->header.version = KMEANS_CKPT_VERSION;
+    c->header.has_labels = observations != NULL;
+
+    if (observations)
+    {
+        size_t n = (size_t)h->n;
+        if (n > c->labels_cap)
+        {
+            free(c->labels);
+            c->labels = (int32_t*)malloc(sizeof(int32_t) * n);
+            c->labels_cap = c->labels ? n : 0;
+            if (!c->labels)
+            {
+                c->failed++;
+                return -1;
+            }
+        }
+        int32_t* labels = c->labels;
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; i++)
+        {
+            labels[i] = observations[i].group;
+        }
+    }
+
+    pthread_mutex_lock(&c->lock);
+    c->pending = 1;
+    pthread_cond_signal(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    return 0;
+}
+
+/* espera a escrita em andamento (para um checkpoint final que nao pode ser pulado) */
+static inline void kmeans_checkpoint_wait(kmeans_checkpointer* c)
+{
+    pthread_mutex_lock(&c->lock);
+    while (c->pending || c->busy)
+    {
+        pthread_mutex_unlock(&c->lock);
+        sched_yield();
+        pthread_mutex_lock(&c->lock);
+    }
+    pthread_mutex_unlock(&c->lock);
+}
+
+/* grava o que estiver pendente e encerra a escritora */
+static inline void kmeans_checkpointer_stop(kmeans_checkpointer* c)
+{
+    pthread_mutex_lock(&c->lock);
+    c->stop = 1;
+    pthread_cond_signal(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    pthread_join(c->thread, NULL);
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->cond);
+    free(c->payload);
+    free(c->labels);
+}
+
+/*
+ * Le um checkpoint. `payload` e alocado aqui; `labels` (opcional) tambem,
+ * e so se o arquivo tiver rotulos. Os tamanhos do cabecalho sao conferidos
+ * contra o tamanho do arquivo antes de alocar, entao um checkpoint truncado
+ * ou corrompido e rejeitado. Retorna 0 em caso de sucesso.
+ */
+static inline int kmeans_checkpoint_load(const char* path, kmeans_checkpoint_header* h,
+                                         double** payload, int32_t** labels)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        return -1;
+    }
+    *payload = NULL;
+    if (labels)
+    {
+        *labels = NULL;
+    }
+
+    struct stat st;
+    int ok = fstat(fileno(f), &st) == 0 && (uint64_t)st.st_size >= sizeof(*h) &&
+             fread(h, sizeof(*h), 1, f) == 1 && h->magic == KMEANS_CKPT_MAGIC &&
+             h->version == KMEANS_CKPT_VERSION;
+    if (ok)
+    {
+        /* payload e rotulos precisam caber no que sobra do arquivo */
+        uint64_t rest = (uint64_t)st.st_size - sizeof(*h);
+        ok = h->payload_doubles <= rest / sizeof(double);
+        rest -= ok ? h->payload_doubles * sizeof(double) : 0;
+        ok = ok && (!h->has_labels || h->n <= rest / sizeof(int32_t));
+    }
+    if (ok)
+    {
+        *payload = (double*)malloc(sizeof(double) * (h->payload_doubles ? h->payload_doubles : 1));
+        ok = *payload && fread(*payload, sizeof(double), h->payload_doubles, f) == h->payload_doubles;
+    }
+    if (ok && labels && h->has_labels)
+    {
+        *labels = (int32_t*)malloc(sizeof(int32_t) * (h->n ? h->n : 1));
+        ok = *labels && fread(*labels, sizeof(int32_t), h->n, f) == h->n;
+    }
+    fclose(f);
+
+    if (!ok)
+    {
+        free(*payload);
+        *payload = NULL;
+        if (labels)
+        {
+            free(*labels);
+            *labels = NULL;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+#endif /* KMEANS_CHECKPOINT_H */
@@ -0,0 +1,506 @@
+/**
+ * @file kmeans_common.h
+ * @brief Tipos, leitura do CSV e laco de Lloyd OpenMP compartilhados pelas
+ *        versoes derivadas de k_means_clustering_omp_cpu.c.
+ *
+ * As quatro versoes originais continuam autocontidas; os programas novos
+ * (multi-resolucao, MPI, etc.) incluem este cabecalho para nao replicar
+ * o loader e o motor OpenMP em cada arquivo.
+ */
+#ifndef KMEANS_COMMON_H
+#define KMEANS_COMMON_H
+
+#include <float.h>
+#include <math.h>
+#include <omp.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kmeans_shm.h"
+#include "kmeans_sum.h"
+
+#ifndef REPLICATION_FACTOR
+#define REPLICATION_FACTOR 1000
+#endif
+
+#ifndef NUM_RUNS
+#define NUM_RUNS 30
+#endif
+
+typedef struct
+{
+    double x;
+    double y;
+    int group;
+} observation;
+
+typedef struct
+{
+    double x;
+    double y;
+    size_t count;
+} cluster;
+
+static inline int calculateNearest(const observation* o, const cluster* clusters, int k)
+{
+    double minD = DBL_MAX;
+    int index = 0;
+    for (int i = 0; i < k; i++)
+    {
+        double dx = clusters[i].x - o->x;
+        double dy = clusters[i].y - o->y;
+        double dist = dx * dx + dy * dy;
+        if (dist < minD)
+        {
+            minD = dist;
+            index = i;
+        }
+    }
+    return index;
+}
+
+/* le uma linha "id,x,y"; retorna 0 se a linha nao tiver as tres colunas */
+static inline int parse_csv_line(char* buffer, double* x, double* y)
+{
+    char* token = strtok(buffer, ",");
+    if (!token)
+    {
+        return 0;
+    }
+    token = strtok(NULL, ",");
+    if (!token)
+    {
+        return 0;
+    }
+    *x = strtod(token, NULL);
+    token = strtok(NULL, ",");
+    if (!token)
+    {
+        return 0;
+    }
+    *y = strtod(token, NULL);
+    return 1;
+}
+
+/* replica a base `replication` vezes (mesmo esquema das versoes originais) */
+static inline observation* replicate_dataset(const observation* observations, size_t size,
+                                             size_t replication, size_t* out_size)
+{
+    size_t replicated_size = size * replication;
+    observation* replicated = (observation*)malloc(sizeof(observation) * replicated_size);
+    if (!replicated)
+    {
+        return NULL;
+    }
+
+    for (size_t r = 0; r < replication; r++)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            size_t idx = r * size + i;
+            replicated[idx].x = observations[i].x;
+            replicated[idx].y = observations[i].y;
+            replicated[idx].group = 0;
+        }
+    }
+
+    *out_size = replicated_size;
+    return replicated;
+}
+
+static inline observation* load_dataset(const char* filename, size_t* out_size)
+{
+    FILE* f = fopen(filename, "r");
+    if (!f)
+    {
+        return NULL;
+    }
+
+    char buffer[512];
+    size_t capacity = 1024;
+    size_t size = 0;
+    observation* observations = (observation*)malloc(sizeof(observation) * capacity);
+    if (!observations)
+    {
+        fclose(f);
+        return NULL;
+    }
+
+    if (!fgets(buffer, sizeof(buffer), f))
+    {
+        fclose(f);
+        free(observations);
+        return NULL;
+    }
+
+    while (fgets(buffer, sizeof(buffer), f))
+    {
+        double x, y;
+        if (!parse_csv_line(buffer, &x, &y))
+        {
+            continue;
+        }
+
+        if (size >= capacity)
+        {
+            capacity *= 2;
+            observation* tmp = (observation*)realloc(observations, sizeof(observation) * capacity);
+            if (!tmp)
+            {
+                free(observations);
+                fclose(f);
+                return NULL;
+            }
+            observations = tmp;
+        }
+
+        observations[size].x = x;
+        observations[size].y = y;
+        observations[size].group = 0;
+        size++;
+    }
+
+    fclose(f);
+
+    if (size == 0)
+    {
+        free(observations);
+        return NULL;
+    }
+
+    observation* replicated = replicate_dataset(observations, size, REPLICATION_FACTOR, out_size);
+    free(observations);
+    return replicated;
+}
+
+/* base do segmento KMEANS_SHM, se definido; senao le o CSV */
+static inline observation* load_observations(const char* filename, size_t* out_size)
+{
+    const char* shm_name = getenv("KMEANS_SHM");
+    return shm_name ? (observation*)kmeans_shm_load_aos(shm_name, sizeof(observation), offsetof(observation, x),
+                                                        offsetof(observation, y), out_size)
+                    : load_dataset(filename, out_size);
+}
+
+/* somas (nao normalizadas) por grupo, com buffers locais por thread */
+static inline void kMeans_omp_accumulate_plain(const observation* observations, size_t size, int k,
+                                               cluster* clusters)
+{
+    for (int i = 0; i < k; i++)
+    {
+        clusters[i].x = 0.0;
+        clusters[i].y = 0.0;
+        clusters[i].count = 0;
+    }
+
+    #pragma omp parallel // acumula somas em buffers locais por thread
+    {
+        double* local_x = (double*)calloc((size_t)k, sizeof(double));
+        double* local_y = (double*)calloc((size_t)k, sizeof(double));
+        size_t* local_count = (size_t*)calloc((size_t)k, sizeof(size_t));
+
+        #pragma omp for
+        for (size_t j = 0; j < size; j++)
+        {
+            int g = observations[j].group;
+            local_x[g] += observations[j].x;
+            local_y[g] += observations[j].y;
+            local_count[g] += 1;
+        }
+
+        #pragma omp critical // reduz buffers locais no acumulador global
+        {
+            for (int i = 0; i < k; i++)
+            {
+                clusters[i].x += local_x[i];
+                clusters[i].y += local_y[i];
+                clusters[i].count += local_count[i];
+            }
+        }
+
+        free(local_x);
+        free(local_y);
+        free(local_count);
+    }
+}
+
+/*
+ * Mesmo acumulo com compensacao: cada bloco de SUM_BLOCK pontos soma de
+ * forma ingenua (laco quente inalterado) e so os k parciais do bloco
+ * passam pela soma de Neumaier, por thread e depois entre threads.
+ */
+static inline void kMeans_omp_accumulate_compensated(const observation* observations, size_t size,
+                                                     int k, cluster* clusters)
+{
+    double* comp = (double*)calloc(2 * (size_t)k, sizeof(double));
+    for (int i = 0; i < k; i++)
+    {
+        clusters[i].x = 0.0;
+        clusters[i].y = 0.0;
+        clusters[i].count = 0;
+    }
+
+    #pragma omp parallel
+    {
+        /* [0,k) x, [k,2k) y: soma, compensacao e parcial do bloco */
+        double* local = (double*)calloc(2 * (size_t)k, sizeof(double));
+        double* local_comp = (double*)calloc(2 * (size_t)k, sizeof(double));
+        double* block = (double*)calloc(2 * (size_t)k, sizeof(double));
+        size_t* local_count = (size_t*)calloc((size_t)k, sizeof(size_t));
+
+        #pragma omp for schedule(static)
+        for (size_t b = 0; b < size; b += SUM_BLOCK)
+        {
+            size_t end = b + SUM_BLOCK < size ? b + SUM_BLOCK : size;
+            for (size_t j = b; j < end; j++)
+            {
+                int g = observations[j].group;
+                block[g] += observations[j].x;
+                block[k + g] += observations[j].y;
+                local_count[g] += 1;
+            }
+            for (int i = 0; i < 2 * k; i++)
+            {
+                neumaier_add(&local[i], &local_comp[i], block[i]);
+                block[i] = 0.0;
+            }
+        }
+
+        #pragma omp critical
+        {
+            for (int i = 0; i < k; i++)
+            {
+                neumaier_add(&clusters[i].x, &comp[i], local[i] + local_comp[i]);
+                neumaier_add(&clusters[i].y, &comp[k + i], local[k + i] + local_comp[k + i]);
+                clusters[i].count += local_count[i];
+            }
+        }
+
+        free(local);
+        free(local_comp);
+        free(block);
+        free(local_count);
+    }
+
+    for (int i = 0; i < k; i++)
+    {
+        clusters[i].x += comp[i];
+        clusters[i].y += comp[k + i];
+    }
+    free(comp);
+}
+
+static inline void kMeans_omp_accumulate(const observation* observations, size_t size, int k, cluster* clusters)
+{
+#if COMPENSATED_SUM
+    kMeans_omp_accumulate_compensated(observations, size, k, clusters);
+#else
+    kMeans_omp_accumulate_plain(observations, size, k, clusters);
+#endif
+}
+
+/* passo de atualizacao: centroides a partir dos grupos atuais */
+static inline void kMeans_omp_update(const observation* observations, size_t size, int k, cluster* clusters)
+{
+    kMeans_omp_accumulate(observations, size, k, clusters);
+
+    for (int i = 0; i < k; i++)
+    {
+        if (clusters[i].count > 0)
+        {
+            clusters[i].x /= clusters[i].count;
+            clusters[i].y /= clusters[i].count;
+        }
+    }
+}
+
+/* passo de atribuicao: retorna quantos pontos trocaram de grupo */
+static inline size_t kMeans_omp_assign(observation* observations, size_t size, const cluster* clusters, int k)
+{
+    size_t changed = 0;
+
+    #pragma omp parallel for reduction(+ : changed) schedule(static)
+    for (size_t j = 0; j < size; j++)
+    {
+        int g = calculateNearest(&observations[j], clusters, k);
+        if (g != observations[j].group)
+        {
+            changed++;
+            observations[j].group = g;
+        }
+    }
+
+    return changed;
+}
+
+/*
+ * Laco de Lloyd a partir dos grupos ja presentes em `observations`.
+ * `iterations` (opcional) recebe o numero de iteracoes executadas.
+ */
+static inline void kMeans_omp_lloyd(observation* observations, size_t size, int k, cluster* clusters,
+                                    size_t* iterations)
+{
+    size_t minAcceptedError = size / 10000;
+    size_t changed;
+    size_t iters = 0;
+    do
+    {
+        kMeans_omp_update(observations, size, k, clusters);
+        changed = kMeans_omp_assign(observations, size, clusters, k);
+        iters++;
+    } while (changed > minAcceptedError);
+
+    if (iterations)
+    {
+        *iterations = iters;
+    }
+}
+
+/*
+ * Compactacao paralela: escreve em `out` os itens de `in` (ou os indices
+ * 0..n-1 se `in` == NULL) com keep[i] != 0, preservando a ordem. Cada thread
+ * conta seu bloco estatico, uma soma de prefixos sobre as contagens da o
+ * deslocamento de cada bloco e a escrita e feita sem sincronizacao.
+ */
+static inline size_t kmeans_compact(const size_t* in, const unsigned char* keep, size_t n, size_t* out)
+{
+    int nthreads = omp_get_max_threads();
+    size_t* offsets = (size_t*)calloc((size_t)nthreads + 1, sizeof(size_t));
+    size_t total = 0;
+    if (!offsets)
+    {
+        /* sem memoria para os deslocamentos: compacta sequencialmente */
+        for (size_t i = 0; i < n; i++)
+        {
+            if (keep[i])
+            {
+                out[total++] = in ? in[i] : i;
+            }
+        }
+        return total;
+    }
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads(); /* pode ser menor que nthreads (ajuste dinamico, aninhamento) */
+        size_t begin = n * t / nt;
+        size_t end = n * (t + 1) / nt;
+
+        size_t count = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            count += keep[i] != 0;
+        }
+        offsets[t + 1] = count;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            for (int i = 0; i < nt; i++)
+            {
+                offsets[i + 1] += offsets[i];
+            }
+            total = offsets[nt];
+        }
+
+        size_t pos = offsets[t];
+        for (size_t i = begin; i < end; i++)
+        {
+            if (keep[i])
+            {
+                out[pos++] = in ? in[i] : i;
+            }
+        }
+    }
+
+    free(offsets);
+    return total;
+}
+
+/* casos degenerados (k <= 1 ou k >= size); retorna NULL se nao se aplicam */
+static inline cluster* kMeans_omp_trivial(observation* observations, size_t size, int k)
+{
+    cluster* clusters = NULL;
+    if (k <= 1)
+    {
+        clusters = (cluster*)calloc(1, sizeof(cluster));
+        clusters->count = size;
+        for (size_t i = 0; i < size; i++)
+        {
+            clusters->x += observations[i].x;
+            clusters->y += observations[i].y;
+            observations[i].group = 0;
+        }
+        clusters->x /= clusters->count;
+        clusters->y /= clusters->count;
+        return clusters;
+    }
+
+    if ((size_t)k >= size)
+    {
+        clusters = (cluster*)calloc(k, sizeof(cluster));
+        for (size_t j = 0; j < size; j++)
+        {
+            clusters[j].x = observations[j].x;
+            clusters[j].y = observations[j].y;
+            clusters[j].count = 1;
+            observations[j].group = (int)j;
+        }
+        return clusters;
+    }
+
+    return NULL;
+}
+
+/* mesma semantica de kMeans_omp em k_means_clustering_omp_cpu.c (particao aleatoria) */
+static inline cluster* kMeans_omp_iters(observation* observations, size_t size, int k, size_t* iterations)
+{
+    cluster* clusters = kMeans_omp_trivial(observations, size, k);
+    if (clusters)
+    {
+        if (iterations)
+        {
+            *iterations = 0;
+        }
+        return clusters;
+    }
+
+    clusters = (cluster*)calloc(k, sizeof(cluster));
+    for (size_t j = 0; j < size; j++)
+    {
+        observations[j].group = rand() % k;
+    }
+
+    kMeans_omp_lloyd(observations, size, k, clusters, iterations);
+    return clusters;
+}
+
+static inline cluster* kMeans_omp(observation* observations, size_t size, int k)
+{
+    return kMeans_omp_iters(observations, size, k, NULL);
+}
+
+/*
+ * Warm start: atribui os pontos aos centroides `clusters` (ja preenchidos)
+ * e continua o laco de Lloyd a partir dai. A atribuicao inicial tambem e uma
+ * passada sobre todos os pontos e entra em `iterations`.
+ */
+static inline void kMeans_omp_warm(observation* observations, size_t size, int k, cluster* clusters,
+                                   size_t* iterations)
+{
+    for (size_t j = 0; j < size; j++)
+    {
+        observations[j].group = -1;
+    }
+    kMeans_omp_assign(observations, size, clusters, k);
+    kMeans_omp_lloyd(observations, size, k, clusters, iterations);
+    if (iterations)
+    {
+        (*iterations)++;
+    }
+}
+
+#endif /* KMEANS_COMMON_H */
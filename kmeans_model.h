@@ -0,0 +1,111 @@
+/**
+ * @file kmeans_model.h
+ * @brief Formato binario do modelo ajustado (centroides + metadados),
+ *        usado para exportar um fit e reutiliza-lo no predict.
+ *
+ * Layout: kmeans_model_header seguido de k*dims doubles (centroide a
+ * centroide) e de k contagens uint64 do ajuste.
+ */
+#ifndef KMEANS_MODEL_H
+#define KMEANS_MODEL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KMEANS_MODEL_MAGIC 0x444D4D4Bu /* "KMMD" */
+#define KMEANS_MODEL_VERSION 1u
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t k;
+    uint32_t dims;
+    uint64_t n_train;    /* observacoes usadas no ajuste */
+    uint64_t seed;
+    uint32_t iterations;
+    uint32_t reserved;
+    double fit_seconds;
+    char source[256];    /* base de origem, so informativo */
+} kmeans_model_header;
+
+typedef struct
+{
+    kmeans_model_header header;
+    double* centroids; /* k * dims */
+    uint64_t* counts;  /* k */
+} kmeans_model;
+
+/* grava de forma atomica (arquivo temporario + rename); retorna 0 em caso de sucesso */
+static inline int kmeans_model_save(const char* path, const kmeans_model* model)
+{
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "wb");
+    if (!f)
+    {
+        return -1;
+    }
+
+    kmeans_model_header header = model->header;
+    header.magic = KMEANS_MODEL_MAGIC;
+    header.version = KMEANS_MODEL_VERSION;
+    size_t values = (size_t)header.k * header.dims;
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(model->centroids, sizeof(double), values, f) == values &&
+             fwrite(model->counts, sizeof(uint64_t), header.k, f) == header.k;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp, path) != 0)
+    {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+static inline int kmeans_model_load(const char* path, kmeans_model* model)
+{
+    memset(model, 0, sizeof(*model));
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        return -1;
+    }
+
+    kmeans_model_header* h = &model->header;
+    if (fread(h, sizeof(*h), 1, f) != 1 || h->magic != KMEANS_MODEL_MAGIC ||
+        h->version != KMEANS_MODEL_VERSION || h->k == 0 || h->dims == 0 ||
+        h->k > (1u << 20) || h->dims > 64)
+    {
+        fclose(f);
+        return -1;
+    }
+
+    size_t values = (size_t)h->k * h->dims;
+    model->centroids = (double*)malloc(sizeof(double) * values);
+    model->counts = (uint64_t*)malloc(sizeof(uint64_t) * h->k);
+    if (!model->centroids || !model->counts ||
+        fread(model->centroids, sizeof(double), values, f) != values ||
+        fread(model->counts, sizeof(uint64_t), h->k, f) != h->k)
+    {
+        free(model->centroids);
+        free(model->counts);
+        memset(model, 0, sizeof(*model));
+        fclose(f);
+        return -1;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+static inline void kmeans_model_free(kmeans_model* model)
+{
+    free(model->centroids);
+    free(model->counts);
+    memset(model, 0, sizeof(*model));
+}
+
+#endif /* KMEANS_MODEL_H */
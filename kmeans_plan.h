@@ -0,0 +1,346 @@
+/**
+ * @file kmeans_plan.h
+ * @brief Planejador de memoria: escolhe layout, tratamento das duplicatas e
+ *        modo de execucao antes de carregar a base.
+ *
+ * A partir do tamanho do CSV (stat + amostra do inicio do arquivo), do fator
+ * de replicacao, de D, de k e do orcamento de RAM, decide:
+ *  - duplicatas: replicar fisicamente (como as versoes originais) ou guardar
+ *    cada linha uma vez com peso = replicacao (resultado equivalente, memoria
+ *    dividida pelo fator);
+ *  - layout: double, float ou quantizado em 16 bits por coordenada;
+ *  - execucao: em memoria, em fluxo (Lloyd exato relendo o arquivo a cada
+ *    iteracao, memoria O(bloco + k)) ou coreset (amostra ponderada em duas
+ *    passadas + Lloyd ponderado em memoria).
+ *
+ * Orcamento: KMEANS_MEM_BUDGET (bytes, aceita K/M/G) ou metade da RAM fisica.
+ */
+#ifndef KMEANS_PLAN_H
+#define KMEANS_PLAN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PLAN_SAMPLE_BYTES 65536 /* inicio do arquivo usado para estimar bytes por linha */
+#define PLAN_STREAM_RATIO 8.0   /* fluxo se a base couber em ate 8x o orcamento */
+#define PLAN_CORESET_MAX ((size_t)1 << 22)
+#define PLAN_CORESET_MIN_PER_CLUSTER 1000
+
+typedef enum
+{
+    KMEANS_LAYOUT_DOUBLE = 0,
+    KMEANS_LAYOUT_FLOAT = 1,
+    KMEANS_LAYOUT_QUANT16 = 2
+} kmeans_layout;
+
+typedef enum
+{
+    KMEANS_EXEC_MEMORY = 0,
+    KMEANS_EXEC_STREAM = 1,
+    KMEANS_EXEC_CORESET = 2
+} kmeans_exec;
+
+typedef struct
+{
+    size_t rows;           /* linhas da base (lidas ou estimadas) */
+    int rows_estimated;    /* 1 = estimativa por stat */
+    size_t replication;    /* copias de cada linha */
+    int dims;
+    int k;
+    size_t budget;         /* bytes */
+    int force_replicate;   /* pedir replicacao fisica */
+    int force_layout;      /* -1 = livre */
+    int force_exec;        /* -1 = livre */
+    int exact;             /* nao aceitar coreset nem layouts com perda */
+} kmeans_plan_input;
+
+typedef struct
+{
+    kmeans_layout layout;
+    int weighted;          /* duplicatas como peso */
+    kmeans_exec exec;
+    size_t points;         /* pontos materializados em memoria */
+    size_t bytes;          /* memoria estimada do plano */
+    size_t coreset_size;   /* alvo de pontos do coreset */
+    int over_budget;       /* coreset pedido cujo minimo nao cabe no orcamento */
+    char reason[512];
+} kmeans_plan;
+
+static inline const char* kmeans_layout_name(kmeans_layout l)
+{
+    return l == KMEANS_LAYOUT_DOUBLE ? "double" : l == KMEANS_LAYOUT_FLOAT ? "float" : "quant16";
+}
+
+static inline const char* kmeans_exec_name(kmeans_exec e)
+{
+    return e == KMEANS_EXEC_MEMORY ? "memoria" : e == KMEANS_EXEC_STREAM ? "fluxo" : "coreset";
+}
+
+/* "512M", "2G", "1048576" -> bytes; 0 se invalido */
+static inline size_t kmeans_parse_bytes(const char* text)
+{
+    char* end = NULL;
+    double v = strtod(text, &end);
+    if (end == text || v <= 0.0)
+    {
+        return 0;
+    }
+    switch (*end)
+    {
+    case 'k':
+    case 'K':
+        v *= 1024.0;
+        break;
+    case 'm':
+    case 'M':
+        v *= 1024.0 * 1024.0;
+        break;
+    case 'g':
+    case 'G':
+        v *= 1024.0 * 1024.0 * 1024.0;
+        break;
+    default:
+        break;
+    }
+    return (size_t)v;
+}
+
+/* KMEANS_MEM_BUDGET ou metade da RAM fisica */
+static inline size_t kmeans_default_budget(void)
+{
+    const char* env = getenv("KMEANS_MEM_BUDGET");
+    size_t budget = env ? kmeans_parse_bytes(env) : 0;
+    if (budget)
+    {
+        return budget;
+    }
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page = sysconf(_SC_PAGE_SIZE);
+    if (pages <= 0 || page <= 0)
+    {
+        return (size_t)1 << 30;
+    }
+    return (size_t)pages * (size_t)page / 2;
+}
+
+/*
+ * Numero de linhas de dados do CSV. Arquivos ate PLAN_SAMPLE_BYTES sao
+ * contados; maiores sao estimados pelo tamanho (stat) e pela media de bytes
+ * por linha em tres trechos (inicio, meio e fim), sem ler a base inteira.
+ * `estimated` recebe 1 no segundo caso. Retorna 0 se o arquivo nao abre.
+ */
+static inline size_t kmeans_estimate_rows(const char* filename, int* estimated)
+{
+    struct stat st;
+    if (stat(filename, &st) != 0 || st.st_size <= 0)
+    {
+        return 0;
+    }
+    FILE* f = fopen(filename, "r");
+    char* sample = (char*)malloc(PLAN_SAMPLE_BYTES);
+    if (!f || !sample)
+    {
+        if (f)
+        {
+            fclose(f);
+        }
+        free(sample);
+        return 0;
+    }
+
+    size_t file_size = (size_t)st.st_size;
+    size_t header_end = 0, rows = 0;
+    size_t sampled_rows = 0, sampled_bytes = 0;
+    *estimated = file_size > PLAN_SAMPLE_BYTES;
+    size_t offsets[3] = {0, file_size / 2, file_size - PLAN_SAMPLE_BYTES};
+    int samples = *estimated ? 3 : 1;
+
+    for (int s = 0; s < samples; s++)
+    {
+        fseek(f, (long)offsets[s], SEEK_SET);
+        size_t got = fread(sample, 1, PLAN_SAMPLE_BYTES, f);
+        size_t lines = 0, first_newline = 0, last_newline = 0;
+        for (size_t i = 0; i < got; i++)
+        {
+            if (sample[i] == '\n')
+            {
+                if (lines == 0)
+                {
+                    first_newline = i + 1;
+                }
+                lines++;
+                last_newline = i + 1;
+            }
+        }
+        if (s == 0)
+        {
+            header_end = first_newline;
+            if (!*estimated)
+            {
+                /* arquivo inteiro na amostra: conta exata (ultima linha pode nao ter '\n') */
+                rows = (lines > 0 ? lines - 1 : 0) + (lines > 0 && last_newline < got);
+            }
+        }
+        /* linhas completas entre a 1a e a ultima quebra do trecho */
+        if (lines > 1)
+        {
+            sampled_rows += lines - 1;
+            sampled_bytes += last_newline - first_newline;
+        }
+    }
+    fclose(f);
+    free(sample);
+
+    if (!*estimated)
+    {
+        return rows;
+    }
+    if (sampled_rows == 0)
+    {
+        return 1;
+    }
+    double per_row = (double)sampled_bytes / (double)sampled_rows;
+    return (size_t)((double)(file_size - header_end) / per_row + 0.5);
+}
+
+/* bytes por ponto materializado: coordenadas + rotulo (+ peso) */
+static inline size_t kmeans_plan_point_bytes(kmeans_layout layout, int dims, int weighted)
+{
+    size_t coord = layout == KMEANS_LAYOUT_DOUBLE ? sizeof(double)
+                 : layout == KMEANS_LAYOUT_FLOAT  ? sizeof(float)
+                                                  : sizeof(unsigned short);
+    return (size_t)dims * coord + sizeof(int) + (weighted ? sizeof(double) : 0);
+}
+
+/*
+ * Decide o plano. Ordem de preferencia: duplicatas como peso (exato e
+ * `replication` vezes menor; replicacao fisica so se pedida e se couber),
+ * layout double > float > quant16 (o primeiro que couber; com `exact` so
+ * double), execucao em memoria > fluxo (base ate PLAN_STREAM_RATIO vezes o
+ * orcamento, ou `exact`) > coreset. Um coreset abaixo do minimo por grupo
+ * fica no fluxo; pedido explicitamente, sai com `over_budget`. Com o alvo
+ * cobrindo a base, o coreset carrega todas as linhas com peso (exato).
+ */
+static inline void kmeans_make_plan(const kmeans_plan_input* in, kmeans_plan* plan)
+{
+    memset(plan, 0, sizeof(*plan));
+    size_t rows = in->rows ? in->rows : 1;
+    size_t total = rows * in->replication;
+
+    plan->weighted = in->replication > 1;
+    size_t points = rows;
+    if (in->force_replicate || in->replication <= 1)
+    {
+        size_t need = total * kmeans_plan_point_bytes(KMEANS_LAYOUT_DOUBLE, in->dims, 0);
+        if (need <= in->budget || in->replication <= 1)
+        {
+            plan->weighted = 0;
+            points = total;
+        }
+    }
+
+    int first = in->force_layout >= 0 ? in->force_layout : KMEANS_LAYOUT_DOUBLE;
+    int last = in->force_layout >= 0 ? in->force_layout
+             : in->exact             ? KMEANS_LAYOUT_DOUBLE
+                                     : KMEANS_LAYOUT_QUANT16;
+    int fits = 0;
+    for (int l = first; l <= last && !fits; l++)
+    {
+        plan->layout = (kmeans_layout)l;
+        plan->bytes = points * kmeans_plan_point_bytes(plan->layout, in->dims, plan->weighted);
+        fits = plan->bytes <= in->budget;
+    }
+
+    /* memoria pedida que nao cabe vira escolha livre */
+    int memory_refused = in->force_exec == KMEANS_EXEC_MEMORY && !fits;
+    int exec_free = in->force_exec < 0 || memory_refused;
+
+    char why[256];
+    if (fits && (exec_free || in->force_exec == KMEANS_EXEC_MEMORY))
+    {
+        plan->exec = KMEANS_EXEC_MEMORY;
+        plan->points = points;
+        snprintf(why, sizeof(why), "cabe no orcamento com layout %s", kmeans_layout_name(plan->layout));
+    }
+    else
+    {
+        /* fora da memoria: so as linhas da base (pesos) passam pelo fluxo */
+        plan->weighted = in->replication > 1;
+        plan->layout = KMEANS_LAYOUT_DOUBLE;
+        size_t raw = total * kmeans_plan_point_bytes(KMEANS_LAYOUT_DOUBLE, in->dims, 0);
+        size_t per_point = kmeans_plan_point_bytes(KMEANS_LAYOUT_DOUBLE, in->dims, 1);
+        size_t m = in->budget / per_point;
+        size_t floor_m = (size_t)PLAN_CORESET_MIN_PER_CLUSTER * (size_t)in->k;
+        m = m > PLAN_CORESET_MAX ? PLAN_CORESET_MAX : m;
+        /* coreset abaixo do minimo por grupo nao vale: escolha livre vai para o fluxo */
+        int coreset_short = m < floor_m && m < rows;
+        int stream = in->force_exec == KMEANS_EXEC_STREAM ||
+                     (exec_free && (in->exact || coreset_short ||
+                                    (double)raw <= PLAN_STREAM_RATIO * (double)in->budget));
+        if (stream)
+        {
+            plan->exec = KMEANS_EXEC_STREAM;
+            plan->points = 0;
+            plan->bytes = 0;
+            snprintf(why, sizeof(why), "%s; Lloyd exato relendo o arquivo a cada iteracao",
+                     fits ? "fluxo pedido" : coreset_short && in->force_exec < 0 && !in->exact
+                                                 ? "coreset minimo nao cabe no orcamento"
+                                                 : "nao cabe em memoria");
+        }
+        else
+        {
+            /* so chega aqui abaixo do minimo com coreset pedido: marca o plano */
+            plan->over_budget = coreset_short;
+            m = m < floor_m ? floor_m : m;
+            m = m > rows ? rows : m;
+            plan->exec = KMEANS_EXEC_CORESET;
+            plan->coreset_size = m;
+            plan->points = m;
+            plan->bytes = m * per_point;
+            if (m >= rows)
+            {
+                snprintf(why, sizeof(why), "%s; todas as %zu linhas com peso (exato)",
+                         in->force_exec == KMEANS_EXEC_CORESET ? "coreset pedido"
+                                                               : "base muito maior que o orcamento",
+                         m);
+            }
+            else
+            {
+                snprintf(why, sizeof(why), "%s; coreset ponderado de ~%zu pontos",
+                         in->force_exec == KMEANS_EXEC_CORESET ? "coreset pedido"
+                                                               : "base muito maior que o orcamento",
+                         m);
+            }
+        }
+    }
+
+    snprintf(plan->reason, sizeof(plan->reason), "%s%s%s%s; duplicatas %s", why,
+             memory_refused ? " (memoria pedida nao cabe)" : "",
+             plan->over_budget ? " (acima do orcamento: minimo de pontos por grupo)" : "",
+             in->force_replicate && plan->weighted ? " (replicacao pedida nao cabe)" : "",
+             plan->weighted ? "como peso" : "replicadas");
+}
+
+/* registra entrada e decisao no relatorio (chave=valor) */
+static inline void kmeans_plan_report(FILE* out, const kmeans_plan_input* in, const kmeans_plan* plan)
+{
+    fprintf(out, "plan.rows=%zu\n", in->rows);
+    fprintf(out, "plan.rows_estimated=%d\n", in->rows_estimated);
+    fprintf(out, "plan.replication=%zu\n", in->replication);
+    fprintf(out, "plan.dims=%d\n", in->dims);
+    fprintf(out, "plan.k=%d\n", in->k);
+    fprintf(out, "plan.budget_bytes=%zu\n", in->budget);
+    fprintf(out, "plan.layout=%s\n", kmeans_layout_name(plan->layout));
+    fprintf(out, "plan.duplicates=%s\n", plan->weighted ? "weight" : "replicate");
+    fprintf(out, "plan.exec=%s\n", kmeans_exec_name(plan->exec));
+    fprintf(out, "plan.points=%zu\n", plan->points);
+    fprintf(out, "plan.bytes=%zu\n", plan->bytes);
+    fprintf(out, "plan.coreset_size=%zu\n", plan->coreset_size);
+    fprintf(out, "plan.over_budget=%d\n", plan->over_budget);
+    fprintf(out, "plan.reason=%s\n", plan->reason);
+}
+
+#endif /* KMEANS_PLAN_H */
@@ -0,0 +1,190 @@
+/**
+ * @file kmeans_published_model.h
+ * @brief Modelo publicado para leitores concorrentes (troca sem locks).
+ *
+ * Leitores pegam o conjunto de centroides atual com um unico load atomico;
+ * o escritor publica um modelo novo com um exchange atomico. A memoria do
+ * modelo antigo e liberada por reclamacao baseada em epocas: cada leitor
+ * anuncia a epoca global no seu slot antes do load e zera o slot ao sair;
+ * um modelo aposentado na epoca e so e liberado quando nenhum slot ativo
+ * tem epoca <= e.
+ *
+ *   kmeans_reader_enter(reg, id);
+ *   const kmeans_snapshot* m = kmeans_current(reg);
+ *   ... usa m ...
+ *   kmeans_reader_exit(reg, id);
+ *
+ * Somente um escritor por vez (kmeans_publish nao e reentrante).
+ */
+#ifndef KMEANS_PUBLISHED_MODEL_H
+#define KMEANS_PUBLISHED_MODEL_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KMEANS_MAX_READERS 256
+#define KMEANS_MAX_RETIRED 1024
+
+typedef struct
+{
+    int k;
+    uint64_t version;
+    double* cx;
+    double* cy;
+} kmeans_snapshot;
+
+typedef struct
+{
+    _Atomic uint64_t epoch; /* 0 = fora de secao de leitura */
+    char pad[64 - sizeof(uint64_t)];
+} kmeans_reader_slot;
+
+typedef struct
+{
+    kmeans_snapshot* model;
+    uint64_t epoch;
+} kmeans_retired;
+
+typedef struct
+{
+    _Atomic(kmeans_snapshot*) current;
+    _Atomic uint64_t global_epoch;
+    kmeans_reader_slot readers[KMEANS_MAX_READERS];
+
+    /* estado privado do escritor */
+    kmeans_retired retired[KMEANS_MAX_RETIRED];
+    int retired_count;
+    uint64_t reclaimed;
+} kmeans_model_registry;
+
+/* copia os centroides num snapshot novo; NULL sem memoria */
+static inline kmeans_snapshot* kmeans_snapshot_create(int k, const double* cx, const double* cy,
+                                                      uint64_t version)
+{
+    kmeans_snapshot* s = (kmeans_snapshot*)malloc(sizeof(kmeans_snapshot));
+    if (!s)
+    {
+        return NULL;
+    }
+    s->k = k;
+    s->version = version;
+    s->cx = (double*)malloc(sizeof(double) * k);
+    s->cy = (double*)malloc(sizeof(double) * k);
+    if (!s->cx || !s->cy)
+    {
+        free(s->cx);
+        free(s->cy);
+        free(s);
+        return NULL;
+    }
+    memcpy(s->cx, cx, sizeof(double) * k);
+    memcpy(s->cy, cy, sizeof(double) * k);
+    return s;
+}
+
+static inline void kmeans_snapshot_free(kmeans_snapshot* s)
+{
+    if (s)
+    {
+        free(s->cx);
+        free(s->cy);
+        free(s);
+    }
+}
+
+static inline void kmeans_registry_init(kmeans_model_registry* reg, kmeans_snapshot* initial)
+{
+    memset(reg, 0, sizeof(*reg));
+    atomic_init(&reg->current, initial);
+    atomic_init(&reg->global_epoch, 1);
+    for (int i = 0; i < KMEANS_MAX_READERS; i++)
+    {
+        atomic_init(&reg->readers[i].epoch, 0);
+    }
+}
+
+static inline void kmeans_reader_enter(kmeans_model_registry* reg, int reader)
+{
+    /* seq_cst: o anuncio precisa ser visivel antes do load de `current` */
+    atomic_store(&reg->readers[reader].epoch, atomic_load(&reg->global_epoch));
+}
+
+static inline const kmeans_snapshot* kmeans_current(kmeans_model_registry* reg)
+{
+    return atomic_load(&reg->current);
+}
+
+static inline void kmeans_reader_exit(kmeans_model_registry* reg, int reader)
+{
+    atomic_store_explicit(&reg->readers[reader].epoch, 0, memory_order_release);
+}
+
+/* libera os modelos aposentados que nenhum leitor ativo pode estar usando */
+static inline void kmeans_reclaim(kmeans_model_registry* reg)
+{
+    uint64_t min_active = UINT64_MAX;
+    for (int i = 0; i < KMEANS_MAX_READERS; i++)
+    {
+        uint64_t e = atomic_load(&reg->readers[i].epoch);
+        if (e != 0 && e < min_active)
+        {
+            min_active = e;
+        }
+    }
+
+    int kept = 0;
+    for (int i = 0; i < reg->retired_count; i++)
+    {
+        if (reg->retired[i].epoch < min_active)
+        {
+            kmeans_snapshot_free(reg->retired[i].model);
+            reg->reclaimed++;
+        }
+        else
+        {
+            reg->retired[kept++] = reg->retired[i];
+        }
+    }
+    reg->retired_count = kept;
+}
+
+/*
+ * Publica `next`; o modelo anterior e aposentado e liberado quando seguro.
+ * Com `next` NULL (snapshot que nao pode ser criado) o modelo atual fica
+ * publicado e retorna -1.
+ */
+static inline int kmeans_publish(kmeans_model_registry* reg, kmeans_snapshot* next)
+{
+    if (!next)
+    {
+        return -1;
+    }
+    kmeans_snapshot* old = atomic_exchange(&reg->current, next);
+    uint64_t epoch = atomic_fetch_add(&reg->global_epoch, 1);
+
+    while (reg->retired_count == KMEANS_MAX_RETIRED)
+    {
+        kmeans_reclaim(reg); /* lista cheia: espera os leitores avancarem */
+    }
+    reg->retired[reg->retired_count].model = old;
+    reg->retired[reg->retired_count].epoch = epoch;
+    reg->retired_count++;
+    kmeans_reclaim(reg);
+    return 0;
+}
+
+/* so apos todos os leitores terminarem */
+static inline void kmeans_registry_destroy(kmeans_model_registry* reg)
+{
+    for (int i = 0; i < reg->retired_count; i++)
+    {
+        kmeans_snapshot_free(reg->retired[i].model);
+    }
+    reg->retired_count = 0;
+    kmeans_snapshot_free(atomic_load(&reg->current));
+    atomic_store(&reg->current, NULL);
+}
+
+#endif /* KMEANS_PUBLISHED_MODEL_H */
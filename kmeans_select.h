@@ -0,0 +1,498 @@
+/**
+ * @file kmeans_select.h
+ * @brief Selecao automatica do motor de atribuicao a partir de estatisticas
+ *        da base.
+ *
+ * Uma pre-passada barata sobre uma amostra estima:
+ *  - dimensao intrinseca (razao de participacao dos autovalores da
+ *    covariancia: 1 = pontos numa reta, D = espalhados em todas as direcoes);
+ *  - fracao de duplicatas exatas;
+ *  - intervalo de valores por coordenada;
+ *  - separacao esperada dos clusters (Lloyd na amostra: menor distancia entre
+ *    centroides / (2 * raio RMS dentro dos clusters)) e a fracao de pontos
+ *    perto de uma fronteira.
+ * Separacao e dimensao intrinseca (limitada por D) estimam quantos pontos se
+ * sobrepoem entre clusters; isso ou a fronteira, o que for maior, e o tamanho
+ * esperado da lista ativa. Os kernels de atribuicao (escalar e SIMD por
+ * blocos SoA) sao calibrados na amostra (ns por ponto x centroide) e o
+ * modelo de custo compara Lloyd completo com o conjunto ativo (ver
+ * k_means_clustering_omp_active.c e kmeans_active.h).
+ */
+#ifndef KMEANS_SELECT_H
+#define KMEANS_SELECT_H
+
+#include <float.h>
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kmeans_common.h"
+
+#define KMEANS_KERNEL_BLOCK 1024    /* pontos por bloco nos kernels */
+#define SELECT_SAMPLE 16384         /* tamanho da amostra da pre-passada */
+#define SELECT_MAX_ITERS 100
+#define SELECT_BOUNDARY 0.1         /* margem (fracao da menor distancia entre centroides) */
+#define SELECT_DENSE_EXIT 0.01      /* trocas acima disso: iteracao "densa" */
+#define SELECT_VERIFY_EVERY 8       /* passadas completas do conjunto ativo */
+#define SELECT_DEDUP_MIN 0.2        /* duplicatas a partir das quais vale deduplicar */
+#define SELECT_DIM 2                /* coordenadas por ponto (x, y) */
+
+typedef enum
+{
+    KMEANS_ENGINE_LLOYD = 0,
+    KMEANS_ENGINE_ACTIVE = 1
+} kmeans_engine;
+
+typedef enum
+{
+    KMEANS_KERNEL_SCALAR = 0,
+    KMEANS_KERNEL_SIMD = 1
+} kmeans_kernel;
+
+typedef struct
+{
+    size_t sample;
+    double intrinsic_dim;
+    double dup_ratio;
+    double min_x, max_x, min_y, max_y;
+    double separation;
+    double boundary_frac;
+    size_t sample_iters;
+    size_t dense_iters;  /* iteracoes da amostra com mais de SELECT_DENSE_EXIT de trocas */
+} kmeans_data_stats;
+
+typedef struct
+{
+    kmeans_engine engine;
+    kmeans_kernel kernel;
+    int dedup;
+    double ns_scalar;    /* ns por ponto x centroide, so o mais proximo */
+    double ns_simd;
+    double ns_margin;    /* idem, mais proximo + margem (kernel escolhido) */
+    double ns_point;     /* ns por ponto da acumulacao por grupo (passada de atualizacao) */
+    double overlap;      /* fracao estimada de pontos do lado errado da fronteira mais proxima */
+    double list_frac;    /* fracao esperada da base na lista ativa durante a cauda */
+    double cost_lloyd;   /* segundos estimados */
+    double cost_active;
+    char reason[256];
+} kmeans_select_plan;
+
+static inline const char* kmeans_engine_name(kmeans_engine e)
+{
+    return e == KMEANS_ENGINE_LLOYD ? "lloyd" : "active";
+}
+
+static inline const char* kmeans_kernel_name(kmeans_kernel k)
+{
+    return k == KMEANS_KERNEL_SCALAR ? "scalar" : "simd";
+}
+
+/* ---------------------------------------------------------------------- */
+/* kernels de atribuicao sobre um bloco SoA (count <= KMEANS_KERNEL_BLOCK) */
+/* ---------------------------------------------------------------------- */
+
+/* ponto a ponto, laco interno nos centroides (mesmo criterio de calculateNearest) */
+static inline void kmeans_nearest_scalar(const double* bx, const double* by, size_t count,
+                                         const cluster* clusters, int k, int* label, double* margin)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        double d1 = DBL_MAX, d2 = DBL_MAX;
+        int best = 0;
+        for (int c = 0; c < k; c++)
+        {
+            double dx = clusters[c].x - bx[i];
+            double dy = clusters[c].y - by[i];
+            double d = dx * dx + dy * dy;
+            if (d < d1)
+            {
+                d2 = d1;
+                d1 = d;
+                best = c;
+            }
+            else if (d < d2)
+            {
+                d2 = d;
+            }
+        }
+        label[i] = best;
+        if (margin)
+        {
+            margin[i] = sqrt(d2) - sqrt(d1);
+        }
+    }
+}
+
+/*
+ * Centroide a centroide, laco interno vetorizado nos pontos do bloco. O
+ * indice do melhor fica em double para que comparacao e selecao tenham a
+ * mesma largura de vetor.
+ */
+static inline void kmeans_nearest_simd(const double* bx, const double* by, size_t count,
+                                       const cluster* clusters, int k, int* label, double* margin)
+{
+    double d1[KMEANS_KERNEL_BLOCK];
+    double d2[KMEANS_KERNEL_BLOCK];
+    double best[KMEANS_KERNEL_BLOCK];
+    for (size_t i = 0; i < count; i++)
+    {
+        d1[i] = DBL_MAX;
+        d2[i] = DBL_MAX;
+        best[i] = 0.0;
+    }
+    for (int c = 0; c < k; c++)
+    {
+        double cx = clusters[c].x, cy = clusters[c].y, cc = (double)c;
+        #pragma omp simd
+        for (size_t i = 0; i < count; i++)
+        {
+            double dx = cx - bx[i];
+            double dy = cy - by[i];
+            double d = dx * dx + dy * dy;
+            /* carrega, seleciona e grava uma vez so: assim o laco vetoriza sem desvios */
+            double first = d1[i], second = d2[i], b = best[i];
+            int lt = d < first;
+            double loser = lt ? first : d;
+            b = lt ? cc : b;
+            first = lt ? d : first;
+            second = loser < second ? loser : second;
+            d1[i] = first;
+            d2[i] = second;
+            best[i] = b;
+        }
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        label[i] = (int)best[i];
+    }
+    if (margin)
+    {
+        #pragma omp simd
+        for (size_t i = 0; i < count; i++)
+        {
+            margin[i] = sqrt(d2[i]) - sqrt(d1[i]);
+        }
+    }
+}
+
+static inline void kmeans_nearest_block(kmeans_kernel kernel, const double* bx, const double* by,
+                                        size_t count, const cluster* clusters, int k, int* label,
+                                        double* margin)
+{
+    if (kernel == KMEANS_KERNEL_SIMD)
+    {
+        kmeans_nearest_simd(bx, by, count, clusters, k, label, margin);
+    }
+    else
+    {
+        kmeans_nearest_scalar(bx, by, count, clusters, k, label, margin);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* pre-passada de estatisticas                                            */
+/* ---------------------------------------------------------------------- */
+
+static inline int select_cmp_xy(const void* a, const void* b)
+{
+    const double* p = (const double*)a;
+    const double* q = (const double*)b;
+    if (p[0] != q[0])
+    {
+        return p[0] < q[0] ? -1 : 1;
+    }
+    return p[1] < q[1] ? -1 : p[1] > q[1];
+}
+
+/*
+ * Estatisticas da amostra (sx, sy) de `m` pontos. `centroids` (k) recebe os
+ * centroides do Lloyd na amostra, usados depois na calibracao dos kernels.
+ */
+static inline void kmeans_sample_stats(const double* sx, const double* sy, size_t m, int k,
+                                       unsigned int seed, kmeans_data_stats* st, cluster* centroids)
+{
+    memset(st, 0, sizeof(*st));
+    st->sample = m;
+
+    double min_x = DBL_MAX, min_y = DBL_MAX, max_x = -DBL_MAX, max_y = -DBL_MAX;
+    double mx = 0.0, my = 0.0;
+    #pragma omp parallel for reduction(min : min_x, min_y) reduction(max : max_x, max_y) \
+        reduction(+ : mx, my) schedule(static)
+    for (size_t i = 0; i < m; i++)
+    {
+        min_x = fmin(min_x, sx[i]);
+        max_x = fmax(max_x, sx[i]);
+        min_y = fmin(min_y, sy[i]);
+        max_y = fmax(max_y, sy[i]);
+        mx += sx[i];
+        my += sy[i];
+    }
+    st->min_x = min_x;
+    st->max_x = max_x;
+    st->min_y = min_y;
+    st->max_y = max_y;
+    mx /= (double)m;
+    my /= (double)m;
+
+    /* covariancia 2x2 e razao de participacao dos autovalores */
+    double cxx = 0.0, cyy = 0.0, cxy = 0.0;
+    #pragma omp parallel for reduction(+ : cxx, cyy, cxy) schedule(static)
+    for (size_t i = 0; i < m; i++)
+    {
+        double dx = sx[i] - mx, dy = sy[i] - my;
+        cxx += dx * dx;
+        cyy += dy * dy;
+        cxy += dx * dy;
+    }
+    double tr = (cxx + cyy) / (double)m;
+    double det = (cxx * cyy - cxy * cxy) / ((double)m * (double)m);
+    double disc = sqrt(fmax(0.0, tr * tr / 4.0 - det));
+    double l1 = tr / 2.0 + disc, l2 = fmax(0.0, tr / 2.0 - disc);
+    st->intrinsic_dim = l1 + l2 > 0.0 ? (l1 + l2) * (l1 + l2) / (l1 * l1 + l2 * l2) : 0.0;
+
+    /* duplicatas exatas: ordena os pares e conta iguais vizinhos */
+    double* pairs = (double*)malloc(sizeof(double) * 2 * m);
+    if (pairs)
+    {
+        for (size_t i = 0; i < m; i++)
+        {
+            pairs[2 * i] = sx[i];
+            pairs[2 * i + 1] = sy[i];
+        }
+        qsort(pairs, m, 2 * sizeof(double), select_cmp_xy);
+        size_t dups = 0;
+        for (size_t i = 1; i < m; i++)
+        {
+            dups += pairs[2 * i] == pairs[2 * i - 2] && pairs[2 * i + 1] == pairs[2 * i - 1];
+        }
+        st->dup_ratio = (double)dups / (double)m;
+        free(pairs);
+    }
+
+    /* Lloyd na amostra: iteracoes, iteracoes densas, separacao e fronteira */
+    int* label = (int*)malloc(sizeof(int) * m);
+    double* margin = (double*)malloc(sizeof(double) * m);
+    if (!label || !margin)
+    {
+        free(label);
+        free(margin);
+        return;
+    }
+    for (size_t i = 0; i < m; i++)
+    {
+        label[i] = (int)(rand_r(&seed) % (unsigned int)k);
+    }
+    size_t minAcceptedError = m / 10000;
+    size_t changed;
+    do
+    {
+        memset(centroids, 0, sizeof(cluster) * k);
+        for (size_t i = 0; i < m; i++)
+        {
+            centroids[label[i]].x += sx[i];
+            centroids[label[i]].y += sy[i];
+            centroids[label[i]].count++;
+        }
+        for (int c = 0; c < k; c++)
+        {
+            if (centroids[c].count > 0)
+            {
+                centroids[c].x /= centroids[c].count;
+                centroids[c].y /= centroids[c].count;
+            }
+        }
+        changed = 0;
+        #pragma omp parallel for reduction(+ : changed) schedule(static)
+        for (size_t b = 0; b < m; b += KMEANS_KERNEL_BLOCK)
+        {
+            int fresh[KMEANS_KERNEL_BLOCK];
+            size_t count = m - b < KMEANS_KERNEL_BLOCK ? m - b : KMEANS_KERNEL_BLOCK;
+            kmeans_nearest_scalar(sx + b, sy + b, count, centroids, k, fresh, margin + b);
+            for (size_t i = 0; i < count; i++)
+            {
+                changed += fresh[i] != label[b + i];
+                label[b + i] = fresh[i];
+            }
+        }
+        st->sample_iters++;
+        st->dense_iters += changed > SELECT_DENSE_EXIT * m;
+    } while (changed > minAcceptedError && st->sample_iters < SELECT_MAX_ITERS);
+
+    double min_sep = DBL_MAX;
+    for (int a = 0; a < k; a++)
+    {
+        for (int b = a + 1; b < k; b++)
+        {
+            if (centroids[a].count == 0 || centroids[b].count == 0)
+            {
+                continue; /* grupo vazio fica parado na origem */
+            }
+            min_sep = fmin(min_sep, hypot(centroids[a].x - centroids[b].x, centroids[a].y - centroids[b].y));
+        }
+    }
+    double within = 0.0;
+    size_t near = 0;
+    #pragma omp parallel for reduction(+ : within, near) schedule(static)
+    for (size_t i = 0; i < m; i++)
+    {
+        double dx = sx[i] - centroids[label[i]].x, dy = sy[i] - centroids[label[i]].y;
+        within += dx * dx + dy * dy;
+        near += margin[i] < SELECT_BOUNDARY * min_sep;
+    }
+    double rms = sqrt(within / (double)m);
+    st->separation = min_sep == DBL_MAX ? 0.0 : rms > 0.0 ? min_sep / (2.0 * rms) : INFINITY;
+    st->boundary_frac = (double)near / (double)m;
+    free(label);
+    free(margin);
+}
+
+/* ns por ponto x centroide de um kernel, medidos na amostra */
+static inline double kmeans_calibrate_kernel(kmeans_kernel kernel, const double* sx, const double* sy,
+                                             size_t m, const cluster* centroids, int k, int with_margin)
+{
+    int label[KMEANS_KERNEL_BLOCK];
+    double margin[KMEANS_KERNEL_BLOCK];
+    size_t work = 0;
+    double best = DBL_MAX;
+    for (int rep = 0; rep < 3; rep++)
+    {
+        double start = omp_get_wtime();
+        work = 0;
+        for (size_t b = 0; b < m; b += KMEANS_KERNEL_BLOCK)
+        {
+            size_t count = m - b < KMEANS_KERNEL_BLOCK ? m - b : KMEANS_KERNEL_BLOCK;
+            kmeans_nearest_block(kernel, sx + b, sy + b, count, centroids, k, label,
+                                 with_margin ? margin : NULL);
+            work += (size_t)label[count - 1] + 1; /* impede que o compilador descarte o kernel */
+        }
+        double elapsed = omp_get_wtime() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    (void)work;
+    return best * 1e9 / ((double)m * (double)k);
+}
+
+/* ns por ponto da soma por grupo que o Lloyd refaz a cada iteracao */
+static inline double kmeans_calibrate_accumulate(const double* sx, const double* sy, size_t m, int k)
+{
+    double* sums = (double*)calloc(3 * (size_t)k, sizeof(double));
+    if (!sums)
+    {
+        return 0.0;
+    }
+    double best = DBL_MAX;
+    for (int rep = 0; rep < 3; rep++)
+    {
+        double start = omp_get_wtime();
+        for (size_t i = 0; i < m; i++)
+        {
+            int g = (int)(i % (size_t)k);
+            sums[g] += sx[i];
+            sums[k + g] += sy[i];
+            sums[2 * k + g] += 1.0;
+        }
+        double elapsed = omp_get_wtime() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    volatile double sink = sums[0];
+    (void)sink;
+    free(sums);
+    return best * 1e9 / (double)m;
+}
+
+/*
+ * Sobreposicao entre os dois clusters mais proximos: com raio RMS r em
+ * d = min(dimensao intrinseca, D) direcoes, o desvio ao longo do eixo entre
+ * os centroides e r / sqrt(d), e a fracao que passa do ponto medio (a
+ * separacao vezes r) e erfc(separacao * sqrt(d / 2)) somando os dois lados.
+ * Esses pontos ficam trocando de grupo na cauda em vez de congelar.
+ */
+static inline double kmeans_select_overlap(const kmeans_data_stats* st)
+{
+    double d = fmin(st->intrinsic_dim, (double)SELECT_DIM);
+    if (d <= 0.0 || st->separation <= 0.0)
+    {
+        return 1.0; /* sem separacao medida: tudo pode trocar */
+    }
+    return fmin(1.0, erfc(st->separation * sqrt(d / 2.0)));
+}
+
+/*
+ * Modelo de custo (segundos, n pontos materializados, t threads):
+ *   lloyd  = I * (k * ns + ns_ponto) * n / t
+ *   active = [I_densas * (k * ns + ns_ponto)
+ *             + (2 + (I - I_densas) / VERIFY + (I - I_densas) * lista) * (k * ns_margem + ns_ponto)]
+ *            * n / t
+ * com I e I_densas medidos na amostra e lista = max(fronteira, sobreposicao):
+ * a fronteira medida na amostra convergida subestima a lista quando os
+ * clusters se sobrepoem (ver kmeans_select_overlap). No conjunto ativo
+ * ns_ponto cobre os deltas das trocas e a compactacao da lista; as duas
+ * passadas com margem a mais sao a que monta a lista e a que confirma a
+ * convergencia. O kernel e o mais rapido na calibracao; deduplicar compensa
+ * com duplicatas >= SELECT_DEDUP_MIN.
+ */
+static inline void kmeans_select_engine(const kmeans_data_stats* st, size_t n, int k, double ns_scalar,
+                                        double ns_simd, double ns_margin, double ns_point,
+                                        kmeans_select_plan* plan)
+{
+    memset(plan, 0, sizeof(*plan));
+    plan->ns_scalar = ns_scalar;
+    plan->ns_simd = ns_simd;
+    plan->ns_margin = ns_margin;
+    plan->ns_point = ns_point;
+    plan->kernel = ns_simd < ns_scalar ? KMEANS_KERNEL_SIMD : KMEANS_KERNEL_SCALAR;
+    plan->dedup = st->dup_ratio >= SELECT_DEDUP_MIN;
+    plan->overlap = kmeans_select_overlap(st);
+    plan->list_frac = fmax(st->boundary_frac, plan->overlap);
+
+    double ns = fmin(ns_scalar, ns_simd);
+    double eff_n = plan->dedup ? (double)n * (1.0 - st->dup_ratio) : (double)n;
+    double work = eff_n * 1e-9 / omp_get_max_threads();
+    double iters = (double)st->sample_iters;
+    double dense = (double)st->dense_iters;
+    double tail = fmax(0.0, iters - dense);
+
+    plan->cost_lloyd = iters * (k * ns + ns_point) * work;
+    plan->cost_active = (dense * (k * ns + ns_point) +
+                         (2.0 + tail / SELECT_VERIFY_EVERY + tail * plan->list_frac) * (k * ns_margin + ns_point)) *
+                        work;
+    plan->engine = plan->cost_active < plan->cost_lloyd ? KMEANS_ENGINE_ACTIVE : KMEANS_ENGINE_LLOYD;
+
+    snprintf(plan->reason, sizeof(plan->reason),
+             "%s (custo estimado %.3g s contra %.3g s, lista %.1f%%), kernel %s (%.2f contra %.2f ns/ponto/centroide)%s",
+             kmeans_engine_name(plan->engine),
+             plan->engine == KMEANS_ENGINE_ACTIVE ? plan->cost_active : plan->cost_lloyd,
+             plan->engine == KMEANS_ENGINE_ACTIVE ? plan->cost_lloyd : plan->cost_active,
+             100.0 * plan->list_frac, kmeans_kernel_name(plan->kernel), ns, fmax(ns_scalar, ns_simd),
+             plan->dedup ? ", deduplicando" : "");
+}
+
+/* estatisticas e escolha no formato chave=valor do relatorio */
+static inline void kmeans_select_report(FILE* out, const kmeans_data_stats* st, const kmeans_select_plan* plan)
+{
+    fprintf(out, "select.sample=%zu\n", st->sample);
+    fprintf(out, "select.intrinsic_dim=%.4f\n", st->intrinsic_dim);
+    fprintf(out, "select.dup_ratio=%.4f\n", st->dup_ratio);
+    fprintf(out, "select.range_x=%.9g,%.9g\n", st->min_x, st->max_x);
+    fprintf(out, "select.range_y=%.9g,%.9g\n", st->min_y, st->max_y);
+    fprintf(out, "select.separation=%.4f\n", st->separation);
+    fprintf(out, "select.boundary_frac=%.4f\n", st->boundary_frac);
+    fprintf(out, "select.sample_iters=%zu\n", st->sample_iters);
+    fprintf(out, "select.dense_iters=%zu\n", st->dense_iters);
+    fprintf(out, "select.ns_scalar=%.4f\n", plan->ns_scalar);
+    fprintf(out, "select.ns_simd=%.4f\n", plan->ns_simd);
+    fprintf(out, "select.ns_margin=%.4f\n", plan->ns_margin);
+    fprintf(out, "select.ns_point=%.4f\n", plan->ns_point);
+    fprintf(out, "select.overlap=%.4f\n", plan->overlap);
+    fprintf(out, "select.list_frac=%.4f\n", plan->list_frac);
+    fprintf(out, "select.cost_lloyd=%.6g\n", plan->cost_lloyd);
+    fprintf(out, "select.cost_active=%.6g\n", plan->cost_active);
+    fprintf(out, "select.engine=%s\n", kmeans_engine_name(plan->engine));
+    fprintf(out, "select.kernel=%s\n", kmeans_kernel_name(plan->kernel));
+    fprintf(out, "select.dedup=%d\n", plan->dedup);
+    fprintf(out, "select.reason=%s\n", plan->reason);
+}
+
+#endif /* KMEANS_SELECT_H */
@@ -0,0 +1,213 @@
+/**
+ * @file kmeans_shm.h
+ * @brief Publica/anexa a base (SoA: vetores x e y) num segmento POSIX de
+ *        memoria compartilhada (/dev/shm), para varios processos usarem a
+ *        mesma copia sem reler o CSV.
+ *
+ * Layout do segmento: cabecalho versionado seguido de x[n] e y[n]
+ * (alinhados a 64 bytes). O campo `magic` e escrito por ultimo, com
+ * semantica release, entao um leitor nunca ve um segmento pela metade.
+ *
+ * Uso nas versoes: KMEANS_SHM=/nome ./kmeans_...  (ver k_means_clustering_shm_publish.c)
+ *
+ * So os motores SoA (GPU e CUDA) usam os vetores mapeados direto. Os motores
+ * AoS guardam o rotulo ao lado das coordenadas e gravam nele, entao cada
+ * processo ainda copia o segmento para o proprio vetor (kmeans_shm_load_aos):
+ * o ganho para eles e nao reler nem replicar o CSV, nao a memoria.
+ */
+#ifndef KMEANS_SHM_H
+#define KMEANS_SHM_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define KMEANS_SHM_MAGIC 0x4B4D5348u /* "KMSH" */
+#define KMEANS_SHM_VERSION 1u
+#define KMEANS_SHM_ALIGN 64u
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t n;           /* observacoes efetivas (ja replicadas) */
+    uint64_t replication; /* fator de replicacao aplicado ao CSV */
+    uint64_t x_offset;    /* bytes desde o inicio do segmento */
+    uint64_t y_offset;
+    uint64_t total_bytes;
+    char source[256];     /* arquivo de origem, so informativo */
+} kmeans_shm_header;
+
+typedef struct
+{
+    const kmeans_shm_header* header;
+    const double* x;
+    const double* y;
+    size_t n;
+    void* base;
+    size_t bytes;
+} kmeans_shm_dataset;
+
+static inline uint64_t kmeans_shm_align(uint64_t v)
+{
+    return (v + KMEANS_SHM_ALIGN - 1) / KMEANS_SHM_ALIGN * KMEANS_SHM_ALIGN;
+}
+
+/* cria (ou substitui) o segmento `name` com uma copia de x/y; retorna 0 em caso de sucesso */
+static inline int kmeans_shm_publish(const char* name, const double* x, const double* y, size_t n,
+                                     size_t replication, const char* source)
+{
+    uint64_t x_offset = kmeans_shm_align(sizeof(kmeans_shm_header));
+    uint64_t y_offset = kmeans_shm_align(x_offset + sizeof(double) * n);
+    uint64_t total = y_offset + sizeof(double) * n;
+
+    shm_unlink(name); /* versao anterior continua valida para quem ja anexou */
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        perror("shm_open");
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)total) != 0)
+    {
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+
+    void* base = mmap(NULL, (size_t)total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        perror("mmap");
+        shm_unlink(name);
+        return -1;
+    }
+
+    kmeans_shm_header* header = (kmeans_shm_header*)base;
+    header->version = KMEANS_SHM_VERSION;
+    header->n = n;
+    header->replication = replication;
+    header->x_offset = x_offset;
+    header->y_offset = y_offset;
+    header->total_bytes = total;
+    snprintf(header->source, sizeof(header->source), "%s", source ? source : "");
+    memcpy((char*)base + x_offset, x, sizeof(double) * n);
+    memcpy((char*)base + y_offset, y, sizeof(double) * n);
+
+    /* publica: so agora o segmento passa a ser aceito por kmeans_shm_attach */
+    __atomic_store_n(&header->magic, KMEANS_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    munmap(base, (size_t)total);
+    return 0;
+}
+
+/* cada vetor (n doubles a partir de `offset`) fica depois do cabecalho e dentro de total_bytes */
+static inline int kmeans_shm_array_fits(uint64_t offset, uint64_t n, uint64_t total_bytes)
+{
+    if (n > total_bytes / sizeof(double))
+    {
+        return 0; /* 8n nem cabe (e evita overflow nas contas abaixo) */
+    }
+    return offset >= sizeof(kmeans_shm_header) && offset % sizeof(double) == 0 &&
+           offset <= total_bytes - sizeof(double) * n;
+}
+
+/* anexa somente-leitura; retorna 0 em caso de sucesso */
+static inline int kmeans_shm_attach(const char* name, kmeans_shm_dataset* ds)
+{
+    memset(ds, 0, sizeof(*ds));
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        perror("shm_open");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(kmeans_shm_header))
+    {
+        fprintf(stderr, "Segmento %s invalido.\n", name);
+        close(fd);
+        return -1;
+    }
+
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        perror("mmap");
+        return -1;
+    }
+
+    const kmeans_shm_header* header = (const kmeans_shm_header*)base;
+    uint32_t magic = __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE);
+    if (magic != KMEANS_SHM_MAGIC || header->version != KMEANS_SHM_VERSION ||
+        header->total_bytes > (uint64_t)st.st_size ||
+        !kmeans_shm_array_fits(header->x_offset, header->n, header->total_bytes) ||
+        !kmeans_shm_array_fits(header->y_offset, header->n, header->total_bytes))
+    {
+        fprintf(stderr, "Segmento %s incompleto ou de versao incompativel.\n", name);
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+
+    ds->header = header;
+    ds->x = (const double*)((const char*)base + header->x_offset);
+    ds->y = (const double*)((const char*)base + header->y_offset);
+    ds->n = (size_t)header->n;
+    ds->base = base;
+    ds->bytes = (size_t)st.st_size;
+    return 0;
+}
+
+static inline void kmeans_shm_detach(kmeans_shm_dataset* ds)
+{
+    if (ds->base)
+    {
+        munmap(ds->base, ds->bytes);
+    }
+    memset(ds, 0, sizeof(*ds));
+}
+
+/*
+ * Copia o segmento `name` para um vetor AoS alocado aqui (calloc: os demais
+ * campos, como o rotulo, ficam zerados). Cada elemento tem `elem` bytes, com
+ * os doubles x e y nos deslocamentos `x_at` e `y_at`. Retorna NULL se o
+ * segmento nao anexar ou faltar memoria.
+ */
+static inline void* kmeans_shm_load_aos(const char* name, size_t elem, size_t x_at, size_t y_at,
+                                        size_t* out_n)
+{
+    kmeans_shm_dataset ds;
+    if (kmeans_shm_attach(name, &ds) != 0)
+    {
+        return NULL;
+    }
+
+    char* out = (char*)calloc(ds.n ? ds.n : 1, elem);
+    if (out)
+    {
+        #ifdef _OPENMP
+        #pragma omp parallel for schedule(static)
+        #endif
+        for (size_t i = 0; i < ds.n; i++)
+        {
+            memcpy(out + i * elem + x_at, &ds.x[i], sizeof(double));
+            memcpy(out + i * elem + y_at, &ds.y[i], sizeof(double));
+        }
+        *out_n = ds.n;
+    }
+
+    kmeans_shm_detach(&ds);
+    return out;
+}
+
+#endif /* KMEANS_SHM_H */
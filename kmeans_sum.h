@@ -0,0 +1,41 @@
+/**
+ * @file kmeans_sum.h
+ * @brief Soma compensada opcional no acumulo dos centroides.
+ *
+ * COMPENSATED_SUM=1 troca o acumulo ingenuo dos centroides por soma em
+ * blocos de SUM_BLOCK pontos (somas curtas, erro pequeno) cujos parciais
+ * entram num acumulador de Neumaier. Nao compilar com -ffast-math, que
+ * elimina a compensacao.
+ *
+ * Incluido por kmeans_common.h e pelas versoes originais, que so tem o laco
+ * de blocos embutido.
+ */
+#ifndef KMEANS_SUM_H
+#define KMEANS_SUM_H
+
+#include <math.h>
+
+#ifndef COMPENSATED_SUM
+#define COMPENSATED_SUM 0
+#endif
+
+#ifndef SUM_BLOCK
+#define SUM_BLOCK 1024
+#endif
+
+/* soma de Neumaier: `comp` guarda o que o arredondamento de `sum + v` perdeu */
+static inline void neumaier_add(double* sum, double* comp, double v)
+{
+    double t = *sum + v;
+    if (fabs(*sum) >= fabs(v))
+    {
+        *comp += (*sum - t) + v;
+    }
+    else
+    {
+        *comp += (v - t) + *sum;
+    }
+    *sum = t;
+}
+
+#endif /* KMEANS_SUM_H */